@@ -45,10 +45,21 @@ subprocess.check_call([compiler , "shaders/medium.slang", '-o', 'spv/medium.frag
 # Main renderer
 subprocess.check_call([compiler , "shaders/clouds.slang", '-o', 'spv/clouds.comp.spv', '-target', 'spirv', '-entry', 'computeMain'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
 subprocess.check_call([compiler , "shaders/clouds.slang", '-o', 'spv/clouds_repr.comp.spv', '-target', 'spirv', '-entry', 'computeMain', '-DCLOUD_RENDER_SUBSAMPLE'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+subprocess.check_call([compiler , "shaders/clouds.slang", '-o', 'spv/cloudslightvolume.comp.spv', '-target', 'spirv', '-entry', 'lightVolumeMain'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+subprocess.check_call([compiler , "shaders/clouds.slang", '-o', 'spv/cloudsshadowmap.comp.spv', '-target', 'spirv', '-entry', 'shadowMapMain'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+subprocess.check_call([compiler , "shaders/clouds.slang", '-o', 'spv/cloudsfarfield.comp.spv', '-target', 'spirv', '-entry', 'farFieldMain'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+subprocess.check_call([compiler , "shaders/clouds.slang", '-o', 'spv/cloudsclassifytiles.comp.spv', '-target', 'spirv', '-entry', 'classifyTilesMain'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+subprocess.check_call([compiler , "shaders/clouds.slang", '-o', 'spv/cloudsfilloccluded.comp.spv', '-target', 'spirv', '-entry', 'fillOccludedTilesMain'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+subprocess.check_call([compiler , "shaders/clouds.slang", '-o', 'spv/cloudsfillempty.comp.spv', '-target', 'spirv', '-entry', 'fillEmptyTilesMain'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+subprocess.check_call([compiler , "shaders/cloudsupsample.slang", '-o', 'spv/cloudsupsample.comp.spv', '-target', 'spirv', '-entry', 'computeMain'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+subprocess.check_call([compiler , "shaders/cloudnoise.slang", '-o', 'spv/cloudnoisebase.comp.spv', '-target', 'spirv', '-entry', 'baseNoiseMain'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+subprocess.check_call([compiler , "shaders/cloudnoise.slang", '-o', 'spv/cloudnoisedetail.comp.spv', '-target', 'spirv', '-entry', 'detailNoiseMain'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
 subprocess.check_call([compiler , "shaders/transmittance.slang", '-o', 'spv/transmittance.comp.spv', '-target', 'spirv', '-entry', 'computeMain'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
 subprocess.check_call([compiler , "shaders/multiplescattering.slang", '-o', 'spv/multiplescattering.comp.spv', '-target', 'spirv', '-entry', 'computeMain'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
 subprocess.check_call([compiler , "shaders/skyview.slang", '-o', 'spv/skyview.comp.spv', '-target', 'spirv', '-entry', 'computeMain'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+subprocess.check_call([compiler , "shaders/skyview.slang", '-o', 'spv/skyviewbank.comp.spv', '-target', 'spirv', '-entry', 'computeMain', '-DSKY_VIEW_BANK'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
 subprocess.check_call([compiler , "shaders/aerialperspective.slang", '-o', 'spv/aerialperspective.comp.spv', '-target', 'spirv', '-entry', 'computeMain'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+subprocess.check_call([compiler , "shaders/aerialperspective.slang", '-o', 'spv/aerialperspective_scan.comp.spv', '-target', 'spirv', '-entry', 'computeScanMain'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
 subprocess.check_call([compiler , "shaders/depth.slang", '-o', 'spv/depth.vert.spv', '-target', 'spirv', '-entry', 'vertexMain'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
 subprocess.check_call([compiler , "shaders/depth.slang", '-o', 'spv/depth.frag.spv', '-target', 'spirv', '-entry', 'pixelDepth'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
 subprocess.check_call([compiler , "shaders/depth.slang", '-o', 'spv/linear_depth.frag.spv', '-target', 'spirv', '-entry', 'pixelLinearDepth'], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
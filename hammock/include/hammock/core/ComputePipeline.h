@@ -23,6 +23,9 @@ namespace hammock {
             struct ShaderModuleInfo {
                 const std::vector<char> &byteCode;
                 std::string entryFunc = "main";
+                // Specialization constants of the shader, map entries point into the data
+                std::vector<VkSpecializationMapEntry> specializationMapEntries{};
+                std::vector<uint8_t> specializationData{};
             } computeShader;
             std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
             std::vector<VkPushConstantRange> pushConstantRanges;
@@ -485,7 +485,7 @@ __PRETTY_FUNCTION__, message);  /* Use __PRETTY_FUNCTION__ */ \
         uint16_t f16 = 0;
 
         uint32_t sign = (f32 >> 16) & 0x8000; // Extract sign bit
-        uint32_t exponent = ((f32 >> 23) & 0xFF) - 112; // Adjust exponent bias
+        int32_t exponent = static_cast<int32_t>((f32 >> 23) & 0xFF) - 112; // Adjust exponent bias, signed so underflow is caught
         uint32_t mantissa = (f32 & 0x007FFFFF) >> 13; // Truncate mantissa
 
         if (exponent <= 0) {
@@ -502,6 +502,26 @@ __PRETTY_FUNCTION__, message);  /* Use __PRETTY_FUNCTION__ */ \
         return f16;
     }
 
+    inline float float16float32(uint16_t f16) {
+        uint32_t sign = static_cast<uint32_t>(f16 & 0x8000) << 16;
+        uint32_t exponent = (f16 >> 10) & 0x1F;
+        uint32_t mantissa = f16 & 0x03FF;
+        uint32_t f32;
+
+        if (exponent == 0) {
+            // Zero, denormals are flushed the same way float32float16 does
+            f32 = sign;
+        } else if (exponent == 31) {
+            // Inf or NaN
+            f32 = sign | 0x7F800000 | (mantissa << 13);
+        } else {
+            // Normal conversion
+            f32 = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        }
+
+        return *(float *) &f32;
+    }
+
     //Reference: https://en.wikipedia.org/wiki/Halton_sequence
     inline float haltonSequenceAt(int index, int base)
     {
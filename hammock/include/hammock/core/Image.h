@@ -19,6 +19,9 @@ namespace hammock {
         VkImageView m_view = VK_NULL_HANDLE;
         VkImageLayout m_layout = VK_IMAGE_LAYOUT_UNDEFINED;
         VmaAllocation m_allocation = VK_NULL_HANDLE;
+        // Aliased images live in memory they do not own
+        VmaAllocation m_aliasingAllocation = VK_NULL_HANDLE;
+        VkDeviceSize m_aliasingOffset = 0;
 
         // Attachment
         VkClearValue m_clearValue = {};
@@ -69,6 +72,8 @@ namespace hammock {
 
             m_memoryFlags = desc.memoryFlags;
 
+            m_aliasingAllocation = desc.aliasingAllocation;
+            m_aliasingOffset = desc.aliasingOffset;
 
             // Check for support
             VkFormatProperties formatProperties;
@@ -281,11 +286,9 @@ namespace hammock {
         }
 
         /**
-         * Creates the resource on device. This is called when ever this resource is requested and is not resident
+         * Returns create info of the image described by this resource
          */
-        void create() override {
-            Logger::log(LOG_LEVEL_DEBUG, "Creating image %s\n", getName().c_str());
-            // Create the image
+        [[nodiscard]] VkImageCreateInfo getImageCreateInfo() const {
             VkImageCreateInfo imageCreateInfo = Init::imageCreateInfo();
             imageCreateInfo.imageType = m_type;
             imageCreateInfo.format = m_format;
@@ -301,13 +304,42 @@ namespace hammock {
             imageCreateInfo.extent.depth = m_depth;
             imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
             imageCreateInfo.usage = m_usage;
+            return imageCreateInfo;
+        }
 
-            VmaAllocationCreateInfo allocInfo = {};
-            allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
-            allocInfo.requiredFlags = m_memoryFlags;
+        /**
+         * Returns memory requirements of the image without creating it
+         */
+        [[nodiscard]] VkMemoryRequirements getMemoryRequirements() const {
+            VkImageCreateInfo imageCreateInfo = getImageCreateInfo();
+            VkDeviceImageMemoryRequirements requirementsInfo = {
+                .sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS,
+                .pCreateInfo = &imageCreateInfo,
+            };
+            VkMemoryRequirements2 requirements = {.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2};
+            vkGetDeviceImageMemoryRequirements(device.device(), &requirementsInfo, &requirements);
+            return requirements.memoryRequirements;
+        }
 
-            checkResult(vmaCreateImage(device.allocator(), &imageCreateInfo, &allocInfo, &m_image, &m_allocation,
-                                       nullptr));
+        /**
+         * Creates the resource on device. This is called when ever this resource is requested and is not resident
+         */
+        void create() override {
+            Logger::log(LOG_LEVEL_DEBUG, "Creating image %s\n", getName().c_str());
+            // Create the image
+            VkImageCreateInfo imageCreateInfo = getImageCreateInfo();
+
+            if (m_aliasingAllocation != VK_NULL_HANDLE) {
+                checkResult(vmaCreateAliasingImage2(device.allocator(), m_aliasingAllocation, m_aliasingOffset,
+                                                    &imageCreateInfo, &m_image));
+            } else {
+                VmaAllocationCreateInfo allocInfo = {};
+                allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+                allocInfo.requiredFlags = m_memoryFlags;
+
+                checkResult(vmaCreateImage(device.allocator(), &imageCreateInfo, &allocInfo, &m_image, &m_allocation,
+                                           nullptr));
+            }
 
             // create image view
             VkImageViewCreateInfo viewInfo{};
@@ -331,7 +363,9 @@ namespace hammock {
          */
         void release() override {
             Logger::log(LOG_LEVEL_DEBUG, "Releasing image %s\n", getName().c_str());
-            if (m_image != VK_NULL_HANDLE) {
+            if (m_image != VK_NULL_HANDLE && m_aliasingAllocation != VK_NULL_HANDLE) {
+                vkDestroyImage(device.device(), m_image, nullptr);
+            } else if (m_image != VK_NULL_HANDLE) {
                 vmaDestroyImage(device.allocator(), m_image, m_allocation);
             }
 
@@ -17,6 +17,8 @@
 #include "hammock/core/ResourceManager.h"
 #include "hammock/core/FrameManager.h"
 #include "hammock/core/Types.h"
+#include "hammock/core/RenderGraphCompiler.h"
+#include "hammock/core/TransientAllocator.h"
 
 
 namespace hammock {
@@ -52,6 +54,10 @@ namespace hammock {
         // Needs recreation
         bool isDirty = true;
 
+        // Describes transient images, their memory is shared with other transient images that are not alive at
+        // the same time. The resolver creates a dedicated image when the graph does not place it.
+        std::function<ImageDesc(VkExtent2D)> transientDescription = nullptr;
+
         /**
          * Returns handle corresponding to resource of specific frame
          * @param rm ResourceManager where resource is registered
@@ -93,6 +99,10 @@ namespace hammock {
         bool isSwapChainImage() const {
             return type == Type::SwapChainImage;
         }
+
+        bool isTransient() const {
+            return transientDescription != nullptr;
+        }
     };
 
     /**
@@ -168,6 +178,7 @@ namespace hammock {
         VkPipelineStageFlags stageFlags = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
         std::string samplerName; // only for images
         CommandQueueFamily queueFamily = CommandQueueFamily::Ignored;
+        ResourceId resource = INVALID_GRAPH_ID; // Handle of the resource, interned from the name when the graph is built
     };
 
     enum RenderPassFlags : int32_t {
@@ -209,7 +220,8 @@ namespace hammock {
 
         std::unordered_map<uint32_t, Descriptor> descriptors;
 
-        std::vector<RenderPassNode *> dependencies;
+        // Transient images placed into shared memory whose lifetime starts in this pass
+        std::vector<ResourceId> acquiredTransients;
 
         bool autoBeginRendering = true;
 
@@ -366,10 +378,12 @@ namespace hammock {
         FrameManager &fm;
         ResourceManager &rm;
         DescriptorPool &pool;
-        // Holds all the resources
-        std::unordered_map<std::string, ResourceNode> resources;
-        // Holds all the render passes
+        // Holds all the resources, indexed by ResourceId
+        std::vector<ResourceNode> resources;
+        std::unordered_map<std::string, ResourceId> resourceIds;
+        // Holds all the render passes, indexed by PassId
         std::vector<RenderPassNode> passes;
+        std::unordered_map<std::string, PassId> passIds;
         // Holds all the samplers
         std::unordered_map<std::string, ResourceHandle> samplers;
 
@@ -378,6 +392,31 @@ namespace hammock {
         // submission groups by queue family
         std::vector<GroupWithGlobalIndex> allGroups; // all groups in execution order
 
+        RenderGraphCompiler compiler;
+        // Memory shared by the transient images, one set of heaps per frame in flight
+        std::vector<VmaAllocation> transientHeaps;
+        std::vector<ResourceHandle> transientImages;
+
+        /**
+         * Interns the resource, a resource added under an existing name replaces it and keeps its handle
+         * @return Handle of the resource
+         */
+        ResourceId internResource(ResourceNode &&node) {
+            auto [it, inserted] = resourceIds.try_emplace(node.name, static_cast<ResourceId>(resources.size()));
+            if (inserted) {
+                resources.push_back(std::move(node));
+            } else {
+                resources[it->second] = std::move(node);
+            }
+            return it->second;
+        }
+
+        ResourceId getResourceId(const std::string &name) const {
+            auto it = resourceIds.find(name);
+            ASSERT(it != resourceIds.end(), "Could not find the resource");
+            return it->second;
+        }
+
     public:
         RenderGraph(Device &device, ResourceManager &rm,
                     FrameManager &fm, DescriptorPool &pool): device(device), rm(rm), fm(fm), pool(pool) {
@@ -389,6 +428,14 @@ namespace hammock {
             passes.clear();
             resources.clear();
 
+            // Aliased images do not own their memory, release them before the heaps
+            for (auto &handle: transientImages) {
+                rm.releaseResource(handle.getUid());
+            }
+            for (auto &heap: transientHeaps) {
+                vmaFreeMemory(device.allocator(), heap);
+            }
+
             // Free command buffer and destroy sync objects
             for (auto &group: allGroups) {
                 if (group.group->queueFamily == CommandQueueFamily::Graphics) {
@@ -430,14 +477,14 @@ namespace hammock {
          * @param desc Description of the resource
          */
         template<ResourceNode::Type Type, typename ResourceType, typename DescriptionType>
-        void addResource(const std::string &name, const DescriptionType &desc) {
+        ResourceId addResource(const std::string &name, const DescriptionType &desc) {
             ResourceNode node;
             node.type = Type;
             node.name = name;
             node.resolver = [name, desc](ResourceManager &rm, uint32_t frameIndex) {
                 return rm.createResource<ResourceType>(name, desc);
             };
-            resources[name] = std::move(node);
+            return internResource(std::move(node));
         }
 
         /**
@@ -447,14 +494,14 @@ namespace hammock {
          * @param handle Handle of the actuall resource
          */
         template<ResourceNode::Type Type>
-        void addStaticResource(const std::string &name, ResourceHandle handle) {
+        ResourceId addStaticResource(const std::string &name, ResourceHandle handle) {
             ResourceNode node;
             node.type = Type;
             node.name = name;
             node.resolver = [handle](ResourceManager &rm, uint32_t frameIndex) {
                 return handle;
             };
-            resources[name] = std::move(node);
+            return internResource(std::move(node));
         }
 
 
@@ -467,7 +514,7 @@ namespace hammock {
          * @param modifier Callback to create a description of the dependant resource based on the swapchain size
          */
         template<ResourceNode::Type Type, typename ResourceType, typename DescriptionType>
-        void addSwapChainDependentResource(const std::string &name,
+        ResourceId addSwapChainDependentResource(const std::string &name,
                                            std::function<DescriptionType(VkExtent2D)> modifier) {
             ResourceNode node;
             node.type = Type;
@@ -478,7 +525,30 @@ namespace hammock {
                 DescriptionType depDesc = modifier(swapChainExtent);
                 return rm.createResource<ResourceType>(name, depDesc);
             };
-            resources[name] = std::move(node);
+            return internResource(std::move(node));
+        }
+
+        /**
+         * Creates a transient image that depends on swapchain size. Transient images are alive only between the first
+         * and the last pass accessing them, images that are not alive at the same time share memory. Their content
+         * does not survive between frames, they can not be referenced by addResourceFromPreviousFrame.
+         * @tparam Type Type of the image resource node
+         * @param name Name of the resource
+         * @param modifier Callback to create a description of the image based on the swapchain size
+         */
+        template<ResourceNode::Type Type>
+        ResourceId addTransientResource(const std::string &name, std::function<ImageDesc(VkExtent2D)> modifier) {
+            ResourceNode node;
+            node.type = Type;
+            node.name = name;
+            ASSERT(node.isImage() && !node.isSwapChainImage(), "Only images can be transient");
+            ASSERT(modifier, "Modifier is null!");
+            node.transientDescription = modifier;
+            node.resolver = [this, name, modifier](ResourceManager &rm, uint32_t frameIndex) {
+                VkExtent2D swapChainExtent = fm.getSwapChain()->getSwapChainExtent();
+                return rm.createResource<Image>(name, modifier(swapChainExtent));
+            };
+            return internResource(std::move(node));
         }
 
         /**
@@ -491,18 +561,18 @@ namespace hammock {
          * @param modifier Call back that creates dependent description base on the dependency description
          */
         template<ResourceNode::Type Type, typename ResourceType, typename DescriptionType>
-        void addDependentResource(const std::string &name, const std::string &dependency,
+        ResourceId addDependentResource(const std::string &name, const std::string &dependency,
                                   std::function<DescriptionType(ResourceHandle)> modifier) {
             ResourceNode node;
             node.type = Type;
             node.name = name;
             node.resolver = [this, name, dependency,modifier](ResourceManager &rm, uint32_t frameIndex) {
-                auto depHandle = resources.at(dependency).resolve(rm, frameIndex);
+                auto depHandle = resources[getResourceId(dependency)].resolve(rm, frameIndex);
                 ASSERT(modifier, "Modifier is null!");
                 auto newDesc = modifier(depHandle);
                 return rm.createResource<ResourceType>(name, newDesc);
             };
-            resources[name] = std::move(node);
+            return internResource(std::move(node));
         }
 
         /**
@@ -510,12 +580,12 @@ namespace hammock {
          * @tparam Type Type of the SwapChain attachment (SwapChainColorAttachment or SwapChainDepthStencilAttachment)
          * @param name Name of the resource
          */
-        void addSwapChainImageResource(const std::string &name) {
+        ResourceId addSwapChainImageResource(const std::string &name) {
             ResourceNode node;
             node.name = name;
             node.type = ResourceNode::Type::SwapChainImage;
             node.resolver = nullptr;
-            resources[name] = std::move(node);
+            return internResource(std::move(node));
         }
 
         /**
@@ -523,15 +593,17 @@ namespace hammock {
          * @param name Name of the resource
          * @param refName Name of the resource that this resource references
          */
-        void addResourceFromPreviousFrame(const std::string &name, const std::string &refName) {
+        ResourceId addResourceFromPreviousFrame(const std::string &name, const std::string &refName) {
             ResourceNode node;
-            node.type = resources.at(refName).type;
+            const ResourceId refId = getResourceId(refName);
+            ASSERT(!resources[refId].isTransient(), "Transient resources do not survive between frames");
+            node.type = resources[refId].type;
             node.name = name;
-            node.resolver = [this, refName](ResourceManager &rm, uint32_t frameIndex) {
+            node.resolver = [this, refId](ResourceManager &rm, uint32_t frameIndex) {
                 uint32_t previousFrameIndex = (frameIndex + SwapChain::MAX_FRAMES_IN_FLIGHT - 1) % SwapChain::MAX_FRAMES_IN_FLIGHT;
-                return resources.at(refName).resolve(rm, previousFrameIndex);
+                return resources[refId].resolve(rm, previousFrameIndex);
             };
-            resources[name] = std::move(node);
+            return internResource(std::move(node));
         }
 
 
@@ -570,6 +642,7 @@ namespace hammock {
             node.type = QueueFamily;
             node.viewportSize = ViewPortSize;
             node.viewport = HmckVec4{ViewPortWidth, ViewPortHeight, ViewPortDepthMin, ViewPortDepthMax};
+            passIds[name] = static_cast<PassId>(passes.size());
             passes.push_back(node);
             return passes.back();
         }
@@ -581,12 +654,10 @@ namespace hammock {
          */
         std::vector<VkDescriptorSetLayout> getDescriptorSetLayouts(const std::string &passName) {
             std::vector<VkDescriptorSetLayout> layouts = {};
-            for (auto &pass: passes) {
-                if (pass.name == passName) {
-                    for (const auto &descriptor: pass.descriptors) {
-                        layouts.push_back(descriptor.second.layout->getDescriptorSetLayout());
-                    }
-                    return layouts;
+            auto it = passIds.find(passName);
+            if (it != passIds.end()) {
+                for (const auto &descriptor: passes[it->second].descriptors) {
+                    layouts.push_back(descriptor.second.layout->getDescriptorSetLayout());
                 }
             }
             return layouts;
@@ -594,8 +665,11 @@ namespace hammock {
 
         void prepareResources() {
             for (auto &pass: passes) {
+                if (!(pass.flags & RENDER_PASS_FLAGS_CONTRIBUTING)) {
+                    continue;
+                }
                 for (auto &input: pass.inputs) {
-                    ResourceNode &resource = resources[input.resourceName];
+                    ResourceNode &resource = resources[input.resource];
                     for (int frameIndex = 0; frameIndex < SwapChain::MAX_FRAMES_IN_FLIGHT; frameIndex++) {
                         if (resource.isImage()) {
                             Image *image = rm.getResource<Image>(
@@ -616,121 +690,42 @@ namespace hammock {
             }
         }
 
-        void purgeNonContributingPasses() {
-            size_t originalSize = passes.size();
-            // Identify swapchain writers and initialize queue
-            std::queue<size_t> worklist;
-            for (int i = 0; i < passes.size(); i++) {
-                for (auto &write: passes[i].outputs) {
-                    ResourceNode &resource = resources[write.resourceName];
-                    if (resource.isSwapChainImage()) {
-                        passes[i].flags |= RENDER_PASS_FLAGS_SWAPCHAIN_WRITE;
-                        passes[i].flags |= RENDER_PASS_FLAGS_CONTRIBUTING;
-                        worklist.push(i);
-                    }
-                }
+        /**
+         * Interns the accessed resources and runs the dependency analysis over the dense handles. Marks the contributing
+         * passes, sorts them topologically and splits them into submission groups.
+         */
+        void analyzeDependencies() {
+            for (const ResourceNode &resource: resources) {
+                compiler.addResource(resource.isSwapChainImage());
             }
-
-            // Traverse upwards marking contributing passes
-            while (!worklist.empty()) {
-                size_t passIndex = worklist.front();
-                worklist.pop();
-
-                const auto &pass = passes[passIndex];
-
-                // Iterate over the inputs of this pass
-                for (const auto &input: pass.inputs) {
-                    auto it = resources.find(input.resourceName);
-                    if (it != resources.end()) {
-                        // Find the passes that write to this resource
-                        for (int i = 0; i < passes.size(); i++) {
-                            for (auto &write: passes[i].outputs) {
-                                if (write.resourceName == input.resourceName) {
-                                    ResourceNode &resource = resources[write.resourceName];
-                                    if (!(passes[i].flags & RENDER_PASS_FLAGS_CONTRIBUTING)) {
-                                        passes[i].flags |= RENDER_PASS_FLAGS_CONTRIBUTING;
-                                        worklist.push(i);
-                                    }
-                                }
-                            }
-                        }
-                    }
+            for (PassId passId = 0; passId < passes.size(); passId++) {
+                RenderPassNode &pass = passes[passId];
+                compiler.addPass(pass.type);
+                for (auto &input: pass.inputs) {
+                    input.resource = getResourceId(input.resourceName);
+                    compiler.read(passId, input.resource);
                 }
-            }
-
-            // Remove non-contributing passes
-            std::erase_if(passes, [](const RenderPassNode &pass) {
-                return !(pass.flags & RENDER_PASS_FLAGS_CONTRIBUTING);
-            });
-
-            Logger::log(LOG_LEVEL_DEBUG, "Purged %d non-contributing passes\n", originalSize - passes.size());
-        }
-
-        void detectDependencies() {
-            // for each pass
-            for (int passIdx = 0; passIdx < passes.size(); passIdx++) {
-                // for each input of the current pass
-                for (auto &input: passes[passIdx].inputs) {
-                    // find which passes write to the input
-                    for (int i = 0; i < passes.size(); i++) {
-                        for (auto &write: passes[i].outputs) {
-                            if (write.resourceName == input.resourceName) {
-                                passes[passIdx].dependencies.push_back(&passes[i]);
-                            }
-                        }
-                    }
+                for (auto &output: pass.outputs) {
+                    output.resource = getResourceId(output.resourceName);
+                    compiler.write(passId, output.resource);
                 }
             }
-        }
-
-        void topologicallySortPasses() {
-            // Clear the sorted list.
-            topologicallySortedPasses.clear();
-
-            // Map each pass to its in-degree (number of incoming dependencies).
-            std::unordered_map<std::string, int> inDegree;
-            for (auto &node: passes) {
-                inDegree[node.name] = 0;
-            }
+            compiler.compile();
 
-            // For each node, for each dependency it has, increment its in-degree.
-            // (If node A depends on B then B must run before A, so A’s in-degree increases.)
-            for (auto &node: passes) {
-                for (auto dep: node.dependencies) {
-                    inDegree[node.name]++;
+            for (PassId passId = 0; passId < passes.size(); passId++) {
+                if (compiler.isPresenting(passId)) {
+                    passes[passId].flags |= RENDER_PASS_FLAGS_SWAPCHAIN_WRITE;
                 }
-            }
-
-            // Use a set to mark nodes that have been processed.
-            std::unordered_set<std::string> processed;
-
-            // We repeatedly scan the passes in their original order,
-            // picking those with in-degree zero (i.e. all dependencies satisfied).
-            bool foundNodeInPass = true;
-            while (processed.size() < passes.size() && foundNodeInPass) {
-                foundNodeInPass = false;
-                // Iterate over passes in original order.
-                for (auto &node: passes) {
-                    // If this node has not been processed and has in-degree zero, process it.
-                    if (processed.find(node.name) == processed.end() && inDegree[node.name] == 0) {
-                        topologicallySortedPasses.push_back(&node);
-                        processed.insert(node.name);
-                        foundNodeInPass = true;
-                        // "Remove" this node: for every other node, if it depends on the current node, decrement its in-degree.
-                        for (auto &other: passes) {
-                            // Check if 'other' depends on 'node'
-                            for (auto *dep: other.dependencies) {
-                                if (dep->name == node.name) {
-                                    inDegree[other.name]--;
-                                }
-                            }
-                        }
-                    }
+                if (compiler.isContributing(passId)) {
+                    passes[passId].flags |= RENDER_PASS_FLAGS_CONTRIBUTING;
                 }
             }
+            Logger::log(LOG_LEVEL_DEBUG, "Purged %d non-contributing passes\n", compiler.getPurgedPassCount());
 
-            // If we haven't processed all nodes, there is a cycle.
-            ASSERT(processed.size() == passes.size(), "This graf is NOT ACYCLIC! This should not happen!");
+            topologicallySortedPasses.clear();
+            for (PassId passId: compiler.getSortedPasses()) {
+                topologicallySortedPasses.push_back(&passes[passId]);
+            }
 
             // Log the resulting order.
             Logger::log(LOG_LEVEL_DEBUG, "Topological order: ");
@@ -738,61 +733,109 @@ namespace hammock {
                 Logger::log(LOG_LEVEL_DEBUG, " \"%s\" -> ", topologicallySortedPasses[i]->name.c_str());
             }
             Logger::log(LOG_LEVEL_DEBUG, " PRESENT\n");
+
+            for (const auto &compiledGroup: compiler.getSubmissionGroups()) {
+                SubmissionGroup group;
+                group.queueFamily = compiledGroup.queueFamily;
+                group.globalStartIndex = compiledGroup.globalStartIndex;
+                for (PassId passId: compiledGroup.passes) {
+                    group.renderPassNodes.push_back(&passes[passId]);
+                }
+                groupsByQueue[group.queueFamily].push_back(std::move(group));
+            }
         }
 
-        bool needsNewGroup(const SubmissionGroup &currentGroup,
-                           RenderPassNode *newPass,
-                           size_t globalIndex) {
-            // For the very first pass (globalIndex==0), no group exists yet so no need to split.
-            if (globalIndex == 0)
-                return false;
+        /**
+         * Computes lifetimes of the transient images over the sorted passes and places them into shared heaps, one set
+         * of heaps per frame in flight as frames overlap on the GPU. Logs the memory with and without aliasing.
+         */
+        void placeTransientResources() {
+            const VkExtent2D swapChainExtent = fm.getSwapChain()->getSwapChainExtent();
+            TransientAllocator allocator;
+            std::vector<ResourceId> placed;
+            std::vector<ImageDesc> descriptions;
+            for (ResourceId resourceId = 0; resourceId < resources.size(); resourceId++) {
+                ResourceNode &resource = resources[resourceId];
+                if (!resource.isTransient() || compiler.getFirstUse(resourceId) == INVALID_GRAPH_ID) {
+                    continue;
+                }
+                ImageDesc desc = resource.transientDescription(swapChainExtent);
+                ASSERT(desc.memoryFlags == VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "Transient images are device local");
+                VkMemoryRequirements requirements = Image(device, 0, resource.name, desc).getMemoryRequirements();
+                allocator.addResource(requirements.size, requirements.alignment, requirements.memoryTypeBits,
+                                      compiler.getFirstUse(resourceId), compiler.getLastUse(resourceId));
+                placed.push_back(resourceId);
+                descriptions.push_back(std::move(desc));
+            }
+            if (placed.empty()) {
+                return;
+            }
+            allocator.place();
+
+            const auto &heaps = allocator.getHeaps();
+            for (int frameIndex = 0; frameIndex < SwapChain::MAX_FRAMES_IN_FLIGHT; frameIndex++) {
+                for (const auto &heap: heaps) {
+                    VkMemoryRequirements requirements = {
+                        .size = heap.size, .alignment = heap.alignment, .memoryTypeBits = heap.memoryTypeBits
+                    };
+                    VmaAllocationCreateInfo allocInfo = {};
+                    allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+                    VmaAllocation allocation = VK_NULL_HANDLE;
+                    checkResult(vmaAllocateMemory(device.allocator(), &requirements, &allocInfo, &allocation, nullptr));
+                    transientHeaps.push_back(allocation);
+                }
 
-            // Rule 1: Check if the immediately preceding pass in global order is of a different queue.
-            // If so, newPass is not contiguous with the previous work on the same queue.
-            if (topologicallySortedPasses[globalIndex - 1]->type != newPass->type)
-                return true;
-
-            // Rule 2: Check if newPass depends on any pass that is NOT in the current submission group.
-            // (This would signal that newPass is waiting on work that was separated by an inter-queue dependency.)
-            for (RenderPassNode *dep: newPass->dependencies) {
-                // If a dependency is not found among the passes already recorded in the current group,
-                // then we require a new submission group.
-                if (std::find(currentGroup.renderPassNodes.begin(),
-                              currentGroup.renderPassNodes.end(),
-                              dep) == currentGroup.renderPassNodes.end()) {
-                    return true;
+                for (uint32_t i = 0; i < placed.size(); i++) {
+                    ResourceNode &resource = resources[placed[i]];
+                    const TransientAllocator::Placement &placement = allocator.getPlacement(i);
+                    ImageDesc desc = descriptions[i];
+                    desc.aliasingAllocation = transientHeaps[frameIndex * heaps.size() + placement.heap];
+                    desc.aliasingOffset = placement.offset;
+                    ResourceHandle handle = rm.createResource<Image>(resource.name, desc);
+                    transientImages.push_back(handle);
+
+                    resource.cachedHandles.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+                    resource.isDirty = false;
+                    resource.cachedHandles[frameIndex] = handle;
                 }
             }
 
-            // Otherwise, the candidate pass can be merged into the current group.
-            return false;
+            for (uint32_t i = 0; i < placed.size(); i++) {
+                PassId firstPass = compiler.getSortedPasses()[compiler.getFirstUse(placed[i])];
+                passes[firstPass].acquiredTransients.push_back(placed[i]);
+            }
+
+            constexpr double megabyte = 1024.0 * 1024.0;
+            Logger::log(LOG_LEVEL_DEBUG,
+                        "Transient images: %d, dedicated %.1f MB, aliased %.1f MB in %d heaps, alive at peak %.1f MB "
+                        "(per frame in flight)\n", static_cast<int>(placed.size()),
+                        allocator.getDedicatedSize() / megabyte, allocator.getAliasedSize() / megabyte,
+                        static_cast<int>(heaps.size()), allocator.getPeakLiveSize() / megabyte);
         }
 
-        void groupPassesBySubmissionGroup() {
-            // Iterate through the global sorted list.
-            for (size_t i = 0; i < topologicallySortedPasses.size(); ++i) {
-                RenderPassNode *pass = topologicallySortedPasses[i];
-                CommandQueueFamily qf = pass->type;
-
-                // Create an initial group for this queue family if needed.
-                if (groupsByQueue[qf].empty()) {
-                    SubmissionGroup newGroup;
-                    newGroup.queueFamily = qf;
-                    newGroup.globalStartIndex = i; // first pass in this group.
-                    groupsByQueue[qf].push_back(newGroup);
-                } else {
-                    // Get the last submission group for this queue family.
-                    SubmissionGroup &currentGroup = groupsByQueue[qf].back();
-                    if (needsNewGroup(currentGroup, pass, i)) {
-                        SubmissionGroup newGroup;
-                        newGroup.queueFamily = qf;
-                        newGroup.globalStartIndex = i;
-                        groupsByQueue[qf].push_back(newGroup);
+        /**
+         * Discards the content of transient images at the start of their lifetime. Their memory was used by other
+         * images in between, so all previous access to it has to finish before the image starts being used.
+         * @param pass Render pass
+         */
+        void acquireTransientResources(RenderPassNode *pass, VkCommandBuffer commandBuffer) {
+            for (ResourceId resourceId: pass->acquiredTransients) {
+                VkImageLayout layout = VK_IMAGE_LAYOUT_GENERAL;
+                for (const auto *accesses: {&pass->outputs, &pass->inputs}) {
+                    for (const auto &access: *accesses) {
+                        if (access.resource == resourceId && access.requiredLayout != VK_IMAGE_LAYOUT_UNDEFINED) {
+                            layout = access.requiredLayout;
+                        }
                     }
                 }
 
-                // Add the current pass to the latest submission group for its queue.
-                groupsByQueue[qf].back().renderPassNodes.push_back(pass);
+                Image *image = rm.getResource<Image>(resources[resourceId].resolve(rm, fm.getFrameIndex()));
+                image->pipelineBarrier(commandBuffer,
+                                       VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_WRITE_BIT,
+                                       VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                                       VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
+                                       VK_IMAGE_LAYOUT_UNDEFINED, layout,
+                                       VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED);
             }
         }
 
@@ -896,17 +939,12 @@ namespace hammock {
          * Compiles the render graph - analyzes dependencies and makes optimization
          */
         void build() {
-            // First we purge passes that do not contribute to the final image
-            purgeNonContributingPasses();
+            // Purge passes that do not contribute to the final image, detect dependencies between the rest, sort them
+            // topologically and group them into submission groups
+            analyzeDependencies();
 
-            // Detect and fill dependencies between passes
-            detectDependencies();
-
-            // Topologically sort the passes
-            topologicallySortPasses();
-
-            // Group passes into submission groups
-            groupPassesBySubmissionGroup();
+            // Place transient images that are not alive at the same time into shared memory
+            placeTransientResources();
 
             // Sort passes in optimal execution order
             sortPassesByExecutionOrder();
@@ -928,6 +966,9 @@ namespace hammock {
             // Create descriptors
             for (int passIdx = 0; passIdx < passes.size(); passIdx++) {
                 RenderPassNode &passNode = passes[passIdx];
+                if (!(passNode.flags & RENDER_PASS_FLAGS_CONTRIBUTING)) {
+                    continue;
+                }
                 for (auto &descInfo: passNode.descriptorLayoutInfos) {
                     // Create a descriptor set layout
                     uint32_t setIndex = descInfo.first;
@@ -936,11 +977,9 @@ namespace hammock {
                         // No arrays yet
                         ASSERT(binding.bindingNames.size() == 1,
                                "Only one binding name per binding supported as of now!");
-                        ASSERT(resources.contains(binding.bindingNames.at(0)),
+                        ASSERT(resourceIds.contains(binding.bindingNames.at(0)),
                                "Binding name does not reference existing resource!");
 
-                        ResourceNode &resourceNode = resources[binding.bindingNames.at(0)];
-
                         descriptorSetLayoutBuilder.addBinding(binding.bindingIndex, binding.descriptorType,
                                                               binding.stageFlags,
                                                               binding.bindingNames.size(), binding.bindingFlags);
@@ -961,7 +1000,8 @@ namespace hammock {
                         std::unordered_map<uint32_t, VkDescriptorImageInfo> imageInfos;
 
                         for (auto &binding: desc) {
-                            ResourceNode &resourceNode = resources[binding.bindingNames.at(0)];
+                            const ResourceId resourceId = resourceIds.at(binding.bindingNames.at(0));
+                            ResourceNode &resourceNode = resources[resourceId];
 
                             if (resourceNode.isBuffer()) {
                                 auto *buffer = rm.getResource<Buffer>(
@@ -980,12 +1020,12 @@ namespace hammock {
                                 // Find the sampler that should be used
                                 auto result = std::find_if(passNode.inputs.begin(), passNode.inputs.end(),
                                                            [&](ResourceAccess access) {
-                                                               return access.resourceName == resourceNode.name;
+                                                               return access.resource == resourceId;
                                                            });
                                 if (result == passNode.inputs.end()) {
                                     result = std::find_if(passNode.outputs.begin(), passNode.outputs.end(),
                                                           [&](ResourceAccess access) {
-                                                              return access.resourceName == resourceNode.name;
+                                                              return access.resource == resourceId;
                                                           });
                                     ASSERT(result != passNode.outputs.end(), "WTF?");
                                 }
@@ -1025,20 +1065,18 @@ namespace hammock {
         void applyPipelineBarriers(RenderPassNode *pass, VkCommandBuffer commandBuffer,
                                    PipelineBarrier::TransitionStage stage) {
             for (auto &access: pass->outputs) {
-                ASSERT(resources.find(access.resourceName) != resources.end(),
-                       "Could not find the output");
+                ASSERT(access.resource != INVALID_GRAPH_ID, "Could not find the output");
 
-                ResourceNode &resourceNode = resources[access.resourceName];
+                ResourceNode &resourceNode = resources[access.resource];
                 PipelineBarrier barrier(rm, fm, commandBuffer, resourceNode, access, stage);
                 if (barrier.isNeeded()) {
                     barrier.apply();
                 }
             }
             for (auto &access: pass->inputs) {
-                ASSERT(resources.find(access.resourceName) != resources.end(),
-                       "Could not find the output");
+                ASSERT(access.resource != INVALID_GRAPH_ID, "Could not find the output");
 
-                ResourceNode &resourceNode = resources[access.resourceName];
+                ResourceNode &resourceNode = resources[access.resource];
                 PipelineBarrier barrier(rm, fm, commandBuffer, resourceNode, access, stage);
                 if (barrier.isNeeded()) {
                     barrier.apply();
@@ -1054,7 +1092,7 @@ namespace hammock {
         std::vector<VkRenderingAttachmentInfo> collectColorAttachmentInfos(RenderPassNode *pass) {
             std::vector<VkRenderingAttachmentInfo> colorAttachments;
             for (auto &access: pass->outputs) {
-                ResourceNode &node = resources[access.resourceName];
+                ResourceNode &node = resources[access.resource];
                 if (node.isSwapChainImage() && node.isColorAttachment()) {
                     VkRenderingAttachmentInfo attachmentInfo{};
                     attachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
@@ -1086,7 +1124,7 @@ namespace hammock {
          */
         std::optional<VkRenderingAttachmentInfo> collectDepthStencilAttachmentInfo(RenderPassNode *pass) {
             for (auto &access: pass->outputs) {
-                ResourceNode &node = resources[access.resourceName];
+                ResourceNode &node = resources[access.resource];
                 if (node.isDepthAttachment()) {
                     ASSERT(node.resolver, "Resolver is nullptr!");
                     ResourceHandle handle = node.resolve(rm, fm.getFrameIndex());
@@ -1107,19 +1145,17 @@ namespace hammock {
 
             // Fill the context with input resources
             for (auto &access: pass->inputs) {
-                ASSERT(resources.find(access.resourceName) != resources.end(),
-                       "Could not find the input");
-                ResourceNode &resourceNode = resources[access.resourceName];
+                ASSERT(access.resource != INVALID_GRAPH_ID, "Could not find the input");
+                ResourceNode &resourceNode = resources[access.resource];
                 // TODO automatically find out next render pass using this resource and set final layout of the attachment to the requiredLayout to save one barrier
-                context.inputs.emplace(resourceNode.name, &resources[access.resourceName]);
+                context.inputs.emplace(resourceNode.name, &resources[access.resource]);
             }
 
             // fill context with input resources
             for (auto &access: pass->outputs) {
-                ASSERT(resources.find(access.resourceName) != resources.end(),
-                       "Could not find the output");
-                ResourceNode &resourceNode = resources[access.resourceName];
-                context.outputs.emplace(resourceNode.name, &resources[access.resourceName]);
+                ASSERT(access.resource != INVALID_GRAPH_ID, "Could not find the output");
+                ResourceNode &resourceNode = resources[access.resource];
+                context.outputs.emplace(resourceNode.name, &resources[access.resource]);
             }
 
             // fill context with descriptor sets
@@ -1236,6 +1272,9 @@ namespace hammock {
 
                     // Exectue all passes from the group
                     for (int i = 0; i < group->renderPassNodes.size(); i++) {
+                        // Aliasing barriers of transient images starting their lifetime
+                        acquireTransientResources(group->renderPassNodes[i], commandBuffer);
+
                         // Pre pass barriers
                         applyPipelineBarriers(group->renderPassNodes[i], commandBuffer,
                                               PipelineBarrier::TransitionStage::RequiredLayout);
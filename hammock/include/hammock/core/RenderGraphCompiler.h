@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "hammock/core/Types.h"
+
+namespace hammock {
+    // Dense handles of the render graph resources and passes, interned in the order they are added
+    typedef uint32_t ResourceId;
+    typedef uint32_t PassId;
+    constexpr uint32_t INVALID_GRAPH_ID = UINT32_MAX;
+
+    /**
+     * Dependency analysis of the render graph over dense integer handles. Purges the passes that do not contribute to
+     * a presented resource, connects every read with the writers of the resource, sorts the passes topologically and
+     * splits them into submission groups, all in O(passes + accesses + edges).
+     * It does not touch the device, so graphs can be compiled and benchmarked on the CPU alone.
+     */
+    class RenderGraphCompiler {
+    public:
+        struct SubmissionGroup {
+            CommandQueueFamily queueFamily;
+            size_t globalStartIndex; // Position of the first pass of the group in the sorted order
+            std::vector<PassId> passes;
+        };
+
+        /**
+         * @param presented Resource is presented (swapchain image), its writers and everything they read contribute
+         */
+        ResourceId addResource(bool presented = false);
+
+        PassId addPass(CommandQueueFamily queueFamily);
+
+        void read(PassId pass, ResourceId resource);
+
+        void write(PassId pass, ResourceId resource);
+
+        /**
+         * Analyzes the graph. Passes keep the order they were added in wherever the dependencies allow it,
+         * which is the order the previous scan based sort produced.
+         */
+        void compile();
+
+        uint32_t getResourceCount() const { return static_cast<uint32_t>(presentedResources.size()); }
+        uint32_t getPassCount() const { return static_cast<uint32_t>(queueFamilies.size()); }
+        CommandQueueFamily getQueueFamily(PassId pass) const { return queueFamilies[pass]; }
+
+        // Results of compile()
+        bool isContributing(PassId pass) const { return contributing[pass]; }
+        bool isPresenting(PassId pass) const { return presenting[pass]; }
+        uint32_t getPurgedPassCount() const { return getPassCount() - static_cast<uint32_t>(sortedPasses.size()); }
+        const std::vector<PassId> &getSortedPasses() const { return sortedPasses; }
+        const std::vector<SubmissionGroup> &getSubmissionGroups() const { return groups; }
+        size_t getEdgeCount() const { return dependencies.size(); }
+        // Positions of the first and last contributing pass accessing the resource in the sorted order, both are
+        // INVALID_GRAPH_ID when no contributing pass accesses it
+        uint32_t getFirstUse(ResourceId resource) const { return firstUses[resource]; }
+        uint32_t getLastUse(ResourceId resource) const { return lastUses[resource]; }
+
+        // Passes the pass waits for, one entry per read of a written resource
+        std::span<const PassId> getDependencies(PassId pass) const {
+            return {dependencies.data() + dependencyOffsets[pass], dependencies.data() + dependencyOffsets[pass + 1]};
+        }
+
+    private:
+        struct Access {
+            PassId pass;
+            ResourceId resource;
+        };
+
+        std::vector<uint8_t> presentedResources;
+        std::vector<CommandQueueFamily> queueFamilies;
+        std::vector<Access> reads;
+        std::vector<Access> writes;
+
+        std::vector<uint8_t> contributing;
+        std::vector<uint8_t> presenting;
+        // Dependencies of pass p are dependencies[dependencyOffsets[p]] to dependencies[dependencyOffsets[p + 1]]
+        std::vector<uint32_t> dependencyOffsets;
+        std::vector<PassId> dependencies;
+        std::vector<PassId> sortedPasses;
+        std::vector<SubmissionGroup> groups;
+        std::vector<uint32_t> firstUses;
+        std::vector<uint32_t> lastUses;
+
+        void purgeNonContributingPasses(const std::vector<uint32_t> &writerOffsets, const std::vector<PassId> &writers,
+                                        const std::vector<uint32_t> &readOffsets,
+                                        const std::vector<ResourceId> &readResources);
+
+        void detectDependencies(const std::vector<uint32_t> &writerOffsets, const std::vector<PassId> &writers,
+                                const std::vector<uint32_t> &readOffsets, const std::vector<ResourceId> &readResources);
+
+        void topologicallySortPasses();
+
+        void groupPassesBySubmissionGroup();
+
+        void computeLifetimes();
+    };
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace hammock {
+    /**
+     * Places transient resources into shared memory heaps. Resources whose lifetimes, given as positions in the sorted
+     * pass order, do not overlap may occupy the same memory. Resources only share a heap when their memory type bits
+     * are equal. Resources are placed largest first at the lowest offset free over their whole lifetime.
+     * It works on sizes alone and does not touch the device, so placements can be computed and checked on the CPU.
+     */
+    class TransientAllocator {
+    public:
+        struct Placement {
+            uint32_t heap;
+            uint64_t offset;
+        };
+
+        struct Heap {
+            uint32_t memoryTypeBits;
+            uint64_t size;
+            uint64_t alignment; // Largest alignment of the placed resources
+        };
+
+        /**
+         * @param firstUse Position of the first pass using the resource
+         * @param lastUse Position of the last pass using the resource, inclusive
+         * @return Index of the resource
+         */
+        uint32_t addResource(uint64_t size, uint64_t alignment, uint32_t memoryTypeBits, uint32_t firstUse,
+                             uint32_t lastUse);
+
+        void place();
+
+        uint32_t getResourceCount() const { return static_cast<uint32_t>(resources.size()); }
+
+        // Results of place()
+        const Placement &getPlacement(uint32_t resource) const { return placements[resource]; }
+        const std::vector<Heap> &getHeaps() const { return heaps; }
+
+        // Memory the resources would take with dedicated allocations
+        uint64_t getDedicatedSize() const;
+
+        // Memory of all heaps
+        uint64_t getAliasedSize() const;
+
+        // Largest sum of sizes of the resources alive at the same time, lower bound of the aliased size
+        uint64_t getPeakLiveSize() const;
+
+        // Checks that every resource is aligned, fits its heap and shares no memory with resources alive with it
+        bool isValid() const;
+
+    private:
+        struct Resource {
+            uint64_t size;
+            uint64_t alignment;
+            uint32_t memoryTypeBits;
+            uint32_t firstUse;
+            uint32_t lastUse;
+        };
+
+        std::vector<Resource> resources;
+        std::vector<Placement> placements;
+        std::vector<Heap> heaps;
+    };
+}
@@ -151,6 +151,9 @@ namespace hammock {
         VkSharingMode sharingMode = VK_SHARING_MODE_EXCLUSIVE;
         VkMemoryPropertyFlags memoryFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
         VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL;
+        // Memory the image is placed into instead of its own allocation, owned by someone else (render graph heaps)
+        VmaAllocation aliasingAllocation = VK_NULL_HANDLE;
+        VkDeviceSize aliasingOffset = 0;
     };
 
     struct SamplerDesc {
@@ -1,4 +1,5 @@
 #include "hammock/core/ComputePipeline.h"
+#include "hammock/utils/Initializers.h"
 
 hammock::ComputePipeline::ComputePipeline(const ComputePipelineCreateInfo &config) : device(config.device),
     pipeline(VK_NULL_HANDLE),
@@ -27,6 +28,15 @@ hammock::ComputePipeline::ComputePipeline(const ComputePipelineCreateInfo &confi
     shaderStageInfo.module = computeShaderModule;
     shaderStageInfo.pName = config.computeShader.entryFunc.c_str();
 
+    // Specialization constants are consumed when the pipeline is created, the info only has to outlive that call
+    VkSpecializationInfo specializationInfo{};
+    if (!config.computeShader.specializationMapEntries.empty()) {
+        specializationInfo = Init::specializationInfo(config.computeShader.specializationMapEntries,
+                                                      config.computeShader.specializationData.size(),
+                                                      config.computeShader.specializationData.data());
+        shaderStageInfo.pSpecializationInfo = &specializationInfo;
+    }
+
     // Create the compute pipeline.
     VkComputePipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
@@ -0,0 +1,231 @@
+#include "hammock/core/RenderGraphCompiler.h"
+
+#include <algorithm>
+
+namespace {
+    /**
+     * Groups values by key in compressed rows, values of key k end up in values[offsets[k]] to values[offsets[k + 1]]
+     * in the order they were visited. Counting sort, linear in the number of keys and values.
+     */
+    template<typename KeyFunction, typename ValueFunction>
+    void buildRows(uint32_t keyCount, size_t count, KeyFunction key, ValueFunction value,
+                   std::vector<uint32_t> &offsets, std::vector<uint32_t> &values) {
+        offsets.assign(keyCount + 1, 0);
+        for (size_t i = 0; i < count; i++) {
+            offsets[key(i) + 1]++;
+        }
+        for (uint32_t k = 0; k < keyCount; k++) {
+            offsets[k + 1] += offsets[k];
+        }
+        values.resize(count);
+        std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < count; i++) {
+            values[cursors[key(i)]++] = value(i);
+        }
+    }
+}
+
+hammock::ResourceId hammock::RenderGraphCompiler::addResource(bool presented) {
+    presentedResources.push_back(presented);
+    return static_cast<ResourceId>(presentedResources.size() - 1);
+}
+
+hammock::PassId hammock::RenderGraphCompiler::addPass(CommandQueueFamily queueFamily) {
+    queueFamilies.push_back(queueFamily);
+    return static_cast<PassId>(queueFamilies.size() - 1);
+}
+
+void hammock::RenderGraphCompiler::read(PassId pass, ResourceId resource) {
+    ASSERT(pass < getPassCount() && resource < getResourceCount(), "Access of an unknown pass or resource");
+    reads.push_back({pass, resource});
+}
+
+void hammock::RenderGraphCompiler::write(PassId pass, ResourceId resource) {
+    ASSERT(pass < getPassCount() && resource < getResourceCount(), "Access of an unknown pass or resource");
+    writes.push_back({pass, resource});
+}
+
+void hammock::RenderGraphCompiler::compile() {
+    // Writers of each resource and resources read by each pass, in the order the accesses were declared
+    std::vector<uint32_t> writerOffsets, readOffsets;
+    std::vector<PassId> writers;
+    std::vector<ResourceId> readResources;
+    buildRows(getResourceCount(), writes.size(), [&](size_t i) { return writes[i].resource; },
+              [&](size_t i) { return writes[i].pass; }, writerOffsets, writers);
+    buildRows(getPassCount(), reads.size(), [&](size_t i) { return reads[i].pass; },
+              [&](size_t i) { return reads[i].resource; }, readOffsets, readResources);
+
+    purgeNonContributingPasses(writerOffsets, writers, readOffsets, readResources);
+    detectDependencies(writerOffsets, writers, readOffsets, readResources);
+    topologicallySortPasses();
+    groupPassesBySubmissionGroup();
+    computeLifetimes();
+}
+
+void hammock::RenderGraphCompiler::purgeNonContributingPasses(const std::vector<uint32_t> &writerOffsets,
+                                                              const std::vector<PassId> &writers,
+                                                              const std::vector<uint32_t> &readOffsets,
+                                                              const std::vector<ResourceId> &readResources) {
+    contributing.assign(getPassCount(), false);
+    presenting.assign(getPassCount(), false);
+
+    // Writers of presented resources contribute
+    std::vector<PassId> worklist;
+    for (const Access &write: writes) {
+        if (presentedResources[write.resource] && !presenting[write.pass]) {
+            presenting[write.pass] = true;
+            contributing[write.pass] = true;
+            worklist.push_back(write.pass);
+        }
+    }
+
+    // Traverse upwards, each writer of a resource read by a contributing pass contributes as well
+    while (!worklist.empty()) {
+        PassId pass = worklist.back();
+        worklist.pop_back();
+        for (uint32_t r = readOffsets[pass]; r < readOffsets[pass + 1]; r++) {
+            const ResourceId resource = readResources[r];
+            for (uint32_t w = writerOffsets[resource]; w < writerOffsets[resource + 1]; w++) {
+                if (!contributing[writers[w]]) {
+                    contributing[writers[w]] = true;
+                    worklist.push_back(writers[w]);
+                }
+            }
+        }
+    }
+}
+
+void hammock::RenderGraphCompiler::detectDependencies(const std::vector<uint32_t> &writerOffsets,
+                                                      const std::vector<PassId> &writers,
+                                                      const std::vector<uint32_t> &readOffsets,
+                                                      const std::vector<ResourceId> &readResources) {
+    // Every writer of every input, writers of inputs of contributing passes are contributing themselves
+    dependencyOffsets.assign(getPassCount() + 1, 0);
+    dependencies.clear();
+    for (PassId pass = 0; pass < getPassCount(); pass++) {
+        if (contributing[pass]) {
+            for (uint32_t r = readOffsets[pass]; r < readOffsets[pass + 1]; r++) {
+                const ResourceId resource = readResources[r];
+                dependencies.insert(dependencies.end(), writers.begin() + writerOffsets[resource],
+                                    writers.begin() + writerOffsets[resource + 1]);
+            }
+        }
+        dependencyOffsets[pass + 1] = static_cast<uint32_t>(dependencies.size());
+    }
+}
+
+void hammock::RenderGraphCompiler::topologicallySortPasses() {
+    const uint32_t passCount = getPassCount();
+
+    // Passes waiting for each pass
+    std::vector<uint32_t> dependentOffsets(passCount + 1, 0);
+    std::vector<PassId> dependents;
+    std::vector<PassId> edgePasses(dependencies.size());
+    for (PassId pass = 0; pass < passCount; pass++) {
+        std::fill(edgePasses.begin() + dependencyOffsets[pass], edgePasses.begin() + dependencyOffsets[pass + 1],
+                  pass);
+    }
+    buildRows(passCount, dependencies.size(), [&](size_t i) { return dependencies[i]; },
+              [&](size_t i) { return edgePasses[i]; }, dependentOffsets, dependents);
+
+    // Kahn's algorithm. Passes used to be picked by repeated scans in the order they were added, a pass is picked in
+    // the first scan that reaches it with all its dependencies done. That scan is derived from the dependencies here:
+    // a dependency added before the pass is done earlier in the same scan, one added after it only in the scan before.
+    std::vector<uint32_t> inDegree(passCount);
+    std::vector<uint32_t> scan(passCount, 0);
+    std::vector<PassId> ready;
+    uint32_t contributingCount = 0;
+    for (PassId pass = 0; pass < passCount; pass++) {
+        if (!contributing[pass]) {
+            continue;
+        }
+        contributingCount++;
+        inDegree[pass] = dependencyOffsets[pass + 1] - dependencyOffsets[pass];
+        if (inDegree[pass] == 0) {
+            ready.push_back(pass);
+        }
+    }
+
+    uint32_t scanCount = 0;
+    for (size_t i = 0; i < ready.size(); i++) {
+        const PassId pass = ready[i];
+        for (PassId dependency: getDependencies(pass)) {
+            scan[pass] = std::max(scan[pass], scan[dependency] + (dependency > pass ? 1 : 0));
+        }
+        scanCount = std::max(scanCount, scan[pass] + 1);
+        for (uint32_t d = dependentOffsets[pass]; d < dependentOffsets[pass + 1]; d++) {
+            if (--inDegree[dependents[d]] == 0) {
+                ready.push_back(dependents[d]);
+            }
+        }
+    }
+
+    // If we haven't processed all nodes, there is a cycle.
+    ASSERT(ready.size() == contributingCount, "This graf is NOT ACYCLIC! This should not happen!");
+
+    // Order by scan and by the order the passes were added within a scan
+    std::vector<PassId> scanPasses;
+    std::vector<uint32_t> scanOffsets;
+    buildRows(std::max(scanCount, 1u), passCount, [&](size_t pass) { return contributing[pass] ? scan[pass] : 0; },
+              [&](size_t pass) { return static_cast<PassId>(pass); }, scanOffsets, scanPasses);
+    sortedPasses.clear();
+    sortedPasses.reserve(contributingCount);
+    for (PassId pass: scanPasses) {
+        if (contributing[pass]) {
+            sortedPasses.push_back(pass);
+        }
+    }
+}
+
+void hammock::RenderGraphCompiler::groupPassesBySubmissionGroup() {
+    groups.clear();
+    std::vector<uint32_t> groupOfPass(getPassCount(), INVALID_GRAPH_ID);
+    // Last group of each queue family, indexed by CommandQueueFamily
+    std::array<uint32_t, 4> lastGroups;
+    lastGroups.fill(INVALID_GRAPH_ID);
+
+    for (size_t i = 0; i < sortedPasses.size(); i++) {
+        const PassId pass = sortedPasses[i];
+        const CommandQueueFamily queueFamily = queueFamilies[pass];
+        uint32_t &lastGroup = lastGroups[static_cast<size_t>(queueFamily)];
+
+        bool needsNewGroup = lastGroup == INVALID_GRAPH_ID;
+        if (!needsNewGroup && i > 0) {
+            // Pass is not contiguous with the previous work on the same queue
+            needsNewGroup = queueFamilies[sortedPasses[i - 1]] != queueFamily;
+            // Pass waits for work outside of the group, separated by an inter-queue dependency
+            for (PassId dependency: getDependencies(pass)) {
+                needsNewGroup = needsNewGroup || groupOfPass[dependency] != lastGroup;
+            }
+        }
+        if (needsNewGroup) {
+            groups.push_back({.queueFamily = queueFamily, .globalStartIndex = i, .passes = {}});
+            lastGroup = static_cast<uint32_t>(groups.size() - 1);
+        }
+
+        groups[lastGroup].passes.push_back(pass);
+        groupOfPass[pass] = lastGroup;
+    }
+}
+
+void hammock::RenderGraphCompiler::computeLifetimes() {
+    std::vector<uint32_t> positions(getPassCount(), INVALID_GRAPH_ID);
+    for (uint32_t i = 0; i < sortedPasses.size(); i++) {
+        positions[sortedPasses[i]] = i;
+    }
+
+    firstUses.assign(getResourceCount(), INVALID_GRAPH_ID);
+    lastUses.assign(getResourceCount(), INVALID_GRAPH_ID);
+    for (const std::vector<Access> *accesses: {&reads, &writes}) {
+        for (const Access &access: *accesses) {
+            const uint32_t position = positions[access.pass];
+            if (position == INVALID_GRAPH_ID) {
+                continue;
+            }
+            uint32_t &firstUse = firstUses[access.resource];
+            uint32_t &lastUse = lastUses[access.resource];
+            firstUse = firstUse == INVALID_GRAPH_ID ? position : std::min(firstUse, position);
+            lastUse = lastUse == INVALID_GRAPH_ID ? position : std::max(lastUse, position);
+        }
+    }
+}
@@ -0,0 +1,120 @@
+#include "hammock/core/TransientAllocator.h"
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+#include "hammock/core/CoreUtils.h"
+
+uint32_t hammock::TransientAllocator::addResource(uint64_t size, uint64_t alignment, uint32_t memoryTypeBits,
+                                                  uint32_t firstUse, uint32_t lastUse) {
+    ASSERT(firstUse <= lastUse, "Lifetime of a transient resource ends before it starts");
+    ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0, "Alignment has to be a power of two");
+    resources.push_back({size, alignment, memoryTypeBits, firstUse, lastUse});
+    return static_cast<uint32_t>(resources.size() - 1);
+}
+
+void hammock::TransientAllocator::place() {
+    placements.assign(resources.size(), {0, 0});
+    heaps.clear();
+
+    // Largest first, so small resources fill the gaps next to the large ones
+    std::vector<uint32_t> order(resources.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return resources[a].size > resources[b].size;
+    });
+
+    std::unordered_map<uint32_t, uint32_t> heapOfMemoryTypes;
+    std::vector<std::vector<uint32_t> > placedInHeap;
+    std::vector<std::pair<uint64_t, uint64_t> > occupied;
+    for (uint32_t index: order) {
+        const Resource &resource = resources[index];
+        auto [it, inserted] = heapOfMemoryTypes.try_emplace(resource.memoryTypeBits,
+                                                            static_cast<uint32_t>(heaps.size()));
+        if (inserted) {
+            heaps.push_back({.memoryTypeBits = resource.memoryTypeBits, .size = 0, .alignment = 1});
+            placedInHeap.emplace_back();
+        }
+        const uint32_t heap = it->second;
+
+        // Memory ranges of the resources alive at the same time
+        occupied.clear();
+        for (uint32_t other: placedInHeap[heap]) {
+            if (resources[other].firstUse <= resource.lastUse && resource.firstUse <= resources[other].lastUse) {
+                occupied.emplace_back(placements[other].offset, placements[other].offset + resources[other].size);
+            }
+        }
+        std::sort(occupied.begin(), occupied.end());
+
+        // Lowest aligned offset where the resource fits between the occupied ranges
+        uint64_t offset = 0;
+        for (const auto &[begin, end]: occupied) {
+            if (offset + resource.size <= begin) {
+                break;
+            }
+            offset = std::max(offset, alignSize(end, resource.alignment));
+        }
+
+        placements[index] = {heap, offset};
+        placedInHeap[heap].push_back(index);
+        heaps[heap].size = std::max(heaps[heap].size, offset + resource.size);
+        heaps[heap].alignment = std::max(heaps[heap].alignment, resource.alignment);
+    }
+}
+
+uint64_t hammock::TransientAllocator::getDedicatedSize() const {
+    uint64_t size = 0;
+    for (const Resource &resource: resources) {
+        size += resource.size;
+    }
+    return size;
+}
+
+uint64_t hammock::TransientAllocator::getAliasedSize() const {
+    uint64_t size = 0;
+    for (const Heap &heap: heaps) {
+        size += heap.size;
+    }
+    return size;
+}
+
+uint64_t hammock::TransientAllocator::getPeakLiveSize() const {
+    // Sweep over the lifetime boundaries, a resource stops being alive after its last use
+    std::vector<std::pair<uint64_t, int64_t> > events;
+    events.reserve(resources.size() * 2);
+    for (const Resource &resource: resources) {
+        events.emplace_back(static_cast<uint64_t>(resource.firstUse) * 2, static_cast<int64_t>(resource.size));
+        events.emplace_back(static_cast<uint64_t>(resource.lastUse) * 2 + 1, -static_cast<int64_t>(resource.size));
+    }
+    std::sort(events.begin(), events.end());
+
+    int64_t live = 0, peak = 0;
+    for (const auto &[position, delta]: events) {
+        live += delta;
+        peak = std::max(peak, live);
+    }
+    return static_cast<uint64_t>(peak);
+}
+
+bool hammock::TransientAllocator::isValid() const {
+    for (uint32_t a = 0; a < resources.size(); a++) {
+        const Placement &placement = placements[a];
+        if (placement.offset % resources[a].alignment != 0 ||
+            placement.offset + resources[a].size > heaps[placement.heap].size ||
+            resources[a].memoryTypeBits != heaps[placement.heap].memoryTypeBits) {
+            return false;
+        }
+        for (uint32_t b = a + 1; b < resources.size(); b++) {
+            const bool aliveTogether = resources[a].firstUse <= resources[b].lastUse &&
+                                       resources[b].firstUse <= resources[a].lastUse;
+            const bool sharedMemory = placements[b].heap == placement.heap &&
+                                      placements[b].offset < placement.offset + resources[a].size &&
+                                      placement.offset < placements[b].offset + resources[b].size;
+            if (aliveTogether && sharedMemory) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+
+#include <hammock/core/RenderGraphCompiler.h>
+#include <hammock/core/TransientAllocator.h>
+
+/**
+ * Builds a synthetic frame graph. Every pass writes one or two new resources and reads up to three resources written
+ * recently, like a chain of post processing passes with some history. Roughly every tenth output is a debug output
+ * nobody reads, so the purge has something to do. The last pass composes every output nobody read yet and presents.
+ */
+hammock::RenderGraphCompiler buildSyntheticGraph(uint32_t passCount, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    hammock::RenderGraphCompiler graph;
+    std::vector<hammock::ResourceId> produced;
+    std::vector<bool> consumed;
+
+    for (uint32_t i = 0; i + 1 < passCount; i++) {
+        const float queue = uniform(random);
+        const hammock::PassId pass = graph.addPass(queue < 0.7f
+                                                       ? hammock::CommandQueueFamily::Graphics
+                                                       : queue < 0.95f
+                                                             ? hammock::CommandQueueFamily::Compute
+                                                             : hammock::CommandQueueFamily::Transfer);
+        if (!produced.empty()) {
+            const uint32_t window = std::min<uint32_t>(static_cast<uint32_t>(produced.size()), 16);
+            const uint32_t readCount = random() % 4;
+            for (uint32_t r = 0; r < readCount; r++) {
+                const size_t input = produced.size() - 1 - random() % window;
+                graph.read(pass, produced[input]);
+                consumed[input] = true;
+            }
+        }
+        const uint32_t writeCount = 1 + random() % 2;
+        for (uint32_t w = 0; w < writeCount; w++) {
+            const hammock::ResourceId resource = graph.addResource();
+            graph.write(pass, resource);
+            if (uniform(random) > 0.1f) {
+                produced.push_back(resource);
+                consumed.push_back(false);
+            }
+        }
+    }
+
+    const hammock::PassId present = graph.addPass(hammock::CommandQueueFamily::Graphics);
+    for (size_t r = 0; r < produced.size(); r++) {
+        if (!consumed[r]) {
+            graph.read(present, produced[r]);
+        }
+    }
+    graph.write(present, graph.addResource(true));
+    return graph;
+}
+
+/**
+ * Places every image of the compiled graph as a transient one. Images are 4K RGBA16F targets at full, half or quarter
+ * resolution, the presented image is left out.
+ */
+hammock::TransientAllocator placeTransientImages(const hammock::RenderGraphCompiler &graph, uint32_t seed) {
+    constexpr uint64_t fullResolution = 3840ull * 2160ull * 8ull;
+    constexpr uint64_t alignment = 64 * 1024;
+    std::mt19937 random(seed);
+    hammock::TransientAllocator allocator;
+    for (hammock::ResourceId resource = 0; resource + 1 < graph.getResourceCount(); resource++) {
+        const uint64_t size = fullResolution >> (2 * (random() % 3));
+        if (graph.getFirstUse(resource) != hammock::INVALID_GRAPH_ID) {
+            allocator.addResource(size, alignment, 1, graph.getFirstUse(resource), graph.getLastUse(resource));
+        }
+    }
+    allocator.place();
+    return allocator;
+}
+
+int main(int argc, char *argv[]) {
+    constexpr uint32_t passCounts[] = {10, 100, 1000, 10000};
+    const uint32_t iterations = argc > 1 ? std::stoul(argv[1]) : 20;
+
+    std::cout << "passes, contributing, edges, submission groups, best ms, passes per second, "
+            "transient images, dedicated MB, aliased MB, alive at peak MB" << std::endl;
+    for (uint32_t passCount: passCounts) {
+        double best = std::numeric_limits<double>::max();
+        hammock::RenderGraphCompiler graph;
+        for (uint32_t i = 0; i < iterations; i++) {
+            graph = buildSyntheticGraph(passCount, passCount);
+            auto start = std::chrono::high_resolution_clock::now();
+            graph.compile();
+            auto end = std::chrono::high_resolution_clock::now();
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+
+        hammock::TransientAllocator allocator = placeTransientImages(graph, passCount);
+        if (!allocator.isValid()) {
+            std::cerr << "Transient images alive at the same time share memory" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        constexpr double megabyte = 1024.0 * 1024.0;
+        std::cout << passCount << ", " << graph.getSortedPasses().size() << ", " << graph.getEdgeCount() << ", "
+                << graph.getSubmissionGroups().size() << ", " << best * 1000.0 << ", "
+                << static_cast<double>(passCount) / best << ", " << allocator.getResourceCount() << ", "
+                << allocator.getDedicatedSize() / megabyte << ", " << allocator.getAliasedSize() / megabyte << ", "
+                << allocator.getPeakLiveSize() / megabyte << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
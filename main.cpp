@@ -1,5 +1,6 @@
 #include <iostream>
 #include <cstdint>
+#include <algorithm>
 #include <hammock/hammock.h>
 
 #include "medium/ParticipatingMediumScene.h"
@@ -15,6 +16,15 @@ int main(int argc, char * argv[]) {
     parser.addArgument<std::string>("scene", "Scene option: [medium, renderer]", false);
     parser.addArgument<std::string>("weather", "Weather map option: [stratus, stratocumulus, cumulus, nubis]", false);
     parser.addArgument<std::string>("terrain", "Terrain type: [default, mountain]", false);
+    parser.addArgument<std::string>("planet", "Atmosphere preset: [earth, mars, hazy]", false);
+    parser.addArgument<std::string>("lut-cache", "Directory of the atmosphere LUT and cloud noise cache, none disables the cache", false);
+    parser.addArgument<std::string>("quality", "Atmosphere LUT quality: [low, medium, high, ultra]", false);
+    parser.addArgument<int32_t>("sky-bank", "Number of sun elevations precomputed in the sky view bank, 0 disables it", false);
+    parser.addArgument<int32_t>("cloud-scale", "Clouds are ray-marched at the window resolution divided by: [1, 2, 4]", false);
+    parser.addArgument<int32_t>("quality-sweep", "Benchmarks every LUT quality tier for given number of frames and exits", false);
+    parser.addArgument<std::string>("cloud-quality", "Cloud ray-march quality: [low, medium, high, ultra]", false);
+    parser.addArgument<int32_t>("cloud-benchmark", "Benchmarks specialized and push constant cloud pipelines of every cloud quality for given number of frames and exits", false);
+    parser.addArgument<std::string>("cloud-capture", "Renders the clouds with the CPU reference settings, writes them into given directory and exits", false);
 
     try {
         parser.parse(argc, argv);
@@ -28,6 +38,15 @@ int main(int argc, char * argv[]) {
     auto selectedScene = parser.get<std::string>("scene");
     auto weatherMap = parser.get<std::string>("weather");
     auto terrain = parser.get<std::string>("terrain");
+    auto planet = parser.get<std::string>("planet");
+    auto lutCache = parser.get<std::string>("lut-cache");
+    auto quality = parser.get<std::string>("quality");
+    auto qualitySweepFrames = parser.get<int32_t>("quality-sweep");
+    auto skyBankLayers = parser.get<int32_t>("sky-bank");
+    auto cloudScale = parser.get<int32_t>("cloud-scale");
+    auto cloudQuality = parser.get<std::string>("cloud-quality");
+    auto cloudBenchmarkFrames = parser.get<int32_t>("cloud-benchmark");
+    auto cloudCaptureDirectory = parser.get<std::string>("cloud-capture");
 
     std::string sceneName = "renderer";
     if(!selectedScene.empty()){
@@ -47,14 +66,12 @@ int main(int argc, char * argv[]) {
     }
     else if (sceneName == "renderer") {
 #ifdef CLOUD_RENDER_SUBSAMPLE
-        std::cout << "Using subsampling when rendering clouds, note this is na experimental feature" << std::endl;
-#endif
-#ifdef HIGH_QUALITY_CLOUDS
-        std::cout << "Using high fidelity clouds. This is recommended only for powerfull GPUs" << std::endl;
+        std::cout << "Using temporal cloud rendering by default, it can be toggled in the debug window" << std::endl;
 #endif
 
         WeatherMap weatherMapEnum = WeatherMap::Stratocumulus;
         TerrainType terrainEnum = TerrainType::Default;
+        AtmospherePreset planetEnum = AtmospherePreset::Earth;
 
         if(!weatherMap.empty()){
             if(weatherMap == "stratus")
@@ -82,17 +99,145 @@ int main(int argc, char * argv[]) {
             }
         }
 
-        Renderer renderer{width, height, weatherMapEnum, terrainEnum};
+        if(!planet.empty()){
+            if(planet == "earth")
+                planetEnum = AtmospherePreset::Earth;
+            else if (planet == "mars")
+                planetEnum = AtmospherePreset::Mars;
+            else if (planet == "hazy")
+                planetEnum = AtmospherePreset::HazyEarth;
+            else {
+                Logger::log(LOG_LEVEL_ERROR, "Invalid planet!");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        std::string lutCacheDirectory = "lut-cache";
+        if(!lutCache.empty()){
+            lutCacheDirectory = lutCache == "none" ? "" : lutCache;
+        }
+
+        AtmosphereQuality qualityEnum = AtmosphereQuality::High;
+        if(!quality.empty()){
+            if(quality == "low")
+                qualityEnum = AtmosphereQuality::Low;
+            else if (quality == "medium")
+                qualityEnum = AtmosphereQuality::Medium;
+            else if (quality == "high")
+                qualityEnum = AtmosphereQuality::High;
+            else if (quality == "ultra")
+                qualityEnum = AtmosphereQuality::Ultra;
+            else {
+                Logger::log(LOG_LEVEL_ERROR, "Invalid quality!");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        if (skyBankLayers == 1 || skyBankLayers < 0) {
+            Logger::log(LOG_LEVEL_ERROR, "Sky view bank needs at least two layers!");
+            exit(EXIT_FAILURE);
+        }
+
+        if (cloudScale == 0) {
+            cloudScale = 1;
+        }
+        if (cloudScale != 1 && cloudScale != 2 && cloudScale != 4) {
+            Logger::log(LOG_LEVEL_ERROR, "Invalid cloud scale!");
+            exit(EXIT_FAILURE);
+        }
+
+        CloudQuality cloudQualityEnum = CloudQuality::Medium;
+        if(!cloudQuality.empty()){
+            if(cloudQuality == "low")
+                cloudQualityEnum = CloudQuality::Low;
+            else if (cloudQuality == "medium")
+                cloudQualityEnum = CloudQuality::Medium;
+            else if (cloudQuality == "high")
+                cloudQualityEnum = CloudQuality::High;
+            else if (cloudQuality == "ultra")
+                cloudQualityEnum = CloudQuality::Ultra;
+            else {
+                Logger::log(LOG_LEVEL_ERROR, "Invalid cloud quality!");
+                exit(EXIT_FAILURE);
+            }
+        }
+        if (cloudQualityEnum == CloudQuality::High || cloudQualityEnum == CloudQuality::Ultra) {
+            std::cout << "Using high fidelity clouds. This is recommended only for powerfull GPUs" << std::endl;
+        }
+
+        if (qualitySweepFrames > 0 && cloudBenchmarkFrames > 0) {
+            Logger::log(LOG_LEVEL_ERROR, "Quality sweep and cloud benchmark cannot run together!");
+            exit(EXIT_FAILURE);
+        }
+
+        if (!cloudCaptureDirectory.empty()) {
+            if (qualitySweepFrames > 0 || cloudBenchmarkFrames > 0) {
+                Logger::log(LOG_LEVEL_ERROR, "Cloud capture cannot run together with a benchmark!");
+                exit(EXIT_FAILURE);
+            }
+            // Reference ray-marches the full resolution 16:9 image of the given width
+            if (cloudScale != 1) {
+                Logger::log(LOG_LEVEL_ERROR, "Cloud capture needs the clouds ray-marched at cloud scale 1!");
+                exit(EXIT_FAILURE);
+            }
+            if (height != std::max(width * 9 / 16, 1)) {
+                Logger::log(LOG_LEVEL_ERROR, "Cloud capture needs the window height of width * 9 / 16!");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        Renderer renderer{width, height, weatherMapEnum, terrainEnum, planetEnum, lutCacheDirectory, qualityEnum,
+                          static_cast<uint32_t>(skyBankLayers), static_cast<uint32_t>(cloudScale), cloudQualityEnum};
+        if(qualitySweepFrames > 0){
+            renderer.enableQualitySweep(static_cast<uint32_t>(qualitySweepFrames));
+        }
+        if(cloudBenchmarkFrames > 0){
+            renderer.enableCloudVariantBenchmark(static_cast<uint32_t>(cloudBenchmarkFrames));
+        }
+        if(!cloudCaptureDirectory.empty()){
+            renderer.enableCloudCapture(cloudCaptureDirectory);
+        }
         renderer.render();
+
+        auto cloudBenchmarkResults = renderer.getCloudVariantBenchmarkResults();
+        if(!cloudBenchmarkResults.empty()){
+            std::cout << "-- CLOUD VARIANT BENCHMARK --" << std::endl;
+            for(const auto & result : cloudBenchmarkResults){
+                std::cout << "Quality " << CloudQualitySettings::name(result.quality) << ", "
+                          << (result.specialized ? "specialization constants" : "push constants") << ": "
+                          << result.averageTime() << " ms over " << result.timedFrames << " timed frames" << std::endl;
+            }
+        }
+
+        auto qualitySweepResults = renderer.getQualitySweepResults();
+        if(!qualitySweepResults.empty()){
+            const char * lutNames[QualitySweep::LUT_COUNT] = {"Transmittance", "Multiple scattering", "Sky view", "Aerial perspective"};
+            std::cout << "-- LUT QUALITY SWEEP (error against ultra) --" << std::endl;
+            for(const auto & tier : qualitySweepResults){
+                std::cout << "Tier " << AtmosphereLutExtents::name(tier.quality) << ", " << tier.timedFrames << " timed frames" << std::endl;
+                for(uint32_t i = 0; i < QualitySweep::LUT_COUNT; i++){
+                    const VkExtent3D & extent = tier.extents[i];
+                    std::cout << "  " << lutNames[i] << " " << extent.width << "x" << extent.height;
+                    if(extent.depth > 1)
+                        std::cout << "x" << extent.depth;
+                    std::cout << ": " << tier.averageTime(i) << " ms, mean abs error " << tier.error[i].meanAbsolute
+                              << ", max abs error " << tier.error[i].maxAbsolute << std::endl;
+                }
+            }
+        }
         auto benchmarkResult = renderer.getBenchmarkResult();
         std::cout << "-- PROFILER RESULTS --" << std::endl;
         std::cout << "Depth pre-pass avg: " << BenchmarkResult::average(benchmarkResult.depthPrePass.getSnapshot()) << " ms" << std::endl;
         std::cout << "Terrain draw avg: " << BenchmarkResult::average(benchmarkResult.terrainDraw.getSnapshot()) << " ms" << std::endl;
         std::cout << "Cloud compute avg: " << BenchmarkResult::average(benchmarkResult.cloudComputePass.getSnapshot()) << " ms"  << std::endl;
         std::cout << "Transmittance LUT compute avg: " << BenchmarkResult::average(benchmarkResult.transmittanceLUT.getSnapshot()) << " ms"  << std::endl;
+        std::cout << "Transmittance LUT skipped: " << BenchmarkResult::average(benchmarkResult.transmittanceLUTSkipped.getSnapshot()) * 100.0f << " % of frames"  << std::endl;
         std::cout << "Multiple scattering LUT compute avg: " << BenchmarkResult::average(benchmarkResult.multipleScatteringLUT.getSnapshot()) << " ms"  << std::endl;
+        std::cout << "Multiple scattering LUT skipped: " << BenchmarkResult::average(benchmarkResult.multipleScatteringLUTSkipped.getSnapshot()) * 100.0f << " % of frames"  << std::endl;
         std::cout << "Sky view LUT compute avg: " << BenchmarkResult::average(benchmarkResult.skyViewLUT.getSnapshot()) << " ms"  << std::endl;
+        std::cout << "Sky view LUT skipped: " << BenchmarkResult::average(benchmarkResult.skyViewLUTSkipped.getSnapshot()) * 100.0f << " % of frames"  << std::endl;
         std::cout << "Aerial perspective LUT compute avg: " << BenchmarkResult::average(benchmarkResult.aerialPerspectiveLUT.getSnapshot()) << " ms"  << std::endl;
+        std::cout << "Aerial perspective LUT skipped: " << BenchmarkResult::average(benchmarkResult.aerialPerspectiveLUTSkipped.getSnapshot()) * 100.0f << " % of frames"  << std::endl;
         std::cout << "God rays mask gen avg: " << BenchmarkResult::average(benchmarkResult.godRaysMask.getSnapshot()) << " ms"  << std::endl;
         std::cout << "God rays blur gen avg: " << BenchmarkResult::average(benchmarkResult.godRaysBlur.getSnapshot()) << " ms"  << std::endl;
         std::cout << "Sky view upsample avg: " << BenchmarkResult::average(benchmarkResult.skyUpsample.getSnapshot()) << " ms"  << std::endl;
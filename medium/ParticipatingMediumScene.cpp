@@ -1,5 +1,6 @@
 #include "ParticipatingMediumScene.h"
 #include "SignedDistanceField.h"
+#include "../renderer/clouds/CloudNoiseGenerator.h"
 
 void ParticipatingMediumScene::init() {
     // Load the SDF from the disk
@@ -41,32 +42,31 @@ void ParticipatingMediumScene::init() {
     // Release the staging buffer
     rm.releaseResource(sdfStagingBuffer.getUid());
 
-    // Load the 3D noise from the disk
-    int w, h, c, d;
-    ScopedMemory densityNoiseData(readVolume(Filesystem::ls(assetPath("base")), w, h, c, d,
-                                             Filesystem::ImageFormat::R16G16B16A16_SFLOAT));
+    // Generate the 3D noise, same volume the clouds are shaped from
+    const CloudNoiseParameters noiseParameters{};
+    const std::vector<uint8_t> densityNoiseData = CloudNoiseGenerator(device, rm, noiseParameters, "").generateBase();
 
     // Create the staging buffer
     ResourceHandle densityNoiseStagingBuffer = rm.createResource<Buffer>(
         "density-noise-staging-buffer", BufferDesc{
-            .instanceSize = sizeof(float16_t),
-            .instanceCount = static_cast<uint32_t>(w * h * d * c),
+            .instanceSize = sizeof(uint8_t),
+            .instanceCount = static_cast<uint32_t>(densityNoiseData.size()),
             .usageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
             .allocationFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
         }
     );
 
     rm.getResource<Buffer>(densityNoiseStagingBuffer)->map();
-    rm.getResource<Buffer>(densityNoiseStagingBuffer)->writeToBuffer(densityNoiseData.get());
+    rm.getResource<Buffer>(densityNoiseStagingBuffer)->writeToBuffer(densityNoiseData.data());
 
     // Create the actual resource
     densityNoise = rm.createResource<Image>(
         "density-noise-image", ImageDesc{
-            .width = static_cast<uint32_t>(w),
-            .height = static_cast<uint32_t>(h),
-            .channels = static_cast<uint32_t>(c),
-            .depth = static_cast<uint32_t>(d),
-            .format = VK_FORMAT_R16G16B16A16_SFLOAT,
+            .width = noiseParameters.baseSize,
+            .height = noiseParameters.baseSize,
+            .channels = 2,
+            .depth = noiseParameters.baseSize,
+            .format = VK_FORMAT_R8G8_UNORM,
             .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
             .imageType = VK_IMAGE_TYPE_3D,
             .imageViewType = VK_IMAGE_VIEW_TYPE_3D,
@@ -81,6 +81,7 @@ void ParticipatingMediumScene::init() {
     // Release the staging buffer
     rm.releaseResource(densityNoiseStagingBuffer.getUid());
 
+    int w, h, c;
     // Load the curl noise, we don't require any precision here so 8 bits is ok
     ScopedMemory curlNoiseData(readImage(assetPath("curlNoise.png"), w, h, c,
                                          Filesystem::ImageFormat::R8G8B8A8_UNORM));
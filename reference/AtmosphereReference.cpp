@@ -0,0 +1,667 @@
+#include "AtmosphereReference.h"
+
+#include <cstring>
+
+// These have to match the constants in the shaders
+#define PI 3.14159265358979323846f
+#define SUN_INTENSITY 3.0f // toolbox.slang
+#define WORLD_SCALE 500.0f // toolbox.slang
+#define MAX_DISTANCE 10000.0f // toolbox.slang
+#define TRANSMITTANCE_STEP_COUNT 128 // transmittance.slang
+#define ADAPTIVE_STEP_DEPTH 0.05f // transmittance.slang
+#define ADAPTIVE_MAX_STEP_COUNT 48 // transmittance.slang
+#define OZONE_STEP_COUNT 16 // transmittance.slang
+#define PLANET_ALBEDO 0.3f // multiplescattering.slang
+#define DIR_SAMPLE_COUNT 32 // multiplescattering.slang
+#define RAYMARCH_STEP_COUNT 20 // multiplescattering.slang
+#define SKY_VIEW_SAMPLES 30 // skyview.slang
+#define PER_SLICE_SAMPLES 8 // aerialperspective.slang
+
+namespace {
+    // Shader intrinsics, HLSL argument order
+    HmckVec2 lerp(HmckVec2 a, HmckVec2 b, float t) { return a + (b - a) * t; }
+    HmckVec3 lerp(HmckVec3 a, HmckVec3 b, float t) { return a + (b - a) * t; }
+    float frac(float x) { return x - std::floor(x); }
+
+    HmckVec4 exp(HmckVec4 v) {
+        return HmckVec4{std::exp(v.X), std::exp(v.Y), std::exp(v.Z), std::exp(v.W)};
+    }
+
+    HmckVec4 sqrt(HmckVec4 v) {
+        return HmckVec4{std::sqrt(v.X), std::sqrt(v.Y), std::sqrt(v.Z), std::sqrt(v.W)};
+    }
+
+    HmckVec4 abs(HmckVec4 v) {
+        return HmckVec4{std::abs(v.X), std::abs(v.Y), std::abs(v.Z), std::abs(v.W)};
+    }
+
+    HmckVec4 max(HmckVec4 v, float m) {
+        return HmckVec4{std::max(v.X, m), std::max(v.Y, m), std::max(v.Z, m), std::max(v.W, m)};
+    }
+
+    HmckVec4 splat(float x) { return HmckVec4{x, x, x, x}; }
+
+    // Turns four RGB samples, one per texel, into one HmckVec4 per channel with a texel in each lane
+    HmckMat4 toLanes(const HmckVec4 (&samples)[4]) {
+        HmckMat4 m;
+        for (int i = 0; i < 4; i++) {
+            m.Columns[i] = samples[i];
+        }
+        return HmckTranspose(m);
+    }
+
+    float relativeLuminance(HmckVec4 c) {
+        return 0.2126f * c.X + 0.7152f * c.Y + 0.0722f * c.Z;
+    }
+
+    // Mirrors getSigmaST in toolbox.slang, w channel is unused and stays zero
+    void getSigmaST(const AtmosphereParameters &planet, float h, HmckVec4 &sigmaS, HmckVec4 &sigmaT) {
+        HmckVec4 rayleigh = planet.scatterRayleigh * std::exp(-h / planet.hDensityRayleigh);
+        float mieDensity = std::exp(-h / planet.hDensityMie);
+        float mieS = planet.scatterMie * mieDensity;
+        float mieT = (planet.scatterMie + planet.absorbMie) * mieDensity;
+        HmckVec4 ozone = planet.absorbOzone * std::max(
+                             0.0f, 1.0f - 0.5f * std::abs(h - planet.ozoneCenterHeight) / planet.ozoneThickness);
+        sigmaS = rayleigh + HmckVec4{mieS, mieS, mieS, 0.0f};
+        sigmaT = rayleigh + HmckVec4{mieT, mieT, mieT, 0.0f} + ozone;
+    }
+
+    // Mirrors getSigmaT in toolbox.slang
+    HmckVec4 getSigmaT(const AtmosphereParameters &planet, float h) {
+        HmckVec4 sigmaS, sigmaT;
+        getSigmaST(planet, h, sigmaS, sigmaT);
+        return sigmaT;
+    }
+
+    /**
+     * Mirrors the fixed step raymarch of transmittance.slang for four rays of one LUT row, one per lane. The rays share
+     * the direction and start on the y axis, so the densities are integrated per lane and scaled by the extinction of
+     * each wavelength at the end.
+     * @param oY Heights of the ray origins above the planet center
+     * @param t Lengths of the rays
+     * @param opticalDepth Optical depth of each ray
+     */
+    void raymarchOpticalDepth(const AtmosphereParameters &planet, HmckVec4 oY, HmckVec2 d, HmckVec4 t, int steps,
+                              HmckVec4 (&opticalDepth)[4]) {
+        HmckVec4 rayleigh{}, mie{}, ozone{};
+        for (int i = 0; i < steps; ++i) {
+            HmckVec4 s = t * (static_cast<float>(i) / static_cast<float>(steps));
+            HmckVec4 x = s * d.X;
+            HmckVec4 y = oY + s * d.Y;
+            HmckVec4 h = sqrt(x * x + y * y) - splat(planet.planetRadius);
+            rayleigh += exp(h * (-1.0f / planet.hDensityRayleigh));
+            mie += exp(h * (-1.0f / planet.hDensityMie));
+            ozone += max(splat(1.0f) - abs(h - splat(planet.ozoneCenterHeight)) * (0.5f / planet.ozoneThickness),
+                         0.0f);
+        }
+        const float mieT = planet.scatterMie + planet.absorbMie;
+        for (int lane = 0; lane < 4; lane++) {
+            opticalDepth[lane] = (planet.scatterRayleigh * rayleigh[lane] + HmckVec4{mieT, mieT, mieT, 0.0f} * mie[lane]
+                                  + planet.absorbOzone * ozone[lane]) * (t[lane] / static_cast<float>(steps));
+        }
+    }
+
+    // Mirrors adaptiveOpticalDepth in transmittance.slang
+    HmckVec4 adaptiveOpticalDepth(const AtmosphereParameters &planet, HmckVec2 o, HmckVec2 d, float t) {
+        HmckVec4 sum{};
+        float s = 0.0f;
+        for (int i = 0; i < ADAPTIVE_MAX_STEP_COUNT && s < t; ++i) {
+            HmckVec4 sigma = getSigmaT(planet, HmckLen(o + d * s) - planet.planetRadius);
+            float dt = ADAPTIVE_STEP_DEPTH / std::max(std::max(sigma.X, std::max(sigma.Y, sigma.Z)), 1e-12f);
+            dt = std::clamp(dt, (t - s) / static_cast<float>(ADAPTIVE_MAX_STEP_COUNT - i), t - s);
+            float hi = HmckLen(o + d * (s + 0.5f * dt)) - planet.planetRadius;
+            sum += getSigmaT(planet, hi) * dt;
+            s += dt;
+        }
+        return sum;
+    }
+
+    // Mirrors chapmanNear in transmittance.slang
+    float chapmanNear(float x, float mu) {
+        float c = std::sqrt(0.5f * PI * x);
+        return mu >= 0.0f ? c / ((c - 1.0f) * mu + 1.0f) : -c / ((c - 1.0f) * -mu + 1.0f);
+    }
+
+    // Mirrors exponentialOpticalDepth in transmittance.slang
+    float exponentialOpticalDepth(const AtmosphereParameters &planet, float r, float mu, float t, float H) {
+        float rEnd = std::sqrt(r * r + t * t + 2.0f * r * mu * t);
+        float muEnd = (r * mu + t) / rEnd;
+        float depth = std::exp(-(r - planet.planetRadius) / H) * chapmanNear(r / H, mu)
+                      - std::exp(-(rEnd - planet.planetRadius) / H) * chapmanNear(rEnd / H, muEnd);
+        if (mu < 0.0f && muEnd >= 0.0f) {
+            float rp = r * std::sqrt(1.0f - mu * mu);
+            depth += 2.0f * std::sqrt(0.5f * PI * rp / H) * std::exp(-(rp - planet.planetRadius) / H);
+        }
+        return H * std::max(depth, 0.0f);
+    }
+
+    // Mirrors chapmanOpticalDepth in transmittance.slang
+    HmckVec4 chapmanOpticalDepth(const AtmosphereParameters &planet, HmckVec2 o, HmckVec2 d, float t) {
+        float r = HmckLen(o);
+        float mu = HmckDot(o, d) / r;
+        float rayleigh = exponentialOpticalDepth(planet, r, mu, t, planet.hDensityRayleigh);
+        float mie = exponentialOpticalDepth(planet, r, mu, t, planet.hDensityMie);
+
+        float dt = t / OZONE_STEP_COUNT;
+        float ozone = 0.0f;
+        for (int i = 0; i < OZONE_STEP_COUNT; ++i) {
+            float hi = HmckLen(o + d * ((static_cast<float>(i) + 0.5f) * dt)) - planet.planetRadius;
+            ozone += std::max(0.0f, 1.0f - 0.5f * std::abs(hi - planet.ozoneCenterHeight) / planet.ozoneThickness);
+        }
+
+        float mieT = (planet.scatterMie + planet.absorbMie) * mie;
+        return planet.scatterRayleigh * rayleigh + HmckVec4{mieT, mieT, mieT, 0.0f} + planet.absorbOzone * (ozone * dt);
+    }
+
+    // Mirrors evalPhaseFunction in toolbox.slang
+    HmckVec4 evalPhaseFunction(const AtmosphereParameters &planet, float h, float u) {
+        HmckVec4 sRayleigh = planet.scatterRayleigh * std::exp(-h / planet.hDensityRayleigh);
+        float sMie = planet.scatterMie * std::exp(-h / planet.hDensityMie);
+        HmckVec4 s = sRayleigh + HmckVec4{sMie, sMie, sMie, 0.0f};
+        float g = planet.asymmetryMie, g2 = g * g, u2 = u * u;
+        float pRayleigh = 3.0f / (16.0f * PI) * (1.0f + u2);
+        float m = 1.0f + g2 - 2.0f * g * u;
+        float pMie = 3.0f / (8.0f * PI) * (1.0f - g2) * (1.0f + u2) / ((2.0f + g2) * m * std::sqrt(m));
+        HmckVec4 result{};
+        for (int c = 0; c < 3; c++) {
+            result[c] = s[c] > 0.0f ? (pRayleigh * sRayleigh[c] + pMie * sMie) / s[c] : 0.0f;
+        }
+        return result;
+    }
+
+    // Mirrors getTransmittance in toolbox.slang
+    HmckVec4 getTransmittance(const ReferenceLut &lut, float h, float theta, float atmosphereHeight) {
+        return lut.sample(h / atmosphereHeight, 0.5f + 0.5f * std::sin(theta));
+    }
+
+    bool existsRaySphereIntersection(HmckVec3 o, HmckVec3 d, float R) {
+        float A = HmckDot(d, d);
+        float B = 2.0f * HmckDot(o, d);
+        float C = HmckDot(o, o) - R * R;
+        float delta = B * B - 4.0f * A * C;
+        return (delta >= 0.0f) && ((C <= 0.0f) || (B <= 0.0f));
+    }
+
+    template<typename Vec>
+    bool intersectRay(Vec o, Vec d, float R, float &t) {
+        float A = HmckDot(d, d);
+        float B = 2.0f * HmckDot(o, d);
+        float C = HmckDot(o, o) - R * R;
+        float delta = B * B - 4.0f * A * C;
+        if (delta < 0.0f)
+            return false;
+        t = (-B + (C <= 0.0f ? std::sqrt(delta) : -std::sqrt(delta))) / (2.0f * A);
+        return (C <= 0.0f) || (B <= 0.0f);
+    }
+
+    // Hammersley sequence from multiplescattering.slang
+    float radicalInverseVdC(uint32_t bits) {
+        bits = (bits << 16u) | (bits >> 16u);
+        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+        return static_cast<float>(bits) * 2.3283064365386963e-10f;
+    }
+
+    HmckVec3 uniformSampleSphere(uint32_t i, uint32_t N) {
+        float theta = std::acos(1.0f - 2.0f * (static_cast<float>(i) / static_cast<float>(N)));
+        float phi = 2.0f * 3.14159265f * radicalInverseVdC(i);
+        float sinTheta = std::sin(theta);
+        return HmckVec3{sinTheta * std::cos(phi), sinTheta * std::sin(phi), std::cos(theta)};
+    }
+
+    uint32_t wrap(int32_t i, uint32_t size) {
+        int32_t m = i % static_cast<int32_t>(size);
+        return static_cast<uint32_t>(m < 0 ? m + static_cast<int32_t>(size) : m);
+    }
+}
+
+
+HmckVec4 ReferenceLut::sample(float u, float v, uint32_t z) const {
+    // Texel centers are at half integers
+    float x = u * static_cast<float>(width) - 0.5f;
+    float y = v * static_cast<float>(height) - 0.5f;
+    float x0f = std::floor(x), y0f = std::floor(y);
+    float fx = x - x0f, fy = y - y0f;
+    auto x0 = static_cast<int32_t>(x0f), y0 = static_cast<int32_t>(y0f);
+
+    HmckVec4 a = at(wrap(x0, width), wrap(y0, height), z);
+    HmckVec4 b = at(wrap(x0 + 1, width), wrap(y0, height), z);
+    HmckVec4 c = at(wrap(x0, width), wrap(y0 + 1, height), z);
+    HmckVec4 d = at(wrap(x0 + 1, width), wrap(y0 + 1, height), z);
+    return (a * (1.0f - fx) + b * fx) * (1.0f - fy) + (c * (1.0f - fx) + d * fx) * fy;
+}
+
+HmckVec4 ReferenceLut::sampleVolume(float u, float v, float w) const {
+    // Two bilinear slices blended along z, texel centers are at half integers
+    float z = w * static_cast<float>(depth) - 0.5f;
+    float z0f = std::floor(z);
+    float fz = z - z0f;
+    auto z0 = static_cast<int32_t>(z0f);
+    HmckVec4 a = sample(u, v, wrap(z0, depth));
+    HmckVec4 b = sample(u, v, wrap(z0 + 1, depth));
+    return a * (1.0f - fz) + b * fz;
+}
+
+std::vector<uint16_t> ReferenceLut::toHalf() const {
+    std::vector<uint16_t> half(texels.size() * 4);
+    for (size_t i = 0; i < texels.size(); i++) {
+        for (int c = 0; c < 4; c++) {
+            half[i * 4 + c] = float32float16(texels[i].Elements[c]);
+        }
+    }
+    return half;
+}
+
+void ReferenceLut::writeImage(const std::string &filename) const {
+    const size_t sliceSize = static_cast<size_t>(width) * height;
+    for (uint32_t z = 0; z < depth; z++) {
+        std::string sliceName = depth == 1 ? filename : filename + "_" + std::to_string(z);
+        Filesystem::writeImage(sliceName + ".hdr", &texels[z * sliceSize].Elements[0], sizeof(float), width, height, 4,
+                               Filesystem::WriteImageDefinition::HDR);
+    }
+}
+
+void ReferenceLut::writeRaw(const std::string &filename) const {
+    std::vector<uint16_t> half = toHalf();
+    std::ofstream file{filename, std::ios::binary};
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open file: " + filename);
+    }
+    file.write(reinterpret_cast<const char *>(half.data()), static_cast<std::streamsize>(half.size() * sizeof(uint16_t)));
+}
+
+ReferenceLut ReferenceLut::readRaw(const std::string &filename, uint32_t width, uint32_t height, uint32_t depth) {
+    std::vector<char> data = Filesystem::readFile(filename);
+    ReferenceLut lut{width, height, depth};
+    if (data.size() != lut.texelCount() * 4 * sizeof(uint16_t)) {
+        throw std::runtime_error("LUT dimensions do not match the size of file: " + filename);
+    }
+    const auto *half = reinterpret_cast<const uint16_t *>(data.data());
+    for (size_t i = 0; i < lut.texelCount(); i++) {
+        for (int c = 0; c < 4; c++) {
+            lut.texels[i].Elements[c] = float16float32(half[i * 4 + c]);
+        }
+    }
+    return lut;
+}
+
+ReferenceLut ReferenceLut::readRawFloat(const std::string &filename, uint32_t width, uint32_t height) {
+    std::vector<char> data = Filesystem::readFile(filename);
+    ReferenceLut lut{width, height};
+    if (data.size() != lut.texelCount() * 4 * sizeof(float)) {
+        throw std::runtime_error("Image dimensions do not match the size of file: " + filename);
+    }
+    std::memcpy(lut.texels.data(), data.data(), data.size());
+    return lut;
+}
+
+LutError LutError::compare(const ReferenceLut &reference, const ReferenceLut &tested) {
+    ASSERT(reference.width == tested.width && reference.height == tested.height && reference.depth == tested.depth,
+           "Compared LUTs have different dimensions");
+    LutError error{};
+    double sum = 0.0;
+    for (size_t i = 0; i < reference.texelCount(); i++) {
+        for (int c = 0; c < 4; c++) {
+            float difference = std::abs(reference.texels[i].Elements[c] - tested.texels[i].Elements[c]);
+            error.maxAbsolute = std::max(error.maxAbsolute, difference);
+            if (std::abs(reference.texels[i].Elements[c]) > 1e-6f) {
+                error.maxRelative = std::max(error.maxRelative, difference / std::abs(reference.texels[i].Elements[c]));
+            }
+            sum += difference;
+        }
+    }
+    error.meanAbsolute = static_cast<float>(sum / static_cast<double>(reference.texelCount() * 4));
+    return error;
+}
+
+
+AtmosphereReference::AtmosphereReference(uint32_t threadCount) : threadCount(std::max(threadCount, 1u)) {
+    threadPool.setThreadCount(this->threadCount);
+}
+
+void AtmosphereReference::parallelFor(uint32_t rows, const std::function<void(uint32_t)> &kernel) {
+    const uint32_t rowsPerJob = (rows + threadCount - 1) / threadCount;
+    for (uint32_t begin = 0; begin < rows; begin += rowsPerJob) {
+        const uint32_t end = std::min(begin + rowsPerJob, rows);
+        threadPool.submit([&kernel, begin, end]() {
+            for (uint32_t row = begin; row < end; row++) {
+                kernel(row);
+            }
+        });
+    }
+    threadPool.wait();
+}
+
+ReferenceLut AtmosphereReference::computeTransmittance(const AtmosphereParameters &parameters, uint32_t width,
+                                                       uint32_t height, TransmittanceIntegrator integrator,
+                                                       uint32_t stepCount) {
+    ReferenceLut lut{width, height};
+    const int steps = stepCount > 0 ? static_cast<int>(stepCount) : TRANSMITTANCE_STEP_COUNT;
+    const float atmosphereHeight = parameters.atmosphereRadius - parameters.planetRadius;
+
+    parallelFor(height, [&](uint32_t y) {
+        // Indexed by height and sun theta
+        float theta = std::asin(std::lerp(-1.0f, 1.0f, (static_cast<float>(y) + 0.5f) / static_cast<float>(height)));
+        HmckVec2 d{std::cos(theta), std::sin(theta)};
+        // Four texels of the row at once, the lanes past the end of the row repeat its last texel
+        for (uint32_t x0 = 0; x0 < width; x0 += 4) {
+            HmckVec4 oY, t;
+            for (uint32_t lane = 0; lane < 4; lane++) {
+                uint32_t x = std::min(x0 + lane, width - 1);
+                float h = std::lerp(0.0f, atmosphereHeight, (static_cast<float>(x) + 0.5f) / static_cast<float>(width));
+                oY[lane] = parameters.planetRadius + h;
+
+                // Find the intersection with the planet or atmosphere
+                HmckVec2 o{0.0f, oY[lane]};
+                t[lane] = 0.0f;
+                if (!intersectRay(o, d, parameters.planetRadius, t[lane])) {
+                    intersectRay(o, d, parameters.atmosphereRadius, t[lane]);
+                }
+            }
+
+            HmckVec4 opticalDepth[4];
+            if (integrator == TransmittanceIntegrator::Raymarch) {
+                raymarchOpticalDepth(parameters, oY, d, t, steps, opticalDepth);
+            } else {
+                // Chapman is closed form and adaptive steps differ per ray, they go one texel at a time
+                for (uint32_t lane = 0; lane < 4; lane++) {
+                    HmckVec2 o{0.0f, oY[lane]};
+                    opticalDepth[lane] = integrator == TransmittanceIntegrator::Chapman
+                                             ? chapmanOpticalDepth(parameters, o, d, t[lane])
+                                             : adaptiveOpticalDepth(parameters, o, d, t[lane]);
+                }
+            }
+
+            for (uint32_t lane = 0; lane < 4 && x0 + lane < width; lane++) {
+                HmckVec4 result = exp(-opticalDepth[lane]);
+                lut.at(x0 + lane, y) = HmckVec4{result.X, result.Y, result.Z, 1.0f};
+            }
+        }
+    });
+
+    return lut;
+}
+
+ReferenceLut AtmosphereReference::computeMultipleScattering(const AtmosphereParameters &parameters,
+                                                            const ReferenceLut &transmittance, uint32_t width,
+                                                            uint32_t height) {
+    ReferenceLut lut{width, height};
+    const float atmosphereHeight = parameters.atmosphereRadius - parameters.planetRadius;
+
+    // Analytical integration as proposed by Sébastien Hillaire
+    auto integrate = [&](HmckVec3 worldOri, HmckVec3 worldDir, float sunTheta, HmckVec3 toSunDir,
+                         HmckVec4 &innerL2, HmckVec4 &innerF) {
+        float u = HmckDot(worldDir, toSunDir);
+
+        float endT = 0.0f;
+        bool groundInct = intersectRay(worldOri, worldDir, parameters.planetRadius, endT);
+        if (!groundInct) {
+            intersectRay(worldOri, worldDir, parameters.atmosphereRadius, endT);
+        }
+
+        float dt = endT / RAYMARCH_STEP_COUNT;
+        float halfDt = 0.5f * dt;
+        float t = 0.0f;
+
+        HmckVec4 sumSigmaT{}, sumL2{}, sumF{};
+        for (int i = 0; i < RAYMARCH_STEP_COUNT; ++i) {
+            float midT = t + halfDt;
+            t += dt;
+
+            HmckVec3 worldPos = worldOri + worldDir * midT;
+            float h = HmckLen(worldPos) - parameters.planetRadius;
+
+            HmckVec4 sigmaS, sigmaT;
+            getSigmaST(parameters, h, sigmaS, sigmaT);
+
+            HmckVec4 deltaSumSigmaT = sigmaT * dt;
+            HmckVec4 eyeTransmittance = exp(-sumSigmaT - deltaSumSigmaT * 0.5f);
+
+            if (!existsRaySphereIntersection(worldPos, toSunDir, parameters.planetRadius)) {
+                HmckVec4 rho = evalPhaseFunction(parameters, h, u);
+                HmckVec4 sunTransmittance = getTransmittance(transmittance, h, sunTheta, atmosphereHeight);
+                // Second order scattering
+                sumL2 += eyeTransmittance * sunTransmittance * sigmaS * rho * (dt * SUN_INTENSITY);
+            }
+
+            sumF += eyeTransmittance * sigmaS * dt;
+            sumSigmaT += deltaSumSigmaT;
+        }
+
+        if (groundInct) {
+            HmckVec4 eyeTransmittance = exp(-sumSigmaT);
+            HmckVec4 sunTransmittance = getTransmittance(transmittance, 0.0f, sunTheta, atmosphereHeight);
+            sumL2 += eyeTransmittance * sunTransmittance *
+                    (std::max(0.0f, toSunDir.Y) * SUN_INTENSITY * (PLANET_ALBEDO / PI));
+        }
+
+        innerL2 = sumL2;
+        innerF = sumF;
+    };
+
+    parallelFor(height, [&](uint32_t y) {
+        // Indexed by height and sun theta
+        float sinSunTheta = std::lerp(-1.0f, 1.0f, (static_cast<float>(y) + 0.5f) / static_cast<float>(height));
+        float sunTheta = std::asin(sinSunTheta);
+        for (uint32_t x = 0; x < width; x++) {
+            float h = std::lerp(0.0f, atmosphereHeight, (static_cast<float>(x) + 0.5f) / static_cast<float>(width));
+
+            HmckVec3 worldOri{0.0f, h + parameters.planetRadius, 0.0f};
+            HmckVec3 toSunDir{std::cos(sunTheta), std::sin(sunTheta), 0.0f};
+
+            // Uniformly sample the unit sphere and compute 2nd order scattering
+            HmckVec4 sumL2{}, sumF{};
+            for (int i = 0; i < DIR_SAMPLE_COUNT; ++i) {
+                HmckVec3 worldDir = uniformSampleSphere(i, DIR_SAMPLE_COUNT);
+                HmckVec4 innerL2, innerF;
+                integrate(worldOri, worldDir, sunTheta, toSunDir, innerL2, innerF);
+                sumL2 += innerL2;
+                sumF += innerF;
+            }
+
+            HmckVec4 l2 = sumL2 / static_cast<float>(DIR_SAMPLE_COUNT);
+            HmckVec4 f = sumF / static_cast<float>(DIR_SAMPLE_COUNT);
+            HmckVec4 m = l2 / (HmckVec4{1.0f, 1.0f, 1.0f, 1.0f} - f);
+            lut.at(x, y) = HmckVec4{m.X, m.Y, m.Z, 1.0f};
+        }
+    });
+
+    return lut;
+}
+
+ReferenceLut AtmosphereReference::computeSkyView(const AtmosphereParameters &parameters,
+                                                 const AtmosphereUniformBufferData &atmosphere,
+                                                 const ReferenceLut &transmittance,
+                                                 const ReferenceLut &multipleScattering, uint32_t width,
+                                                 uint32_t height) {
+    ReferenceLut lut{width, height};
+    const float atmosphereHeight = parameters.atmosphereRadius - parameters.planetRadius;
+    const HmckVec3 sunDirection = atmosphere.sunDirection.XYZ;
+
+    parallelFor(height, [&](uint32_t y) {
+        // Indexed by phi and theta angles, more information is compressed near horizon
+        float vm = 2.0f * (static_cast<float>(y) + 0.5f) / static_cast<float>(height) - 1.0f;
+        float theta = (vm > 0.0f ? 1.0f : (vm < 0.0f ? -1.0f : 0.0f)) * (PI / 2.0f) * vm * vm;
+        float sinTheta = std::sin(theta), cosTheta = std::cos(theta);
+
+        HmckVec3 ori = atmosphere.eye.XYZ * WORLD_SCALE;
+        HmckVec2 planetOri{0.0f, ori.Y + parameters.planetRadius};
+        HmckVec2 planetDir{cosTheta, sinTheta};
+
+        float endT = 0.0f;
+        if (!intersectRay(planetOri, planetDir, parameters.planetRadius, endT)) {
+            intersectRay(planetOri, planetDir, parameters.atmosphereRadius, endT);
+        }
+        float dt = endT / SKY_VIEW_SAMPLES;
+
+        // Four texels of the row at once, one per lane, the lanes past the end of the row repeat its last texel. Texels
+        // of a row differ only in phi, so the samples at the same distance share the height and everything depending
+        // on it, only the phase function and the sun angle are evaluated per lane.
+        for (uint32_t x0 = 0; x0 < width; x0 += 4) {
+            HmckVec4 cosPhi, sinPhi, phaseU;
+            for (uint32_t lane = 0; lane < 4; lane++) {
+                uint32_t x = std::min(x0 + lane, width - 1);
+                float phi = 2.0f * PI * (static_cast<float>(x) + 0.5f) / static_cast<float>(width);
+                cosPhi[lane] = std::cos(phi);
+                sinPhi[lane] = std::sin(phi);
+                HmckVec3 dir{cosPhi[lane] * cosTheta, sinTheta, sinPhi[lane] * cosTheta};
+                phaseU[lane] = HmckDot(sunDirection, -dir);
+            }
+
+            // Phase functions of evalPhaseFunction, they only depend on the view direction
+            float g = parameters.asymmetryMie, g2 = g * g;
+            HmckVec4 u2 = phaseU * phaseU;
+            HmckVec4 pRayleigh = (splat(1.0f) + u2) * (3.0f / (16.0f * PI));
+            HmckVec4 m = splat(1.0f + g2) - phaseU * (2.0f * g);
+            HmckVec4 pMie = (splat(1.0f) + u2) * (3.0f / (8.0f * PI) * (1.0f - g2)) / (m * sqrt(m) * (2.0f + g2));
+
+            float t = 0.0f;
+            HmckVec4 sumSigmaT{};
+            // Red, green and blue in-scattering, one texel per lane
+            HmckVec4 inScatter[3] = {};
+            for (int i = 0; i < SKY_VIEW_SAMPLES; ++i) {
+                float nextT = t + dt;
+                float midT = 0.5f * (t + nextT);
+                float posY = ori.Y + parameters.planetRadius + sinTheta * midT;
+                float r = std::sqrt(midT * cosTheta * midT * cosTheta + posY * posY);
+                float h = r - parameters.planetRadius;
+
+                HmckVec4 sigmaS, sigmaT;
+                getSigmaST(parameters, h, sigmaS, sigmaT);
+
+                HmckVec4 deltaSumSigmaT = sigmaT * (nextT - t);
+                HmckVec4 eyeTrans = exp(-sumSigmaT - deltaSumSigmaT);
+                HmckVec4 weight = eyeTrans * sigmaS * (nextT - t);
+
+                // Sun angle of the sample of each lane, normalized position dotted with the sun direction
+                HmckVec4 sunCos = (splat(sunDirection.Y * posY) +
+                                   (cosPhi * sunDirection.X + sinPhi * sunDirection.Z) * (cosTheta * midT)) / r;
+                HmckVec4 sunTrans[4], ms[4];
+                for (int lane = 0; lane < 4; lane++) {
+                    float sunTheta = PI / 2.0f - std::acos(std::clamp(sunCos[lane], -1.0f, 1.0f));
+                    sunTrans[lane] = getTransmittance(transmittance, h, sunTheta, atmosphereHeight);
+                    ms[lane] = multipleScattering.sample(h / atmosphereHeight, 0.5f + 0.5f * std::sin(sunTheta));
+                }
+                HmckMat4 sunTransLanes = toLanes(sunTrans), msLanes = toLanes(ms);
+
+                float sRayleigh = std::exp(-h / parameters.hDensityRayleigh);
+                float sMie = parameters.scatterMie * std::exp(-h / parameters.hDensityMie);
+                for (int c = 0; c < 3; c++) {
+                    HmckVec4 rho = sigmaS[c] > 0.0f
+                                       ? (pRayleigh * (parameters.scatterRayleigh.Elements[c] * sRayleigh) + pMie * sMie) /
+                                         sigmaS[c]
+                                       : HmckVec4{};
+                    inScatter[c] += (rho * sunTransLanes.Columns[c] + msLanes.Columns[c]) * weight[c];
+                }
+
+                sumSigmaT += deltaSumSigmaT;
+                t = nextT;
+            }
+
+            for (uint32_t lane = 0; lane < 4 && x0 + lane < width; lane++) {
+                lut.at(x0 + lane, y) = HmckVec4{
+                    inScatter[0][lane] * SUN_INTENSITY, inScatter[1][lane] * SUN_INTENSITY,
+                    inScatter[2][lane] * SUN_INTENSITY, 1.0f
+                };
+            }
+        }
+    });
+
+    return lut;
+}
+
+ReferenceLut AtmosphereReference::computeAerialPerspective(const AtmosphereParameters &parameters,
+                                                           const AtmosphereUniformBufferData &atmosphere,
+                                                           const ReferenceLut &transmittance,
+                                                           const ReferenceLut &multipleScattering, uint32_t width,
+                                                           uint32_t height, uint32_t depth,
+                                                           const ReferenceLut &shadowMap) {
+    ReferenceLut lut{width, height, depth};
+    const float atmosphereHeight = parameters.atmosphereRadius - parameters.planetRadius;
+    const HmckVec3 sunDirection = atmosphere.sunDirection.XYZ;
+    const float sunTheta = std::asin(sunDirection.Y);
+
+    parallelFor(height, [&](uint32_t y) {
+        for (uint32_t x = 0; x < width; x++) {
+            float xf = (static_cast<float>(x) + 0.5f) / static_cast<float>(width);
+            float yf = (static_cast<float>(y) + 0.5f) / static_cast<float>(height);
+
+            // Ray origin and direction, bilinear interpolation between the 4 frustum corners
+            HmckVec3 ori{0.0f, WORLD_SCALE * atmosphere.eye.Y, 0.0f};
+            HmckVec3 topDir = lerp(atmosphere.frustumD.XYZ, atmosphere.frustumC.XYZ, xf);
+            HmckVec3 bottomDir = lerp(atmosphere.frustumB.XYZ, atmosphere.frustumA.XYZ, xf);
+            HmckVec3 dir = HmckNorm(lerp(bottomDir, topDir, yf));
+
+            float u = HmckDot(HmckNorm(sunDirection), dir);
+
+            float maxT = 0.0f;
+            HmckVec3 planetOri = ori + HmckVec3{0.0f, parameters.planetRadius, 0.0f};
+            if (!intersectRay(planetOri, dir, parameters.planetRadius, maxT)) {
+                intersectRay(planetOri, dir, parameters.atmosphereRadius, maxT);
+            }
+
+            float sliceDepth = MAX_DISTANCE / static_cast<float>(depth);
+            float halfSliceDepth = 0.5f * sliceDepth;
+            float tBeg = 0.0f;
+            float tEnd = std::min(halfSliceDepth, maxT);
+
+            HmckVec4 sumSigmaT{}, inScatter{};
+
+            // Same dithering as on the GPU
+            float rand = frac(std::sin(xf * 12.9898f * 2.0f + yf * 78.233f * 2.0f) * 43758.5453f);
+
+            for (uint32_t z = 0; z < depth; ++z) {
+                float dt = (tEnd - tBeg) / PER_SLICE_SAMPLES;
+                float t = tBeg;
+
+                for (int i = 0; i < PER_SLICE_SAMPLES; ++i) {
+                    float nextT = t + dt;
+                    float midT = std::lerp(t, nextT, rand);
+                    HmckVec3 posR = planetOri + dir * midT;
+                    float h = HmckLen(posR) - parameters.planetRadius;
+
+                    HmckVec4 sigmaS, sigmaT;
+                    getSigmaST(parameters, h, sigmaS, sigmaT);
+
+                    HmckVec4 deltaSumSigmaT = sigmaT * dt;
+                    HmckVec4 eyeTrans = exp(-sumSigmaT - deltaSumSigmaT * 0.5f);
+
+                    if (!existsRaySphereIntersection(posR, sunDirection, parameters.planetRadius)) {
+                        bool inShadow = false;
+                        if (!shadowMap.texels.empty()) {
+                            HmckVec3 shadowPos = atmosphere.eye.XYZ + dir * (midT / WORLD_SCALE);
+                            HmckVec4 shadowClip = atmosphere.shadowViewProj * HmckVec4{shadowPos, 1.0f};
+                            HmckVec2 shadowUV = HmckVec2{shadowClip.X, shadowClip.Y} / shadowClip.W * 0.5f +
+                                                HmckVec2{0.5f, 0.5f};
+                            inShadow = true;
+                            if (shadowUV.X >= 0.0f && shadowUV.X <= 1.0f && shadowUV.Y >= 0.0f && shadowUV.Y <= 1.0f) {
+                                inShadow = shadowClip.Z >= shadowMap.sample(shadowUV.X, shadowUV.Y).X;
+                            }
+                        }
+
+                        if (!inShadow) {
+                            HmckVec4 rho = evalPhaseFunction(parameters, h, u);
+                            HmckVec4 sunTrans = getTransmittance(transmittance, h, sunTheta, atmosphereHeight);
+                            inScatter += eyeTrans * sigmaS * rho * sunTrans * dt;
+                        }
+                    }
+
+                    HmckVec4 ms = multipleScattering.sample(h / atmosphereHeight, 0.5f + 0.5f * std::sin(sunTheta));
+                    inScatter += eyeTrans * sigmaS * ms * dt;
+
+                    sumSigmaT += deltaSumSigmaT;
+                    t = nextT;
+                }
+
+                lut.at(x, y, z) = HmckVec4{inScatter.X, inScatter.Y, inScatter.Z, relativeLuminance(exp(-sumSigmaT))};
+
+                tBeg = tEnd;
+                tEnd = std::min(tEnd + sliceDepth, maxT);
+            }
+        }
+    });
+
+    return lut;
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <hammock/hammock.h>
+
+#include "Types.h"
+
+using namespace hammock;
+
+/**
+ * CPU side LUT image. Texels are stored as RGBA floats, x fastest then y then z,
+ * which is the same layout the compute shaders write into the R16G16B16A16_SFLOAT LUT images.
+ */
+struct ReferenceLut {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t depth = 1;
+    std::vector<HmckVec4> texels;
+
+    ReferenceLut() = default;
+
+    ReferenceLut(uint32_t width, uint32_t height, uint32_t depth = 1) : width(width), height(height), depth(depth),
+                                                                        texels(width * height * depth) {
+    }
+
+    HmckVec4 &at(uint32_t x, uint32_t y, uint32_t z = 0) { return texels[(z * height + y) * width + x]; }
+    const HmckVec4 &at(uint32_t x, uint32_t y, uint32_t z = 0) const { return texels[(z * height + y) * width + x]; }
+
+    size_t texelCount() const { return texels.size(); }
+
+    /**
+     * Bilinear sample of a 2D LUT (or of a single slice), mirrors the default linear repeat sampler used on the GPU
+     */
+    HmckVec4 sample(float u, float v, uint32_t z = 0) const;
+
+    /**
+     * Trilinear sample of a 3D LUT, repeats in all three directions like the default sampler
+     */
+    HmckVec4 sampleVolume(float u, float v, float w) const;
+
+    /**
+     * Converts the texels into the R16G16B16A16_SFLOAT memory layout of the GPU LUT
+     */
+    std::vector<uint16_t> toHalf() const;
+
+    /**
+     * Writes the LUT as HDR image for inspection, 3D LUTs are written one slice per file with _<z> suffix.
+     * Note that HDR format does not store alpha.
+     */
+    void writeImage(const std::string &filename) const;
+
+    /**
+     * Writes the exact R16G16B16A16_SFLOAT texel data, can be uploaded into the GPU LUT as is
+     */
+    void writeRaw(const std::string &filename) const;
+
+    /**
+     * Reads the data written by writeRaw. Dimensions have to be known upfront.
+     */
+    static ReferenceLut readRaw(const std::string &filename, uint32_t width, uint32_t height, uint32_t depth = 1);
+
+    /**
+     * Reads R32G32B32A32_SFLOAT texel data, such as the cloud capture of the application. Dimensions have to be known
+     * upfront.
+     */
+    static ReferenceLut readRawFloat(const std::string &filename, uint32_t width, uint32_t height);
+};
+
+/**
+ * Difference between two LUTs of the same dimensions, over all four channels
+ */
+struct LutError {
+    float maxAbsolute = 0.0f;
+    float meanAbsolute = 0.0f;
+    float maxRelative = 0.0f;
+
+    static LutError compare(const ReferenceLut &reference, const ReferenceLut &tested);
+};
+
+/**
+ * CPU reference implementation of the atmosphere LUT integrators.
+ * Each integrator evaluates exactly the same integral as its compute shader counterpart
+ * (transmittance.slang, multiplescattering.slang, skyview.slang, aerialperspective.slang) with the same
+ * sample counts, so the results can be used to bake the LUTs offline, to validate the GPU results
+ * and as a fallback when the GPU path is not available.
+ * The fixed step transmittance and the sky view march four texels of a row at once, one per HmckVec4 lane, so the
+ * arithmetic maps onto SSE. The other integrators carry the RGB wavelengths in HmckVec4. Rows are spread across the
+ * thread pool.
+ */
+class AtmosphereReference final {
+public:
+    explicit AtmosphereReference(uint32_t threadCount = std::thread::hardware_concurrency());
+
+    uint32_t getThreadCount() const { return threadCount; }
+
+    /**
+     * Computes the transmittance with the selected integrator.
+     * @param stepCount Overrides the step count of the fixed step raymarch, 0 keeps the one of the shader.
+     * Raymarch with many steps serves as the ground truth the integrators are compared against.
+     */
+    ReferenceLut computeTransmittance(const AtmosphereParameters &parameters, uint32_t width, uint32_t height,
+                                      TransmittanceIntegrator integrator = TransmittanceIntegrator::Raymarch,
+                                      uint32_t stepCount = 0);
+
+    ReferenceLut computeMultipleScattering(const AtmosphereParameters &parameters, const ReferenceLut &transmittance,
+                                           uint32_t width, uint32_t height);
+
+    ReferenceLut computeSkyView(const AtmosphereParameters &parameters, const AtmosphereUniformBufferData &atmosphere,
+                                const ReferenceLut &transmittance, const ReferenceLut &multipleScattering,
+                                uint32_t width, uint32_t height);
+
+    /**
+     * Computes the aerial perspective froxels.
+     * @param shadowMap Optional single channel sun depth in its x channel. When empty, nothing is shadowed,
+     * whereas the GPU treats everything outside the shadow map as shadowed.
+     */
+    ReferenceLut computeAerialPerspective(const AtmosphereParameters &parameters,
+                                          const AtmosphereUniformBufferData &atmosphere,
+                                          const ReferenceLut &transmittance, const ReferenceLut &multipleScattering,
+                                          uint32_t width, uint32_t height, uint32_t depth,
+                                          const ReferenceLut &shadowMap = {});
+
+private:
+    uint32_t threadCount;
+    ThreadPool threadPool;
+
+    // Runs kernel for every row in [0, rows), rows are split into one contiguous block per thread
+    void parallelFor(uint32_t rows, const std::function<void(uint32_t)> &kernel);
+};
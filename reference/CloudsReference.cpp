@@ -0,0 +1,702 @@
+#include "CloudsReference.h"
+
+#include <atomic>
+#include <filesystem>
+
+#include "clouds/WeatherSystem.h"
+
+// These have to match the constants in the shaders
+#define PI 3.14159265358979323846f
+#define EARTH_RADIUS 637800.0f // toolbox.slang
+#define CLOUDS_BOTTOM_RADIUS (EARTH_RADIUS + 6000.0f) // toolbox.slang
+#define CLOUDS_TOP_RADIUS (CLOUDS_BOTTOM_RADIUS + 10500.0f) // clouds.slang
+#define EPIC_DISTANCE 70000.0f // clouds.slang
+#define COVERAGE_REPEAT 9.0f // clouds.slang
+#define COVERAGE_DISTANCE_MARGIN 2.5f // clouds.slang
+#define BLUE_NOISE_ROTATION 0.61803398875f // toolbox.slang
+#define BLUE_NOISE_PERIOD 1024u // toolbox.slang
+
+namespace {
+    const HmckVec3 center{0.0f, -EARTH_RADIUS, 0.0f};
+    // Cloud types height density gradients, clouds.slang
+    const HmckVec4 stratusGradient{0.0f, 0.1f, 0.2f, 0.3f};
+    const HmckVec4 stratocumulusGradient{0.02f, 0.2f, 0.48f, 0.625f};
+    const HmckVec4 cumulusGradient{0.0f, 0.1625f, 0.88f, 0.98f};
+
+    // Shader intrinsics and toolbox.slang functions, HLSL argument order
+    float saturate(float x) { return std::clamp(x, 0.0f, 1.0f); }
+    float lerp(float a, float b, float t) { return a + (b - a) * t; }
+    float frac(float x) { return x - std::floor(x); }
+
+    float remap(float value, float inMin, float inMax, float outMin, float outMax) {
+        return outMin + (value - inMin) * (outMax - outMin) / (inMax - inMin);
+    }
+
+    HmckVec4 splat(float x) { return HmckVec4{x, x, x, x}; }
+
+    HmckVec4 saturate(HmckVec4 v) {
+        return HmckVec4{saturate(v.X), saturate(v.Y), saturate(v.Z), saturate(v.W)};
+    }
+
+    HmckVec4 sqrt(HmckVec4 v) {
+        return HmckVec4{std::sqrt(v.X), std::sqrt(v.Y), std::sqrt(v.Z), std::sqrt(v.W)};
+    }
+
+    HmckVec4 abs(HmckVec4 v) {
+        return HmckVec4{std::abs(v.X), std::abs(v.Y), std::abs(v.Z), std::abs(v.W)};
+    }
+
+    HmckVec4 max(HmckVec4 v, float m) {
+        return HmckVec4{std::max(v.X, m), std::max(v.Y, m), std::max(v.Z, m), std::max(v.W, m)};
+    }
+
+    HmckVec4 lerp(HmckVec4 a, HmckVec4 b, HmckVec4 t) { return a + (b - a) * t; }
+
+    HmckVec4 remap(HmckVec4 value, HmckVec4 inMin, float inMax, float outMin, float outMax) {
+        return splat(outMin) + (value - inMin) * (outMax - outMin) / (splat(inMax) - inMin);
+    }
+
+    HmckVec4 remap(HmckVec4 value, HmckVec4 inMin, HmckVec4 inMax, float outMin, float outMax) {
+        return splat(outMin) + (value - inMin) * (outMax - outMin) / (inMax - inMin);
+    }
+
+    HmckVec4 remap(HmckVec4 value, float inMin, float inMax, float outMin, float outMax) {
+        return splat(outMin) + (value - splat(inMin)) * ((outMax - outMin) / (inMax - inMin));
+    }
+
+    float powder(float d) { return 1.0f - std::exp(-2.0f * d); }
+
+    float henyeyGreensteinModified(float sundotrd, float ecc) {
+        return ((1.0f - ecc * ecc) / std::pow(1.0f + ecc * ecc - 2.0f * ecc * sundotrd, 1.5f)) / (4.0f * PI);
+    }
+
+    float directedPhase(float sundotrd, float eccentricity, float silverIntensity, float silverSpread) {
+        return std::max(henyeyGreensteinModified(sundotrd, eccentricity),
+                        silverIntensity * henyeyGreensteinModified(sundotrd, 0.999f - silverSpread));
+    }
+
+    // Near distance and length of the segment inside the sphere, zero when missed
+    HmckVec2 intersectRaySphere(HmckVec3 c, float r, HmckVec3 o, HmckVec3 d) {
+        HmckVec3 of = o - c;
+        float b = 2.0f * HmckDot(of, d);
+        float cc = HmckDot(of, of) - r * r;
+        float discriminant = b * b - 4.0f * cc;
+        if (discriminant > 0.0f) {
+            float s = std::sqrt(discriminant);
+            float dstToSphereNear = std::max(0.0f, (-b - s) / 2.0f);
+            float dstToSphereFar = (-b + s) / 2.0f;
+            if (dstToSphereFar >= 0.0f) {
+                return HmckVec2{dstToSphereNear, dstToSphereFar - dstToSphereNear};
+            }
+        }
+        return HmckVec2{0.0f, 0.0f};
+    }
+
+    uint32_t wrap(int32_t i, uint32_t size) {
+        int32_t m = i % static_cast<int32_t>(size);
+        return static_cast<uint32_t>(m < 0 ? m + static_cast<int32_t>(size) : m);
+    }
+
+    // Four points, one per HmckVec4 lane
+    struct Points {
+        HmckVec4 x, y, z;
+    };
+
+    // Distance of the four points from the given point
+    HmckVec4 distance(const Points &p, HmckVec3 q) {
+        HmckVec4 dx = p.x - splat(q.X), dy = p.y - splat(q.Y), dz = p.z - splat(q.Z);
+        return sqrt(dx * dx + dy * dy + dz * dz);
+    }
+
+    // Lanes of the mask, bit i stands for lane i
+    template<typename Function>
+    void forEachLane(uint32_t mask, Function &&function) {
+        for (uint32_t i = 0; i < 4; i++) {
+            if (mask & (1u << i)) {
+                function(i);
+            }
+        }
+    }
+
+    // Box filtered mip chain of a cubic volume, mirrors the mip count of getNumberOfMipLevels
+    std::vector<ReferenceLut> buildMips(ReferenceLut volume) {
+        std::vector<ReferenceLut> mips;
+        mips.push_back(std::move(volume));
+        while (mips.back().width > 1) {
+            const ReferenceLut &previous = mips.back();
+            ReferenceLut level{previous.width / 2, previous.height / 2, previous.depth / 2};
+            for (uint32_t z = 0; z < level.depth; z++) {
+                for (uint32_t y = 0; y < level.height; y++) {
+                    for (uint32_t x = 0; x < level.width; x++) {
+                        HmckVec4 sum{};
+                        for (uint32_t i = 0; i < 8; i++) {
+                            sum += previous.at(2 * x + (i & 1), 2 * y + ((i >> 1) & 1), 2 * z + (i >> 2));
+                        }
+                        level.at(x, y, z) = sum * 0.125f;
+                    }
+                }
+            }
+            mips.push_back(std::move(level));
+        }
+        return mips;
+    }
+
+    // Trilinear sample blended linearly between the two nearest mips
+    HmckVec4 sampleLevel(const std::vector<ReferenceLut> &mips, float u, float v, float w, float lod) {
+        lod = std::clamp(lod, 0.0f, static_cast<float>(mips.size() - 1));
+        const auto level = static_cast<uint32_t>(lod);
+        const float f = lod - static_cast<float>(level);
+        HmckVec4 a = mips[level].sampleVolume(u, v, w);
+        if (f == 0.0f) {
+            return a;
+        }
+        return a * (1.0f - f) + mips[level + 1].sampleVolume(u, v, w) * f;
+    }
+
+    // Reads a noise volume the renderer stored into the cache, channels are normalized like UNORM texels
+    ReferenceLut readNoiseVolume(const std::string &filename, uint32_t size, uint32_t channels) {
+        if (!std::filesystem::exists(filename)) {
+            throw std::runtime_error("cloud noise volume not found, run the application once to generate " + filename);
+        }
+        std::vector<char> file = Filesystem::readFile(filename);
+        if (file.size() != static_cast<size_t>(size) * size * size * channels) {
+            throw std::runtime_error("noise volume dimensions do not match the size of file: " + filename);
+        }
+        ReferenceLut volume{size, size, size};
+        for (size_t i = 0; i < volume.texelCount(); i++) {
+            for (uint32_t c = 0; c < channels; c++) {
+                const auto texel = static_cast<uint8_t>(file[i * channels + c]);
+                volume.texels[i].Elements[c] = static_cast<float>(texel) / 255.0f;
+            }
+        }
+        return volume;
+    }
+
+    /**
+     * Mirrors clouds.slang for one frame. Weather blend, light volume, far field and terrain depth are left out.
+     */
+    class CloudMarcher {
+    public:
+        CloudMarcher(const std::vector<ReferenceLut> &baseNoise, const std::vector<ReferenceLut> &detailNoise,
+                     const ReferenceLut &weatherMap, const ReferenceLut &coverageDistance,
+                     const ReferenceLut &curlNoise, const ReferenceLut &blueNoise,
+                     const CloudsUniformBufferData &data, const CloudsPushConstantData &constants)
+            : baseNoise(baseNoise), detailNoise(detailNoise), weatherMap(weatherMap),
+              coverageDistance(coverageDistance), curlNoise(curlNoise), blueNoise(blueNoise), data(data),
+              constants(constants), eye(data.cameraPosition.XYZ), windDirection(HmckNorm(data.windDirection.XYZ)),
+              sunDirection(HmckNorm(data.lightDirection.XYZ)) {
+        }
+
+        /**
+         * Mirrors getCloudSegment, finds the part of the pixel ray inside the cloud layer
+         * @param value Value of the pixel when the ray misses the cloud layer
+         * @return Whether the ray enters the cloud layer and has to be ray-marched
+         */
+        bool getCloudSegment(uint32_t x, uint32_t y, uint32_t width, uint32_t height, HmckVec3 &start, HmckVec3 &end,
+                             HmckVec4 &value) const {
+            // Compute ray direction
+            HmckVec4 rayClip{
+                2.0f * static_cast<float>(x) / static_cast<float>(width) - 1.0f,
+                2.0f * static_cast<float>(y) / static_cast<float>(height) - 1.0f, 1.0f, 1.0f
+            };
+            HmckVec4 rayView = HmckMulM4V4(data.invProj, rayClip);
+            rayView = HmckVec4{rayView.X, rayView.Y, -1.0f, 0.0f};
+            HmckVec3 rayDirection = HmckNorm(HmckMulM4V4(data.invView, rayView).XYZ);
+
+            HmckVec2 planetIntersect = intersectRaySphere(center, EARTH_RADIUS, eye, rayDirection);
+            HmckVec2 innerCloudIntersect = intersectRaySphere(center, CLOUDS_BOTTOM_RADIUS, eye, rayDirection);
+            HmckVec2 outerCloudIntersect = intersectRaySphere(center, CLOUDS_TOP_RADIUS, eye, rayDirection);
+            if (planetIntersect.Y > 0.0f) {
+                value = HmckVec4{};
+                return false;
+            }
+            float dstToStart = innerCloudIntersect.Y;
+            float dstToEnd = outerCloudIntersect.Y;
+            if (dstToEnd <= dstToStart || dstToStart < 0.0f) {
+                value = HmckVec4{1.0f, 0.0f, 0.0f, 1.0f};
+                return false;
+            }
+            start = eye + rayDirection * dstToStart;
+            end = eye + rayDirection * dstToEnd;
+            return true;
+        }
+
+        /**
+         * Mirrors renderPixel for a 2x2 pixel packet, one pixel per lane, the rays entering the cloud layer are
+         * ray-marched together
+         * @param pixels Values of the pixels, row by row
+         * @return Number of rays that were ray-marched
+         */
+        uint32_t renderPacket(uint32_t x0, uint32_t y0, uint32_t width, uint32_t height, HmckVec4 (&pixels)[4]) const {
+            Ray rays[4];
+            HmckVec3 starts[4];
+            uint32_t mask = 0;
+            for (uint32_t i = 0; i < 4; i++) {
+                const uint32_t x = x0 + (i & 1), y = y0 + (i >> 1);
+                HmckVec3 end;
+                if (x < width && y < height && getCloudSegment(x, y, width, height, starts[i], end, pixels[i])) {
+                    rays[i] = beginRay(x, y, starts[i], end, HmckLen(end - starts[i]));
+                    mask |= 1u << i;
+                }
+            }
+
+            raymarch(rays, mask);
+
+            uint32_t marched = 0;
+            forEachLane(mask, [&](uint32_t i) {
+                pixels[i] = endRay(rays[i]);
+                pixels[i].Z = saturate(HmckLen(starts[i] - eye) / CLOUDS_BOTTOM_RADIUS);
+                marched++;
+            });
+            return marched;
+        }
+
+    private:
+        const std::vector<ReferenceLut> &baseNoise;
+        const std::vector<ReferenceLut> &detailNoise;
+        const ReferenceLut &weatherMap;
+        const ReferenceLut &coverageDistance;
+        const ReferenceLut &curlNoise;
+        const ReferenceLut &blueNoise;
+        const CloudsUniformBufferData &data;
+        const CloudsPushConstantData &constants;
+        HmckVec3 eye;
+        HmckVec3 windDirection;
+        HmckVec3 sunDirection;
+
+        float getHeightFraction(HmckVec3 p) const {
+            return saturate((HmckLen(p - center) - CLOUDS_BOTTOM_RADIUS) / (CLOUDS_TOP_RADIUS - CLOUDS_BOTTOM_RADIUS));
+        }
+
+        // Mirrors getDensityGradient for four samples
+        static HmckVec4 getDensityGradient(HmckVec4 heightFraction, HmckVec4 cloudType) {
+            HmckVec4 stratusFactor = splat(1.0f) - saturate(cloudType * 2.0f);
+            HmckVec4 stratoCumulusFactor = splat(1.0f) - abs(cloudType - splat(0.5f)) * 2.0f;
+            HmckVec4 cumulusFactor = saturate(cloudType - splat(0.5f)) * 2.0f;
+            // One gradient per lane, its components laid out across the four vectors
+            HmckVec4 gradient[4];
+            for (int c = 0; c < 4; c++) {
+                gradient[c] = stratusFactor * stratusGradient.Elements[c] +
+                              stratoCumulusFactor * stratocumulusGradient.Elements[c] +
+                              cumulusFactor * cumulusGradient.Elements[c];
+            }
+            return remap(heightFraction, gradient[0], gradient[1], 0.0f, 1.0f) *
+                   remap(heightFraction, gradient[2], gradient[3], 1.0f, 0.0f);
+        }
+
+        /**
+         * Mirrors sampleCloudDensity for the lanes of the mask, the rest of the lanes is not sampled. Texture fetches
+         * and pow go lane by lane, the rest of the arithmetic is done for all four lanes at once.
+         * @param lod Mip level of the noise volumes per lane
+         */
+        HmckVec4 sampleCloudDensity(const Points &p, uint32_t mask, bool expensive, HmckVec4 lod) const {
+            const float windOffset = data.time * constants.cloudSpeed;
+
+            // Height fraction and uv coords for sampling
+            HmckVec4 radius = distance(p, center);
+            const float layerThickness = CLOUDS_TOP_RADIUS - CLOUDS_BOTTOM_RADIUS;
+            HmckVec4 heightFraction = saturate((radius - splat(CLOUDS_BOTTOM_RADIUS)) / layerThickness);
+            HmckVec4 staticU = p.x / CLOUDS_BOTTOM_RADIUS + splat(0.5f);
+            HmckVec4 staticV = p.z / CLOUDS_BOTTOM_RADIUS + splat(0.5f);
+            HmckVec4 animatedU = (p.x + heightFraction * windDirection.X + splat(windDirection.X * windOffset)) /
+                                 CLOUDS_BOTTOM_RADIUS + splat(0.5f);
+            HmckVec4 animatedV = (p.z + heightFraction * windDirection.Z + splat(windDirection.Z * windOffset)) /
+                                 CLOUDS_BOTTOM_RADIUS + splat(0.5f);
+
+            // Texture fetches are per lane
+            HmckVec4 lowFrequencyR{}, lowFrequencyG{}, coverageR{}, coverageG{}, cloudType{};
+            forEachLane(mask, [&](uint32_t i) {
+                HmckVec4 lowFrequencyNoise = sampleLevel(baseNoise, animatedU.Elements[i] * constants.baseScale,
+                                                         animatedV.Elements[i] * constants.baseScale,
+                                                         heightFraction.Elements[i], lod.Elements[i]);
+                lowFrequencyR.Elements[i] = lowFrequencyNoise.X;
+                lowFrequencyG.Elements[i] = lowFrequencyNoise.Y;
+                // Weather map is sampled without mips
+                HmckVec4 cloudMap = weatherMap.sample(animatedU.Elements[i] * COVERAGE_REPEAT,
+                                                      animatedV.Elements[i] * COVERAGE_REPEAT) *
+                                    constants.baseMultiplier;
+                coverageR.Elements[i] = cloudMap.X;
+                coverageG.Elements[i] = cloudMap.Y;
+                cloudType.Elements[i] = cloudMap.Z;
+            });
+
+            HmckVec4 baseCloud = remap(lowFrequencyR, lowFrequencyG - splat(1.0f), 1.0f, 0.0f, 1.0f) *
+                                 constants.globalDensity;
+
+            // Coverage is in red and green channels, cloud type in blue
+            HmckVec4 coverage = coverageG * (saturate(constants.globalCoverage - 0.5f) * 2.0f);
+            HmckVec4 coverageBase{
+                std::max(coverageR.X, coverage.X), std::max(coverageR.Y, coverage.Y),
+                std::max(coverageR.Z, coverage.Z), std::max(coverageR.W, coverage.W)
+            };
+            HmckVec4 anvilExponent = remap(heightFraction, 0.7f, 0.8f, 1.0f, lerp(1.0f, 0.5f, constants.anvilBias));
+            for (uint32_t i = 0; i < 4; i++) {
+                coverage.Elements[i] = std::pow(coverageBase.Elements[i], anvilExponent.Elements[i]);
+            }
+
+            // Make clouds on the horizon look bigger to create 'epic' view
+            if (constants.DEBUG_epicView == 1) {
+                HmckVec4 distanceFactor = saturate((distance(p, eye) - splat(EPIC_DISTANCE * 0.8f)) /
+                                                   (EPIC_DISTANCE * 0.1f));
+                HmckVec4 distanceFactor2 = distanceFactor * distanceFactor;
+                cloudType = lerp(cloudType, splat(1.0f), distanceFactor2 * distanceFactor2);
+            }
+            baseCloud = baseCloud * getDensityGradient(heightFraction, cloudType) / max(heightFraction, 0.001f);
+
+            // Apply the coverage
+            HmckVec4 baseCloudWithCoverage = saturate(remap(baseCloud, coverage, 1.0f, 0.0f, 1.0f) * coverage);
+
+            if (expensive) {
+                HmckVec4 detailU = staticU * constants.detailScale;
+                HmckVec4 detailV = staticV * constants.detailScale;
+                // Offset the detail noise to simulate atmospheric turbulence
+                if (constants.curliness > 0.0f) {
+                    HmckVec4 curlX{}, curlY{};
+                    forEachLane(mask, [&](uint32_t i) {
+                        HmckVec4 curl = curlNoise.sample(animatedU.Elements[i], animatedV.Elements[i]);
+                        curlX.Elements[i] = curl.X;
+                        curlY.Elements[i] = curl.Y;
+                    });
+                    HmckVec4 turbulence = (splat(1.0f) - heightFraction) * constants.curliness;
+                    detailU += curlX * turbulence;
+                    detailV += curlY * turbulence;
+                }
+                HmckVec4 highFrequencyFBM{};
+                forEachLane(mask, [&](uint32_t i) {
+                    highFrequencyFBM.Elements[i] = sampleLevel(detailNoise, detailU.Elements[i], detailV.Elements[i],
+                                                               heightFraction.Elements[i], lod.Elements[i]).X;
+                });
+                highFrequencyFBM = highFrequencyFBM * constants.detailMultiplier;
+                HmckVec4 t = saturate(heightFraction * 10.0f);
+                HmckVec4 highFrequencyNoiseModifier = highFrequencyFBM + (splat(1.0f) - highFrequencyFBM * 2.0f) * t;
+                baseCloudWithCoverage = remap(baseCloudWithCoverage, highFrequencyNoiseModifier, 1.0f, 0.0f, 1.0f);
+            }
+
+            return saturate(baseCloudWithCoverage);
+        }
+
+        // Mirrors emptySpaceDistance for the first weather map
+        float emptySpaceDistance(HmckVec3 p, HmckVec3 rayDirection) const {
+            float heightFraction = getHeightFraction(p);
+            HmckVec3 animation = windDirection * heightFraction + windDirection * (data.time * constants.cloudSpeed);
+            HmckVec3 q = p + animation;
+            float u = (q.X / CLOUDS_BOTTOM_RADIUS + 0.5f) * COVERAGE_REPEAT;
+            float v = (q.Z / CLOUDS_BOTTOM_RADIUS + 0.5f) * COVERAGE_REPEAT;
+
+            // Nearest texel, the weather map repeats
+            auto x = static_cast<int32_t>(std::floor(u * static_cast<float>(coverageDistance.width)));
+            auto y = static_cast<int32_t>(std::floor(v * static_cast<float>(coverageDistance.height)));
+            float distance = coverageDistance.at(wrap(x, coverageDistance.width), wrap(y, coverageDistance.height)).X;
+            distance -= COVERAGE_DISTANCE_MARGIN;
+            if (distance <= 0.0f) {
+                return 0.0f;
+            }
+
+            // Projection is planar, so the distance only limits the horizontal part of the ray
+            float texelSize = CLOUDS_BOTTOM_RADIUS / (COVERAGE_REPEAT * static_cast<float>(
+                                                          std::max(coverageDistance.width, coverageDistance.height)));
+            float horizontal = std::sqrt(rayDirection.X * rayDirection.X + rayDirection.Z * rayDirection.Z);
+            return distance * texelSize / std::max(horizontal, 1e-4f);
+        }
+
+        // Mirrors lightRayAttenuation, the cone samples are evaluated four at a time
+        float lightRayAttenuation(HmckVec3 p) const {
+            const int32_t lightSteps = constants.DEBUG_maxLightSamples;
+            const float stepSize = 0.5f * (CLOUDS_TOP_RADIUS - CLOUDS_BOTTOM_RADIUS) / static_cast<float>(lightSteps);
+            const float lastStepDistanceMultiplier = 5.0f;
+
+            // Offset vectors perpendicular to the light direction
+            HmckVec3 u = std::abs(sunDirection.X) < 0.99f
+                             ? HmckNorm(HmckCross(HmckVec3{1.0f, 0.0f, 0.0f}, sunDirection))
+                             : HmckNorm(HmckCross(HmckVec3{0.0f, 1.0f, 0.0f}, sunDirection));
+            HmckVec3 v = HmckCross(sunDirection, u);
+
+            float totalDensity = 0.0f;
+            for (int32_t first = 0; first < lightSteps; first += 4) {
+                const auto count = static_cast<uint32_t>(std::min(4, lightSteps - first));
+                Points samples{};
+                HmckVec4 lod{};
+                for (uint32_t i = 0; i < count; i++) {
+                    const int32_t l = first + static_cast<int32_t>(i);
+                    float t = static_cast<float>(l) / static_cast<float>(lightSteps - 1);
+                    float distanceFactor = l == lightSteps - 1 ? (1.0f + lastStepDistanceMultiplier) / 2.0f : t;
+                    float stepDistance = distanceFactor * static_cast<float>(lightSteps) * stepSize;
+                    // Cone widens as we move away, samples spiral around its axis
+                    float coneRadius = stepDistance * std::tan(0.03f);
+                    float angle = static_cast<float>(l) * 2.4f;
+                    float r = coneRadius * std::sqrt(t);
+                    HmckVec3 offset = (u * std::cos(angle) + v * std::sin(angle)) * r;
+                    HmckVec3 samplePos = p + sunDirection * stepDistance + offset;
+                    samples.x.Elements[i] = samplePos.X;
+                    samples.y.Elements[i] = samplePos.Y;
+                    samples.z.Elements[i] = samplePos.Z;
+                    lod.Elements[i] = static_cast<float>(l) * 0.5f;
+                }
+                HmckVec4 density = sampleCloudDensity(samples, (1u << count) - 1u, false, lod);
+                // Accumulated in the order of the steps like on the GPU
+                for (uint32_t i = 0; i < count; i++) {
+                    totalDensity += density.Elements[i] * stepSize * constants.absorption;
+                }
+            }
+
+            // Modified Beer's law so that the bottom of the clouds is not too dark
+            return saturate(std::max(std::exp(-totalDensity), std::exp(-totalDensity * 0.25f) * 0.7f));
+        }
+
+        // Mirrors sampleBlueNoise
+        float sampleBlueNoise(uint32_t x, uint32_t y) const {
+            float noise = blueNoise.at(x % blueNoise.width, y % blueNoise.height).X;
+            return frac(noise + static_cast<float>(data.frameIndex % BLUE_NOISE_PERIOD) * BLUE_NOISE_ROTATION);
+        }
+
+        // Locals of raymarch for one pixel, the pixels of a packet are marched side by side
+        struct Ray {
+            HmckVec3 p{};
+            HmckVec3 direction{};
+            float baseStepSize = 0.0f;
+            float currentStepSize = 0.0f;
+            float remainingDistance = 0.0f;
+            float phase = 0.0f;
+            float transmittance = 1.0f;
+            float accumulatedDensity = 0.0f;
+            float inScatteredLight = 0.0f;
+            float ambientLight = 0.0f;
+            int32_t emptyStepsCount = 0;
+            bool insideCloud = false;
+            bool everInCloud = false;
+            bool finished = false;
+        };
+
+        static constexpr float smallStepMultiplier = 1.0f;
+
+        // Mirrors the setup of raymarch
+        Ray beginRay(uint32_t x, uint32_t y, HmckVec3 start, HmckVec3 end, float layerLength) const {
+            HmckVec3 ray = end - start;
+            Ray r;
+            r.remainingDistance = HmckLen(ray);
+            r.direction = HmckNorm(ray);
+
+            // Fewer steps when looking up
+            const auto steps = static_cast<float>(constants.DEBUG_maxSamples);
+            float angleFactor = std::abs(r.direction.Y);
+            float numOfSteps = lerp(steps, steps * 0.5f, angleFactor);
+            r.baseStepSize = layerLength / numOfSteps;
+            r.currentStepSize = r.baseStepSize * constants.DEBUG_longStepMulti;
+
+            r.p = start + r.direction * (r.baseStepSize * sampleBlueNoise(x, y));
+
+            float cosTheta = HmckDot(sunDirection, r.direction);
+            r.phase = directedPhase(cosTheta, constants.eccentricity, constants.intensity, constants.spread);
+            return r;
+        }
+
+        /**
+         * Moves the ray to its next density sample, leaping over the air the weather map has no coverage in
+         * @return Whether there is a sample, the ray is finished otherwise
+         */
+        bool advanceToSample(Ray &r) const {
+            while (r.remainingDistance > 0.0f) {
+                if (r.insideCloud || constants.emptySpaceSkipping != 1) {
+                    return true;
+                }
+                float skip = emptySpaceDistance(r.p, r.direction);
+                if (skip <= r.currentStepSize) {
+                    return true;
+                }
+                r.p += r.direction * skip;
+                r.remainingDistance -= skip;
+            }
+            r.finished = true;
+            return false;
+        }
+
+        // Mirrors the body of the raymarch loop after the density sample
+        void takeSample(Ray &r, float density) const {
+            if (density > 0.05f) {
+                if (!r.insideCloud) {
+                    r.insideCloud = true;
+                    r.everInCloud = true;
+                    r.emptyStepsCount = 0;
+                    // Back up one large step and switch to small steps
+                    if (r.currentStepSize > r.baseStepSize) {
+                        r.p -= r.direction * r.currentStepSize;
+                        r.remainingDistance += r.currentStepSize;
+                        r.currentStepSize = r.baseStepSize * smallStepMultiplier;
+                        return;
+                    }
+                }
+
+                r.accumulatedDensity += density;
+                float heightFraction = getHeightFraction(r.p);
+                float powderTerm = powder(r.accumulatedDensity);
+                float transmittanceAlongLightRay = lightRayAttenuation(r.p);
+                float inScatterProb = 0.05f * std::pow(density, remap(heightFraction, 0.3f, 0.85f, 0.5f, 2.0f));
+                r.ambientLight += density * (1.0f - heightFraction) * r.transmittance;
+                r.inScatteredLight += density * r.currentStepSize * r.transmittance * powderTerm *
+                        transmittanceAlongLightRay * r.phase * inScatterProb;
+                r.transmittance *= std::exp(-density * r.currentStepSize * constants.absorption);
+
+                // Early exit if fully opaque
+                if (r.transmittance < 0.001f) {
+                    if (constants.DEBUG_earlyTermination == 1) {
+                        r.inScatteredLight = 0.0f;
+                    }
+                    r.finished = true;
+                    return;
+                }
+            } else {
+                // Several empty small steps switch back to large steps
+                r.emptyStepsCount++;
+                if (r.insideCloud && r.emptyStepsCount > 5) {
+                    r.insideCloud = false;
+                    r.currentStepSize = r.baseStepSize * constants.DEBUG_longStepMulti;
+                }
+            }
+
+            r.p += r.direction * r.currentStepSize;
+            r.remainingDistance -= r.currentStepSize;
+            if (r.remainingDistance < 0.0f || r.currentStepSize <= 0.0f) {
+                r.finished = true;
+            }
+        }
+
+        // Mirrors the result of raymarch, direct light strength in red, ambient light strength in green
+        HmckVec4 endRay(const Ray &r) const {
+            float transmittance = r.transmittance;
+            float inScatteredLight = r.inScatteredLight;
+            if (constants.DEBUG_lateTermination == 1 && !r.everInCloud) {
+                transmittance = 0.0f;
+                inScatteredLight = 0.0f;
+            }
+            return HmckVec4{
+                inScatteredLight * data.lightColor.W, r.ambientLight * constants.ambientStrength, 0.0f,
+                1.0f - transmittance
+            };
+        }
+
+        /**
+         * Mirrors the raymarch loop for the rays of the mask, the sun transmittance is always light-marched. Every
+         * ray keeps its own adaptive stepping, the rays still marching have their density sampled together, one per
+         * lane, until all of them are finished.
+         */
+        void raymarch(Ray (&rays)[4], uint32_t mask) const {
+            while (true) {
+                Points points{};
+                HmckVec4 lod{};
+                uint32_t sampled = 0;
+                forEachLane(mask, [&](uint32_t i) {
+                    Ray &r = rays[i];
+                    if (r.finished || !advanceToSample(r)) {
+                        return;
+                    }
+                    points.x.Elements[i] = r.p.X;
+                    points.y.Elements[i] = r.p.Y;
+                    points.z.Elements[i] = r.p.Z;
+                    // Distant samples only read coarser mips, the detail erosion is applied at every distance
+                    bool expensive = HmckLen(r.p - eye) < static_cast<float>(constants.DEBUG_cheapSampleDistance);
+                    lod.Elements[i] = expensive ? 0.0f : 2.0f;
+                    sampled |= 1u << i;
+                });
+                if (sampled == 0) {
+                    return;
+                }
+
+                HmckVec4 density = sampleCloudDensity(points, sampled, true, lod);
+                forEachLane(sampled, [&](uint32_t i) {
+                    takeSample(rays[i], density.Elements[i]);
+                });
+            }
+        }
+    };
+}
+
+CloudsReference::CloudsReference(const std::string &noiseCacheDirectory, const CloudNoiseParameters &noiseParameters,
+                                 WeatherMap weatherMapEnum, uint32_t threadCount)
+    : threadCount(std::max(threadCount, 1u)) {
+    threadPool.setThreadCount(this->threadCount);
+
+    baseNoise = buildMips(readNoiseVolume(
+        CloudNoiseGenerator::getBaseCacheFilename(noiseCacheDirectory, noiseParameters), noiseParameters.baseSize, 2));
+    detailNoise = buildMips(readNoiseVolume(
+        CloudNoiseGenerator::getDetailCacheFilename(noiseCacheDirectory, noiseParameters), noiseParameters.detailSize,
+        1));
+
+    // Weather map and its coverage distance field as the weather system uploads them
+    const WeatherSystem::DecodedWeather weather = WeatherSystem::decode(weatherMapEnum, 0, 0);
+    weatherMap = ReferenceLut{weather.width, weather.height};
+    coverageDistance = ReferenceLut{weather.width, weather.height};
+    for (size_t i = 0; i < weatherMap.texelCount(); i++) {
+        for (int c = 0; c < 4; c++) {
+            weatherMap.texels[i].Elements[c] = static_cast<float>(weather.texels[i * 4 + c]) / 255.0f;
+        }
+        coverageDistance.texels[i].X = weather.coverageDistance[i];
+    }
+
+    int w, h, c;
+    {
+        AutoDelete curlNoiseData(readImage(ASSET_PATH("curlNoise.png"), w, h, c,
+                                           Filesystem::ImageFormat::R8G8B8A8_UNORM), [](const void *p) {
+            delete[] static_cast<const uchar8_t *>(p);
+        });
+        const auto *texels = static_cast<const uchar8_t *>(curlNoiseData.get());
+        curlNoise = ReferenceLut{static_cast<uint32_t>(w), static_cast<uint32_t>(h)};
+        for (size_t i = 0; i < curlNoise.texelCount(); i++) {
+            for (int ch = 0; ch < 4; ch++) {
+                curlNoise.texels[i].Elements[ch] = static_cast<float>(texels[i * 4 + ch]) / 255.0f;
+            }
+        }
+    }
+    {
+        // Read as half floats like the renderer uploads it, so the jitter is bit exact
+        AutoDelete blueNoiseData(readImage(ASSET_PATH("blue_noise.png"), w, h, c,
+                                           Filesystem::ImageFormat::R16G16B16A16_SFLOAT), [](const void *p) {
+            delete[] static_cast<const float16_t *>(p);
+        });
+        const auto *texels = static_cast<const float16_t *>(blueNoiseData.get());
+        blueNoise = ReferenceLut{static_cast<uint32_t>(w), static_cast<uint32_t>(h)};
+        for (size_t i = 0; i < blueNoise.texelCount(); i++) {
+            for (int ch = 0; ch < 4; ch++) {
+                blueNoise.texels[i].Elements[ch] = float16float32(texels[i * 4 + ch]);
+            }
+        }
+    }
+}
+
+void CloudsReference::parallelFor(uint32_t rows, const std::function<void(uint32_t)> &kernel) {
+    const uint32_t rowsPerJob = (rows + threadCount - 1) / threadCount;
+    for (uint32_t begin = 0; begin < rows; begin += rowsPerJob) {
+        const uint32_t end = std::min(begin + rowsPerJob, rows);
+        threadPool.submit([&kernel, begin, end]() {
+            for (uint32_t row = begin; row < end; row++) {
+                kernel(row);
+            }
+        });
+    }
+    threadPool.wait();
+}
+
+ReferenceLut CloudsReference::render(const CloudsUniformBufferData &uniform,
+                                     const CloudsPushConstantData &properties, uint32_t width, uint32_t height) {
+    ReferenceLut image{width, height};
+    const CloudMarcher marcher{
+        baseNoise, detailNoise, weatherMap, coverageDistance, curlNoise, blueNoise, uniform, properties
+    };
+    std::atomic<uint64_t> rays{0};
+    // One row of 2x2 packets per job row
+    parallelFor((height + 1) / 2, [&](uint32_t row) {
+        uint64_t rowRays = 0;
+        for (uint32_t x0 = 0; x0 < width; x0 += 2) {
+            HmckVec4 pixels[4];
+            rowRays += marcher.renderPacket(x0, 2 * row, width, height, pixels);
+            for (uint32_t i = 0; i < 4; i++) {
+                const uint32_t x = x0 + (i & 1), y = 2 * row + (i >> 1);
+                if (x < width && y < height) {
+                    image.at(x, y) = pixels[i];
+                }
+            }
+        }
+        rays += rowRays;
+    });
+    marchedRays = rays;
+    return image;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <hammock/hammock.h>
+
+#include "AtmosphereReference.h"
+#include "Types.h"
+#include "clouds/CloudNoiseGenerator.h"
+
+using namespace hammock;
+
+/**
+ * CPU reference implementation of the cloud ray-march in clouds.slang. Ports sampleCloudDensity, lightRayAttenuation
+ * and raymarch over the same noise volumes, weather map, curl noise and blue noise the GPU samples, so the result
+ * serves as a golden image of the non-temporal ray-march target and as a fallback for cloud thumbnails.
+ * Pixels are marched in 2x2 packets, one ray per HmckVec4 lane. Each ray keeps its own adaptive stepping and the rays
+ * of a packet that are still marching have their density sampled together under a lane mask. The light march feeds
+ * the density four cone samples at a time. The density arithmetic maps onto SSE, the texture fetches and pow stay
+ * scalar per lane. Rows of packets are spread across the thread pool.
+ *
+ * The GPU image matches it when captured with the light volume, the far field and the temporal mode switched off.
+ * Terrain is not rendered, pixels the GPU leaves empty behind the terrain are skipped by the comparison.
+ */
+class CloudsReference final {
+public:
+    /**
+     * Loads the textures, throws when the noise volumes were never generated into the cache directory
+     * @param noiseCacheDirectory Directory the renderer stores the generated noise volumes into
+     */
+    CloudsReference(const std::string &noiseCacheDirectory, const CloudNoiseParameters &noiseParameters,
+                    WeatherMap weatherMap, uint32_t threadCount = std::thread::hardware_concurrency());
+
+    uint32_t getThreadCount() const { return threadCount; }
+
+    /**
+     * Ray-marches every pixel of the image. Only the first weather map is sampled.
+     * @param uniform Camera, sun, wind, time and frame index the GPU frame was rendered with
+     * @param properties Cloud properties, the sample counts are read from the debug values like the custom quality
+     */
+    ReferenceLut render(const CloudsUniformBufferData &uniform, const CloudsPushConstantData &properties,
+                        uint32_t width, uint32_t height);
+
+    // Rays of the last render that entered the cloud layer, the rest exits on the planet or the layer test
+    uint64_t getMarchedRayCount() const { return marchedRays; }
+
+private:
+    uint32_t threadCount;
+    ThreadPool threadPool;
+    uint64_t marchedRays = 0;
+
+    // Mip chains of the noise volumes, box filtered
+    std::vector<ReferenceLut> baseNoise;
+    std::vector<ReferenceLut> detailNoise;
+    ReferenceLut weatherMap;
+    // Coverage distance in the x channel
+    ReferenceLut coverageDistance;
+    ReferenceLut curlNoise;
+    ReferenceLut blueNoise;
+
+    // Runs kernel for every row in [0, rows), rows are split into one contiguous block per thread
+    void parallelFor(uint32_t rows, const std::function<void(uint32_t)> &kernel);
+};
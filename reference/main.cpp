@@ -0,0 +1,327 @@
+#include <iostream>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <hammock/hammock.h>
+
+#include "AtmosphereReference.h"
+#include "CloudsReference.h"
+#include "Camera.h"
+#include "atmosphere/Transmittance.h"
+#include "atmosphere/MultipleScattering.h"
+#include "atmosphere/SkyView.h"
+#include "atmosphere/AerialPerspective.h"
+#include "atmosphere/AtmosphereQuality.h"
+#include "clouds/CloudQuality.h"
+
+using namespace hammock;
+
+// Raymarch step count of the transmittance the integrators are compared against
+#define TRANSMITTANCE_GROUND_TRUTH_STEPS 8192
+
+// Runs the integrator the requested number of times and reports the best run, unit names what one texel stands for
+// count returns the number of units a run processes when it is not every texel of the result
+template<typename Function>
+ReferenceLut benchmark(const std::string &name, int32_t iterations, uint32_t threadCount, Function &&function,
+                       const std::string &unit = "texels", const std::function<uint64_t()> &count = {}) {
+    ReferenceLut lut;
+    double best = std::numeric_limits<double>::max();
+    for (int32_t i = 0; i < iterations; i++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        lut = function();
+        auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+    const double texelsPerSecond = static_cast<double>(count ? count() : lut.texelCount()) / best;
+    std::cout << name << ": " << best * 1000.0 << " ms, " << texelsPerSecond / static_cast<double>(threadCount) <<
+            " " << unit << "/s/core" << std::endl;
+    return lut;
+}
+
+// Compares the LUT with the raw dump of the same name in the directory, for example GPU readback
+void compare(const std::string &directory, const std::string &name, const ReferenceLut &reference) {
+    const std::string filename = (std::filesystem::path(directory) / (name + ".raw")).string();
+    if (!std::filesystem::exists(filename)) {
+        Logger::log(LOG_LEVEL_WARN, "Nothing to compare %s with, %s does not exist\n", name.c_str(),
+                    filename.c_str());
+        return;
+    }
+    ReferenceLut tested = ReferenceLut::readRaw(filename, reference.width, reference.height, reference.depth);
+    LutError error = LutError::compare(reference, tested);
+    std::cout << name << " error: max abs " << error.maxAbsolute << ", mean abs " << error.meanAbsolute << ", max rel "
+            << error.maxRelative << std::endl;
+}
+
+// Reports speed and error of every transmittance integrator against a dense raymarch
+void compareTransmittanceIntegrators(AtmosphereReference &reference, const AtmosphereParameters &parameters,
+                                     const VkExtent3D &extent, int32_t iterations) {
+    std::cout << "-- TRANSMITTANCE INTEGRATORS --" << std::endl;
+    ReferenceLut groundTruth = reference.computeTransmittance(parameters, extent.width, extent.height,
+                                                              TransmittanceIntegrator::Raymarch,
+                                                              TRANSMITTANCE_GROUND_TRUTH_STEPS);
+    const std::vector<std::pair<std::string, TransmittanceIntegrator> > integrators = {
+        {"Raymarch", TransmittanceIntegrator::Raymarch},
+        {"Adaptive", TransmittanceIntegrator::Adaptive},
+        {"Chapman", TransmittanceIntegrator::Chapman},
+    };
+    for (const auto &[name, integrator]: integrators) {
+        ReferenceLut lut = benchmark(name, iterations, reference.getThreadCount(), [&]() {
+            return reference.computeTransmittance(parameters, extent.width, extent.height, integrator);
+        });
+        LutError error = LutError::compare(groundTruth, lut);
+        std::cout << name << " error: max abs " << error.maxAbsolute << ", mean abs " << error.meanAbsolute <<
+                ", max rel " << error.maxRelative << std::endl;
+    }
+}
+
+// Renders the clouds from the given camera and compares them with the GPU capture of the same frame when there is one
+void referenceClouds(Camera camera, const HmckVec3 &sunDir, uint32_t width, WeatherMap weatherMap,
+                     CloudQuality quality, const std::string &noiseCache, const std::string &output,
+                     const std::string &compareDirectory, int32_t iterations, uint32_t threadCount) {
+    std::cout << "-- CLOUDS --" << std::endl;
+    const uint32_t height = std::max(width * 9 / 16, 1u);
+    camera.aspect = static_cast<float>(width) / static_cast<float>(height);
+
+    CloudsUniformBufferData uniform{};
+    uniform.view = camera.getView();
+    uniform.invView = HmckInvGeneral(uniform.view);
+    uniform.proj = camera.getProjection();
+    uniform.invProj = HmckInvGeneral(uniform.proj);
+    uniform.cameraPosition = HmckVec4{camera.position, 0.0f};
+    uniform.lightDirection = HmckVec4{HmckNorm(sunDir), 0.0f};
+    // Wind angle the user interface starts with
+    float wind = HmckToRad(HmckAngleDeg(233.0f));
+    uniform.windDirection = HmckVec4{HmckVec3{cos(wind), 0.0f, sin(wind)}, 0.0f};
+    uniform.resX = static_cast<float>(width);
+    uniform.resY = static_cast<float>(height);
+
+    // GPU capture has to be taken with the light volume and the far field switched off as well
+    CloudsPushConstantData properties{};
+    CloudQualitySettings::fromQuality(quality).apply(properties);
+    properties.lightVolume = 0;
+    properties.farField = 0;
+
+    CloudsReference clouds{noiseCache, CloudNoiseParameters{}, weatherMap, threadCount};
+    ReferenceLut image = benchmark("Clouds", iterations, threadCount, [&]() {
+        return clouds.render(uniform, properties, width, height);
+    }, "rays", [&]() { return clouds.getMarchedRayCount(); });
+    const std::string path = (std::filesystem::path(output) / "clouds").string();
+    image.writeImage(path);
+    image.writeRaw(path + ".raw");
+    if (compareDirectory.empty()) {
+        return;
+    }
+
+    const std::string filename = (std::filesystem::path(compareDirectory) / "clouds.raw").string();
+    const std::string depthFilename = (std::filesystem::path(compareDirectory) / "clouds_depth.raw").string();
+    if (!std::filesystem::exists(filename) || !std::filesystem::exists(depthFilename)) {
+        Logger::log(LOG_LEVEL_WARN, "Nothing to compare clouds with, %s or %s does not exist\n", filename.c_str(),
+                    depthFilename.c_str());
+        return;
+    }
+    ReferenceLut tested = ReferenceLut::readRawFloat(filename, width, height);
+    std::vector<char> depth = Filesystem::readFile(depthFilename);
+    if (depth.size() != image.texelCount() * sizeof(float)) {
+        throw std::runtime_error("Image dimensions do not match the size of file: " + depthFilename);
+    }
+    const auto *cameraDepth = reinterpret_cast<const float *>(depth.data());
+    ReferenceLut difference{width, height};
+    // HDR has no alpha, the opacity error gets an image of its own
+    ReferenceLut alphaDifference{width, height};
+    for (size_t i = 0; i < image.texelCount(); i++) {
+        // Terrain is not rendered by the reference, pixels it covers are masked out by the captured camera depth
+        if (cameraDepth[i] < 1.0f) {
+            tested.texels[i] = image.texels[i];
+        }
+        const HmckVec4 delta = image.texels[i] - tested.texels[i];
+        difference.texels[i] = HmckVec4{std::abs(delta.X), std::abs(delta.Y), std::abs(delta.Z), std::abs(delta.W)};
+        alphaDifference.texels[i] = HmckVec4{std::abs(delta.W), std::abs(delta.W), std::abs(delta.W), 1.0f};
+    }
+    LutError error = LutError::compare(image, tested);
+    std::cout << "clouds error: max abs " << error.maxAbsolute << ", mean abs " << error.meanAbsolute << ", max rel "
+            << error.maxRelative << std::endl;
+    difference.writeImage(path + "_error");
+    difference.writeRaw(path + "_error.raw");
+    alphaDifference.writeImage(path + "_error_alpha");
+}
+
+int main(int argc, char *argv[]) {
+    ArgParser parser;
+    parser.addArgument<std::string>("output", "Output directory for the baked LUTs", false);
+    parser.addArgument<int32_t>("threads", "Number of worker threads, defaults to hardware concurrency", false);
+    parser.addArgument<std::string>("planet", "Atmosphere preset: [earth, mars, hazy]", false);
+    parser.addArgument<int32_t>("iterations", "Number of timed runs of each integrator", false);
+    parser.addArgument<std::string>("compare", "Directory with raw LUT dumps to compare the reference with", false);
+    parser.addArgument<std::string>("quality", "LUT dimensions of the quality tier: [low, medium, high, ultra]", false);
+    parser.addArgument<std::string>("transmittance", "Transmittance integrator: [raymarch, adaptive, chapman]", false);
+    parser.addArgument<int32_t>("clouds", "Width of the cloud golden image, the clouds are skipped without it", false);
+    parser.addArgument<std::string>("noise-cache", "Cloud noise cache of the application, lut-cache by default", false);
+    parser.addArgument<std::string>("weather", "Weather map: [stratus, stratocumulus, cumulus, nubis]", false);
+    parser.addArgument<std::string>("cloud-quality", "Cloud ray-march quality: [low, medium, high, ultra]", false);
+
+    try {
+        parser.parse(argc, argv);
+    } catch (const std::exception &e) {
+        parser.printHelp();
+        Logger::log(LOG_LEVEL_ERROR, e.what());
+    }
+
+    auto output = parser.get<std::string>("output");
+    auto threads = parser.get<int32_t>("threads");
+    auto planet = parser.get<std::string>("planet");
+    auto iterations = std::max(parser.get<int32_t>("iterations"), 1);
+    auto compareDirectory = parser.get<std::string>("compare");
+    auto quality = parser.get<std::string>("quality");
+    auto transmittanceName = parser.get<std::string>("transmittance");
+    auto cloudsWidth = parser.get<int32_t>("clouds");
+    auto noiseCache = parser.get<std::string>("noise-cache");
+    auto weather = parser.get<std::string>("weather");
+    auto cloudQuality = parser.get<std::string>("cloud-quality");
+
+    if (output.empty())
+        output = ".";
+    std::filesystem::create_directories(output);
+
+    AtmospherePreset preset = AtmospherePreset::Earth;
+    if (!planet.empty()) {
+        if (planet == "earth")
+            preset = AtmospherePreset::Earth;
+        else if (planet == "mars")
+            preset = AtmospherePreset::Mars;
+        else if (planet == "hazy")
+            preset = AtmospherePreset::HazyEarth;
+        else {
+            Logger::log(LOG_LEVEL_ERROR, "Invalid planet!");
+            exit(EXIT_FAILURE);
+        }
+    }
+    AtmosphereParameters parameters = AtmosphereParameters::fromPreset(preset);
+
+    AtmosphereQuality qualityTier = AtmosphereQuality::High;
+    if (!quality.empty()) {
+        if (quality == "low")
+            qualityTier = AtmosphereQuality::Low;
+        else if (quality == "medium")
+            qualityTier = AtmosphereQuality::Medium;
+        else if (quality == "high")
+            qualityTier = AtmosphereQuality::High;
+        else if (quality == "ultra")
+            qualityTier = AtmosphereQuality::Ultra;
+        else {
+            Logger::log(LOG_LEVEL_ERROR, "Invalid quality!");
+            exit(EXIT_FAILURE);
+        }
+    }
+    const AtmosphereLutExtents extents = AtmosphereLutExtents::fromQuality(qualityTier);
+
+    TransmittanceIntegrator integrator = TransmittanceIntegrator::Raymarch;
+    if (!transmittanceName.empty()) {
+        if (transmittanceName == "raymarch")
+            integrator = TransmittanceIntegrator::Raymarch;
+        else if (transmittanceName == "adaptive")
+            integrator = TransmittanceIntegrator::Adaptive;
+        else if (transmittanceName == "chapman")
+            integrator = TransmittanceIntegrator::Chapman;
+        else {
+            Logger::log(LOG_LEVEL_ERROR, "Invalid transmittance integrator!");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    WeatherMap weatherMap = WeatherMap::Stratocumulus;
+    if (!weather.empty()) {
+        if (weather == "stratus")
+            weatherMap = WeatherMap::Stratus;
+        else if (weather == "stratocumulus")
+            weatherMap = WeatherMap::Stratocumulus;
+        else if (weather == "cumulus")
+            weatherMap = WeatherMap::Cumulus;
+        else if (weather == "nubis")
+            weatherMap = WeatherMap::Nubis;
+        else {
+            Logger::log(LOG_LEVEL_ERROR, "Invalid weather map!");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    CloudQuality cloudQualityTier = CloudQuality::Medium;
+    if (!cloudQuality.empty()) {
+        if (cloudQuality == "low")
+            cloudQualityTier = CloudQuality::Low;
+        else if (cloudQuality == "medium")
+            cloudQualityTier = CloudQuality::Medium;
+        else if (cloudQuality == "high")
+            cloudQualityTier = CloudQuality::High;
+        else if (cloudQuality == "ultra")
+            cloudQualityTier = CloudQuality::Ultra;
+        else {
+            Logger::log(LOG_LEVEL_ERROR, "Invalid cloud quality!");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (noiseCache.empty())
+        noiseCache = "lut-cache";
+
+    // Same camera and sun the renderer starts with
+    Camera camera{
+        HmckVec3{35.397, 4.296, 67.394}, 16.0f / 9.0f,
+        HmckToRad(HmckAngleDeg(65.f)), 0.1f, 300.f, 34.671, 0.300,
+    };
+    Camera::FrustumDirections frustum = camera.getFrustumDirections();
+    float azimuth = HmckToRad(HmckAngleDeg(334.286f));
+    float elevation = HmckToRad(HmckAngleDeg(48.673f));
+    HmckVec3 sunDir{cos(elevation) * sin(azimuth), sin(elevation), cos(elevation) * cos(azimuth)};
+
+    AtmosphereUniformBufferData atmosphere{};
+    atmosphere.eye = HmckVec4{camera.position, 0.0f};
+    atmosphere.sunDirection = HmckVec4{HmckNorm(sunDir), 0.0f};
+    atmosphere.frustumA = HmckVec4{frustum.frustumA, 0.0f};
+    atmosphere.frustumB = HmckVec4{frustum.frustumB, 0.0f};
+    atmosphere.frustumC = HmckVec4{frustum.frustumC, 0.0f};
+    atmosphere.frustumD = HmckVec4{frustum.frustumD, 0.0f};
+
+    AtmosphereReference reference{threads > 0 ? static_cast<uint32_t>(threads) : std::thread::hardware_concurrency()};
+    const uint32_t threadCount = reference.getThreadCount();
+    std::cout << "-- CPU REFERENCE (" << threadCount << " threads) --" << std::endl;
+
+    ReferenceLut transmittance = benchmark("Transmittance LUT", iterations, threadCount, [&]() {
+        return reference.computeTransmittance(parameters, extents.transmittance.width, extents.transmittance.height,
+                                              integrator);
+    });
+    ReferenceLut multipleScattering = benchmark("Multiple scattering LUT", iterations, threadCount, [&]() {
+        return reference.computeMultipleScattering(parameters, transmittance, extents.multipleScattering.width,
+                                                   extents.multipleScattering.height);
+    });
+    ReferenceLut skyView = benchmark("Sky view LUT", iterations, threadCount, [&]() {
+        return reference.computeSkyView(parameters, atmosphere, transmittance, multipleScattering,
+                                        extents.skyView.width, extents.skyView.height);
+    });
+    ReferenceLut aerialPerspective = benchmark("Aerial perspective LUT", iterations, threadCount, [&]() {
+        return reference.computeAerialPerspective(parameters, atmosphere, transmittance, multipleScattering,
+                                                  extents.aerialPerspective.width, extents.aerialPerspective.height,
+                                                  extents.aerialPerspective.depth);
+    });
+
+    const std::vector<std::pair<std::string, const ReferenceLut *> > luts = {
+        {"transmittance", &transmittance},
+        {"multiplescattering", &multipleScattering},
+        {"skyview", &skyView},
+        {"aerialperspective", &aerialPerspective},
+    };
+
+    for (const auto &[name, lut]: luts) {
+        const std::string path = (std::filesystem::path(output) / name).string();
+        lut->writeImage(path);
+        lut->writeRaw(path + ".raw");
+        if (!compareDirectory.empty()) {
+            compare(compareDirectory, name, *lut);
+        }
+    }
+    compareTransmittanceIntegrators(reference, parameters, extents.transmittance, iterations);
+    if (cloudsWidth > 0) {
+        referenceClouds(camera, sunDir, static_cast<uint32_t>(cloudsWidth), weatherMap, cloudQualityTier, noiseCache,
+                        output, compareDirectory, iterations, threadCount);
+    }
+    std::cout << "-- ---------------- --" << std::endl;
+}
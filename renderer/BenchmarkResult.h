@@ -47,6 +47,11 @@ struct BenchmarkResult {
     CircularBuffer multipleScatteringLUT{CIRCULAR_BUFFER_SIZE};
     CircularBuffer skyViewLUT{CIRCULAR_BUFFER_SIZE};
     CircularBuffer aerialPerspectiveLUT{CIRCULAR_BUFFER_SIZE};
+    // 1 if the LUT was not recomputed in the frame because its inputs did not change, 0 otherwise
+    CircularBuffer transmittanceLUTSkipped{CIRCULAR_BUFFER_SIZE};
+    CircularBuffer multipleScatteringLUTSkipped{CIRCULAR_BUFFER_SIZE};
+    CircularBuffer skyViewLUTSkipped{CIRCULAR_BUFFER_SIZE};
+    CircularBuffer aerialPerspectiveLUTSkipped{CIRCULAR_BUFFER_SIZE};
     CircularBuffer godRaysMask{CIRCULAR_BUFFER_SIZE};
     CircularBuffer godRaysBlur{CIRCULAR_BUFFER_SIZE};
     CircularBuffer skyUpsample{CIRCULAR_BUFFER_SIZE};
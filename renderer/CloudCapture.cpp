@@ -0,0 +1,134 @@
+#include "CloudCapture.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+    // Copies the whole image into host memory on the queue that owns it and restores its layout afterward
+    std::vector<char> readback(Device &device, ResourceManager &resourceManager, Image *image,
+                               VkImageAspectFlags aspect, VkImageLayout layout, uint32_t texelSize,
+                               CommandQueueFamily queueFamily) {
+        const VkExtent3D extent = image->getExtent();
+        const size_t texelCount = static_cast<size_t>(extent.width) * extent.height;
+
+        ResourceHandle readbackBuffer = resourceManager.createResource<Buffer>(
+            "cloud-capture-readback-buffer", BufferDesc{
+                .instanceSize = texelSize,
+                .instanceCount = static_cast<uint32_t>(texelCount),
+                .usageFlags = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                .allocationFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+            }
+        );
+        Buffer *buffer = resourceManager.getResource<Buffer>(readbackBuffer);
+
+        const bool compute = queueFamily == CommandQueueFamily::Compute;
+        VkCommandPool pool = compute ? device.getComputeCommandPool() : device.getGraphicsCommandPool();
+        VkQueue queue = compute ? device.computeQueue() : device.graphicsQueue();
+        VkCommandBufferAllocateInfo allocInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = pool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        };
+        VkCommandBuffer commandBuffer;
+        ASSERT(vkAllocateCommandBuffers(device.device(), &allocInfo, &commandBuffer) == VK_SUCCESS,
+               "Failed to allocate cloud capture command buffer!");
+        VkCommandBufferBeginInfo beginInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        };
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+        image->pipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+            VK_ACCESS_2_MEMORY_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+            VK_ACCESS_2_TRANSFER_READ_BIT,
+            layout,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED
+        );
+        VkBufferImageCopy region = {
+            .bufferOffset = 0,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = {
+                .aspectMask = aspect,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+            .imageOffset = {0, 0, 0},
+            .imageExtent = extent,
+        };
+        vkCmdCopyImageToBuffer(commandBuffer, image->getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                               buffer->getBuffer(), 1, &region);
+        image->pipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+            VK_ACCESS_2_NONE,
+            VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+            VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            layout,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED
+        );
+
+        vkEndCommandBuffer(commandBuffer);
+        VkSubmitInfo submitInfo = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &commandBuffer,
+        };
+        vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+        vkQueueWaitIdle(queue);
+        vkFreeCommandBuffers(device.device(), pool, 1, &commandBuffer);
+
+        std::vector<char> data(texelCount * texelSize);
+        buffer->map();
+        buffer->invalidate();
+        std::memcpy(data.data(), buffer->getMappedMemory(), data.size());
+        buffer->unmap();
+        resourceManager.releaseResource(readbackBuffer.getUid());
+        return data;
+    }
+
+    void writeFile(const std::string &filename, const void *data, size_t size) {
+        std::ofstream file{filename, std::ios::binary};
+        if (!file.is_open()) {
+            Logger::log(LOG_LEVEL_ERROR, "Failed to open cloud capture file %s\n", filename.c_str());
+            return;
+        }
+        file.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+        Logger::log(LOG_LEVEL_DEBUG, "Captured %s\n", filename.c_str());
+    }
+}
+
+void CloudCapture::capture(Device &device, ResourceManager &resourceManager, Image *color, Image *depth) const {
+    ASSERT(color->getExtent().width == depth->getExtent().width &&
+           color->getExtent().height == depth->getExtent().height,
+           "Cloud capture needs the clouds ray-marched at the camera depth resolution");
+
+    const std::vector<char> half = readback(device, resourceManager, color, VK_IMAGE_ASPECT_COLOR_BIT,
+                                            VK_IMAGE_LAYOUT_GENERAL, 4 * sizeof(uint16_t),
+                                            CommandQueueFamily::Graphics);
+    const std::vector<char> depthData = readback(device, resourceManager, depth, VK_IMAGE_ASPECT_DEPTH_BIT,
+                                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, sizeof(float),
+                                                 CommandQueueFamily::Compute);
+
+    // Widened on the CPU so that the reference compares against exactly what the GPU stored
+    const auto *halfTexels = reinterpret_cast<const uint16_t *>(half.data());
+    std::vector<float> texels(half.size() / sizeof(uint16_t));
+    for (size_t i = 0; i < texels.size(); i++) {
+        texels[i] = float16float32(halfTexels[i]);
+    }
+
+    std::filesystem::create_directories(directory);
+    writeFile((std::filesystem::path(directory) / "clouds.raw").string(), texels.data(),
+              texels.size() * sizeof(float));
+    writeFile((std::filesystem::path(directory) / "clouds_depth.raw").string(), depthData.data(), depthData.size());
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <hammock/hammock.h>
+
+#include "Types.h"
+
+using namespace hammock;
+
+/**
+ * Captures the clouds of a single frame for the comparison with the CPU reference. The clouds are rendered with the
+ * settings the reference implements: light volume, far field, temporal rendering and weather blend off, time and
+ * frame index zero. The first frames only let the LUTs, the weather map and the pipelines settle, the same frame is
+ * rendered every time. Renderer drives it: applies the settings every frame and calls capture in the capture frame.
+ *
+ * Writes two files into the directory, both without a header, rows from the top of the image:
+ * - clouds.raw, the cloud ray-march target as RGBA32F (direct light, ambient, depth, alpha)
+ * - clouds_depth.raw, the camera depth the ray-march was masked by as R32F, terrain covers texels below 1
+ */
+class CloudCapture final {
+public:
+    // Frames rendered before the capture
+    static constexpr uint32_t WARMUP_FRAMES = 8;
+
+    explicit CloudCapture(const std::string &directory) : directory(directory) {
+    }
+
+    bool isFinished() const { return frame > WARMUP_FRAMES; }
+    bool isCaptureFrame() const { return frame == WARMUP_FRAMES; }
+
+    /**
+     * Reads back the targets and writes them into the directory. The GPU has to be idle, blocks until it is written.
+     * @param color Cloud ray-march target, R16G16B16A16_SFLOAT in general layout owned by the graphics queue
+     * @param depth Camera depth, D32_SFLOAT in shader read only layout owned by the compute queue
+     */
+    void capture(Device &device, ResourceManager &resourceManager, Image *color, Image *depth) const;
+
+    /**
+     * Advances to the next frame
+     */
+    void endFrame() { frame++; }
+
+private:
+    std::string directory;
+    uint32_t frame = 0;
+};
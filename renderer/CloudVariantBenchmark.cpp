@@ -0,0 +1,26 @@
+#include "CloudVariantBenchmark.h"
+
+void CloudVariantBenchmark::addTiming(float time) {
+    if (isFinished() || frame < WARMUP_FRAMES) {
+        return;
+    }
+    if (results.size() <= run) {
+        results.push_back(RunResult{.quality = getQuality(), .specialized = isSpecialized()});
+    }
+    results[run].totalTime += time;
+    results[run].timedFrames++;
+}
+
+void CloudVariantBenchmark::endFrame() {
+    if (isFinished()) {
+        return;
+    }
+    if (++frame >= framesPerRun) {
+        // Run with no timed frames still gets its entry
+        if (results.size() <= run) {
+            results.push_back(RunResult{.quality = getQuality(), .specialized = isSpecialized()});
+        }
+        frame = 0;
+        run++;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "Types.h"
+
+/**
+ * Benchmark that renders every cloud quality preset for a number of frames twice, first with the pipelines the preset
+ * is baked into as specialization constants and then with the same settings pushed to the custom quality pipeline.
+ * Renderer drives it: applies getQuality() and isSpecialized() every frame and feeds the cloud pass times.
+ */
+class CloudVariantBenchmark final {
+public:
+    // Frames after the switch whose timings are not recorded, profiler results arrive a few frames late
+    static constexpr uint32_t WARMUP_FRAMES = 8;
+    static constexpr std::array<CloudQuality, 4> PRESETS = {
+        CloudQuality::Low, CloudQuality::Medium, CloudQuality::High, CloudQuality::Ultra
+    };
+
+    struct RunResult {
+        CloudQuality quality;
+        bool specialized;
+        double totalTime = 0.0;
+        uint32_t timedFrames = 0;
+
+        float averageTime() const {
+            return timedFrames > 0 ? static_cast<float>(totalTime / timedFrames) : 0.0f;
+        }
+    };
+
+    explicit CloudVariantBenchmark(uint32_t framesPerRun) : framesPerRun(
+        std::max(framesPerRun, WARMUP_FRAMES + 1)) {
+    }
+
+    bool isFinished() const { return run >= PRESETS.size() * 2; }
+    CloudQuality getQuality() const { return PRESETS[run / 2]; }
+    // Specialized run of each preset goes first
+    bool isSpecialized() const { return run % 2 == 0; }
+
+    /**
+     * Records GPU time of the cloud pass in ms
+     */
+    void addTiming(float time);
+
+    /**
+     * Advances to the next frame, moves to the next run once the current one has all its frames
+     */
+    void endFrame();
+
+    const std::vector<RunResult> &getResults() const { return results; }
+
+private:
+    uint32_t framesPerRun;
+    uint32_t run = 0;
+    uint32_t frame = 0;
+    std::vector<RunResult> results;
+};
@@ -22,6 +22,7 @@ public:
             .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 10000)
             .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 10000)
             .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 10000)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 10000)
             .build();
     };
 
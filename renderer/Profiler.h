@@ -3,11 +3,20 @@
 
 using namespace hammock;
 
+// Timings of one frame read back from the query pool, indexed by pass
+struct ProfilerResults {
+    std::vector<float> times;
+    // Pass was not recorded in that frame, its time only measures the empty query pair
+    std::vector<bool> skipped;
+};
+
 // Profiler is used to measure accurately how much time exactly each pass / dispatch takes using
 // timestamp queries https://docs.vulkan.org/samples/latest/samples/api/timestamp_queries/README.html
+// Every frame in flight writes its own range of the query pool, so results always come from a single frame
 class Profiler final {
 public:
-    Profiler(Device &device, uint32_t numOfPasses): device(device), numOfPasses(numOfPasses) {
+    Profiler(Device &device, uint32_t numOfPasses, uint32_t framesInFlight = SwapChain::MAX_FRAMES_IN_FLIGHT)
+        : device(device), numOfPasses(numOfPasses), framesInFlight(framesInFlight) {
         // First, we need to check if the device supports time stamp queries (most should)
         ASSERT(device.properties.limits.timestampPeriod > 0.f,
                "Device does not support timestamp queries: timestampPeriod is not greater than 0");
@@ -18,13 +27,16 @@ public:
         // Timestamps are stored along with their availability where n = timestamp, n + 1 = availability value
         // if availability value is > 0, timestamp is avialable
         timestamps.resize(4 * numOfPasses, 1);
-        results.resize(numOfPasses);
+        results.times.resize(numOfPasses);
+        results.skipped.resize(numOfPasses, false);
+        skipped.resize(framesInFlight, std::vector<bool>(numOfPasses, false));
+        recorded.resize(framesInFlight, false);
 
         // Create a query pool
         VkQueryPoolCreateInfo queryPoolInfo{};
         queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
         queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
-        queryPoolInfo.queryCount = static_cast<uint32_t>(numOfPasses * 2);
+        queryPoolInfo.queryCount = static_cast<uint32_t>(numOfPasses * 2 * framesInFlight);
         ASSERT(vkCreateQueryPool(device.device(), &queryPoolInfo, nullptr, &queryPoolTimestamps) == VK_SUCCESS,
                "Failed to allocate query pool timestamps!");
     }
@@ -33,27 +45,47 @@ public:
         vkDestroyQueryPool(device.device(), queryPoolTimestamps, nullptr);
     }
 
+    // Selects the range of the query pool the following calls record into, called before recording the frame
+    void beginFrame(uint32_t frameIndex) {
+        frame = frameIndex;
+        recorded[frame] = true;
+    }
+
     // This has to be called at the start of the frame to reset the query pool
     void resetTimestamp(VkCommandBuffer cmd, uint32_t query) {
        // if (timestamps[query * 2 + 1] != 0) {
-            vkCmdResetQueryPool(cmd, queryPoolTimestamps, query, 1);
+            vkCmdResetQueryPool(cmd, queryPoolTimestamps, firstQuery(frame) + query, 1);
        // }
 
     }
 
     void writeTimestamp(VkCommandBuffer cmd, uint32_t query, VkPipelineStageFlags2 stage) {
        // if (timestamps[query * 2 + 1] != 0) {
-            vkCmdWriteTimestamp2(cmd, stage, queryPoolTimestamps, query);
+            vkCmdWriteTimestamp2(cmd, stage, queryPoolTimestamps, firstQuery(frame) + query);
        // }
+        skipped[frame][query / 2] = false;
     }
 
+    // Used when the work measured by the query pair starting at query is not recorded this frame
+    // Both timestamps are still written so that the queries stay valid, and the pass is reported as skipped
+    void skipTimestamps(VkCommandBuffer cmd, uint32_t query) {
+        writeTimestamp(cmd, query, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT);
+        writeTimestamp(cmd, query + 1, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT);
+        skipped[frame][query / 2] = true;
+    }
 
-    // If available, results are read and stored
+
+    // If available, results of the oldest frame in flight are read and stored along with its skipped passes
     bool getResultsIfAvailable() {
+        uint32_t oldest = (frame + 1) % framesInFlight;
+        if (!recorded[oldest]) {
+            return false;
+        }
+
         VkResult result = vkGetQueryPoolResults(
             device.device(),
             queryPoolTimestamps,
-            0,
+            firstQuery(oldest),
             numOfPasses * 2,
             numOfPasses * 2 * 2 * sizeof(uint64_t),
             timestamps.data(),
@@ -72,27 +104,34 @@ public:
 
             if (availStart != 0 && availEnd != 0) {
                 float deltaTimeMs = (end - start) * device.properties.limits.timestampPeriod / 1000000.0f;
-                results[i] = deltaTimeMs;
+                results.times[i] = deltaTimeMs;
             } else {
                 return false;
             }
         }
 
+        results.skipped = skipped[oldest];
         return true;
     }
 
     // Get the results may be empty or partially filled
     // Call getResultsIfAvailable before to check if available
-    std::vector<float> getResults() {
+    ProfilerResults getResults() {
         return results;
     }
 
 private:
-
+    uint32_t firstQuery(uint32_t frameIndex) const { return frameIndex * numOfPasses * 2; }
 
     Device &device;
     VkQueryPool queryPoolTimestamps = VK_NULL_HANDLE;
     uint32_t numOfPasses;
+    uint32_t framesInFlight;
+    uint32_t frame = 0;
     std::vector<uint64_t> timestamps;
-    std::vector<float> results;
+    ProfilerResults results;
+    // Skipped passes of each frame in flight as recorded into its range of the query pool
+    std::vector<std::vector<bool>> skipped;
+    // Frames whose range of the query pool was reset and written at least once
+    std::vector<bool> recorded;
 };
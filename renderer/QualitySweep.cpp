@@ -0,0 +1,106 @@
+#include "QualitySweep.h"
+
+void QualitySweep::addTimings(const std::array<float, LUT_COUNT> &times) {
+    if (isFinished() || frame < WARMUP_FRAMES) {
+        return;
+    }
+    if (results.size() <= tier) {
+        results.push_back(TierResult{.quality = TIERS[tier]});
+    }
+    for (uint32_t i = 0; i < LUT_COUNT; i++) {
+        results[tier].totalTime[i] += times[i];
+    }
+    results[tier].timedFrames++;
+}
+
+bool QualitySweep::endFrame() {
+    if (isFinished()) {
+        return false;
+    }
+    return ++frame >= framesPerTier;
+}
+
+void QualitySweep::finishTier(const std::array<VkExtent3D, LUT_COUNT> &extents,
+                              std::array<std::vector<uint16_t>, LUT_COUNT> texels) {
+    if (results.size() <= tier) {
+        results.push_back(TierResult{.quality = TIERS[tier]});
+    }
+    TierResult &result = results[tier];
+    result.extents = extents;
+
+    for (uint32_t i = 0; i < LUT_COUNT; i++) {
+        std::vector<HmckVec4> decoded = decode(texels[i]);
+        if (tier == 0) {
+            reference[i] = std::move(decoded);
+            referenceExtents[i] = extents[i];
+        } else {
+            result.error[i] = compare(reference[i], referenceExtents[i], decoded, extents[i]);
+        }
+    }
+
+    frame = 0;
+    tier++;
+    if (isFinished()) {
+        reference = {};
+    }
+}
+
+std::vector<HmckVec4> QualitySweep::decode(const std::vector<uint16_t> &texels) {
+    std::vector<HmckVec4> decoded(texels.size() / 4);
+    for (size_t i = 0; i < decoded.size(); i++) {
+        for (int c = 0; c < 4; c++) {
+            decoded[i].Elements[c] = float16float32(texels[i * 4 + c]);
+        }
+    }
+    return decoded;
+}
+
+HmckVec4 QualitySweep::sample(const std::vector<HmckVec4> &texels, const VkExtent3D &extent, float u, float v,
+                              float w) {
+    // Texel centers are at (i + 0.5) / size
+    auto coordinate = [](float t, uint32_t size, uint32_t &i0, uint32_t &i1, float &f) {
+        const float x = std::clamp(t * static_cast<float>(size) - 0.5f, 0.0f, static_cast<float>(size - 1));
+        i0 = static_cast<uint32_t>(x);
+        i1 = std::min(i0 + 1, size - 1);
+        f = x - static_cast<float>(i0);
+    };
+    uint32_t x0, x1, y0, y1, z0, z1;
+    float fx, fy, fz;
+    coordinate(u, extent.width, x0, x1, fx);
+    coordinate(v, extent.height, y0, y1, fy);
+    coordinate(w, extent.depth, z0, z1, fz);
+
+    auto at = [&](uint32_t x, uint32_t y, uint32_t z) -> const HmckVec4 & {
+        return texels[(static_cast<size_t>(z) * extent.height + y) * extent.width + x];
+    };
+    auto bilinear = [&](uint32_t z) {
+        return HmckLerp(HmckLerp(at(x0, y0, z), fx, at(x1, y0, z)), fy, HmckLerp(at(x0, y1, z), fx, at(x1, y1, z)));
+    };
+    return HmckLerp(bilinear(z0), fz, bilinear(z1));
+}
+
+LutTierError QualitySweep::compare(const std::vector<HmckVec4> &reference, const VkExtent3D &referenceExtent,
+                                   const std::vector<HmckVec4> &tested, const VkExtent3D &testedExtent) {
+    LutTierError error{};
+    double sum = 0.0;
+    // Tested LUT is reconstructed at the texel centers of the reference the way the sampler would
+    for (uint32_t z = 0; z < referenceExtent.depth; z++) {
+        const float w = (static_cast<float>(z) + 0.5f) / static_cast<float>(referenceExtent.depth);
+        for (uint32_t y = 0; y < referenceExtent.height; y++) {
+            const float v = (static_cast<float>(y) + 0.5f) / static_cast<float>(referenceExtent.height);
+            for (uint32_t x = 0; x < referenceExtent.width; x++) {
+                const float u = (static_cast<float>(x) + 0.5f) / static_cast<float>(referenceExtent.width);
+                const HmckVec4 &expected = reference[
+                    (static_cast<size_t>(z) * referenceExtent.height + y) * referenceExtent.width + x];
+                const HmckVec4 actual = sample(tested, testedExtent, u, v, w);
+                for (int c = 0; c < 3; c++) {
+                    const float difference = std::abs(expected.Elements[c] - actual.Elements[c]);
+                    error.maxAbsolute = std::max(error.maxAbsolute, difference);
+                    sum += difference;
+                }
+            }
+        }
+    }
+    error.meanAbsolute = static_cast<float>(sum / (static_cast<double>(reference.size()) * 3.0));
+    return error;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <hammock/hammock.h>
+
+#include "Types.h"
+
+using namespace hammock;
+
+// Texel difference of a LUT against the same LUT of the ultra tier, over RGB
+struct LutTierError {
+    float meanAbsolute = 0.0f;
+    float maxAbsolute = 0.0f;
+};
+
+/**
+ * Benchmark that renders every atmosphere quality tier for a number of frames. All LUTs are recomputed every frame so
+ * that their GPU time can be measured, at the end of each tier they are read back and compared with the ultra tier.
+ * Renderer drives it: applies getQuality() when isTierStart(), feeds the profiler results and the readback.
+ */
+class QualitySweep final {
+public:
+    // Transmittance, multiple scattering, sky view and aerial perspective
+    static constexpr uint32_t LUT_COUNT = 4;
+    // Frames after the switch whose timings are not recorded, profiler results arrive a few frames late
+    static constexpr uint32_t WARMUP_FRAMES = 8;
+    // Ultra goes first as the reference
+    static constexpr std::array<AtmosphereQuality, 4> TIERS = {
+        AtmosphereQuality::Ultra, AtmosphereQuality::High, AtmosphereQuality::Medium, AtmosphereQuality::Low
+    };
+
+    struct TierResult {
+        AtmosphereQuality quality;
+        std::array<VkExtent3D, LUT_COUNT> extents{};
+        std::array<double, LUT_COUNT> totalTime{};
+        uint32_t timedFrames = 0;
+        std::array<LutTierError, LUT_COUNT> error{};
+
+        float averageTime(uint32_t lut) const {
+            return timedFrames > 0 ? static_cast<float>(totalTime[lut] / timedFrames) : 0.0f;
+        }
+    };
+
+    explicit QualitySweep(uint32_t framesPerTier) : framesPerTier(std::max(framesPerTier, WARMUP_FRAMES + 1)) {
+    }
+
+    bool isFinished() const { return tier >= TIERS.size(); }
+    bool isTierStart() const { return frame == 0; }
+    AtmosphereQuality getQuality() const { return TIERS[tier]; }
+
+    /**
+     * Records GPU times of the LUTs in ms, in the LUT_COUNT order
+     */
+    void addTimings(const std::array<float, LUT_COUNT> &times);
+
+    /**
+     * Advances to the next frame
+     * @return true if the current tier is finished and finishTier has to be called
+     */
+    bool endFrame();
+
+    /**
+     * Closes the current tier with the LUT contents it produced
+     * @param extents Dimensions of the LUTs
+     * @param texels R16G16B16A16_SFLOAT texels of the LUTs
+     */
+    void finishTier(const std::array<VkExtent3D, LUT_COUNT> &extents,
+                    std::array<std::vector<uint16_t>, LUT_COUNT> texels);
+
+    const std::vector<TierResult> &getResults() const { return results; }
+
+private:
+    uint32_t framesPerTier;
+    uint32_t tier = 0;
+    uint32_t frame = 0;
+    std::vector<TierResult> results;
+    // Ultra tier LUTs decoded to floats, kept until the sweep is done
+    std::array<std::vector<HmckVec4>, LUT_COUNT> reference;
+    std::array<VkExtent3D, LUT_COUNT> referenceExtents{};
+
+    static std::vector<HmckVec4> decode(const std::vector<uint16_t> &texels);
+
+    // Trilinear sample at normalized texel coordinates with clamp to edge addressing
+    static HmckVec4 sample(const std::vector<HmckVec4> &texels, const VkExtent3D &extent, float u, float v, float w);
+
+    static LutTierError compare(const std::vector<HmckVec4> &reference, const VkExtent3D &referenceExtent,
+                                const std::vector<HmckVec4> &tested, const VkExtent3D &testedExtent);
+};
@@ -227,10 +227,57 @@ void Renderer::prepareGeometry() {
     resourceManager.getResource<Buffer>(indexStagingBuffer)->unmap();
 }
 
+void Renderer::prepareBlueNoise() {
+    int w, h, c;
+    AutoDelete blueNoiseData(readImage(ASSET_PATH("blue_noise.png"), w, h, c,
+                                       Filesystem::ImageFormat::R16G16B16A16_SFLOAT), [](const void *p) {
+        delete[] static_cast<const float16_t *>(p);
+    });
+
+    // Create host visible staging buffer on device
+    ResourceHandle blueNoiseStagingBuffer = queueForDeletion(resourceManager.createResource<Buffer>(
+        "blue-noise-staging-buffer",
+        BufferDesc{
+            .instanceSize = sizeof(float16_t),
+            .instanceCount = static_cast<uint32_t>(w * h * c),
+            .usageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .allocationFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+        }
+    ));
+
+    // Write the data into the staging buffer
+    resourceManager.getResource<Buffer>(blueNoiseStagingBuffer)->map();
+    resourceManager.getResource<Buffer>(blueNoiseStagingBuffer)->writeToBuffer(blueNoiseData.get());
+
+    // Create the image resource
+    blueNoise = resourceManager.createResource<Image>(
+        "blue-noise",
+        ImageDesc{
+            .width = static_cast<uint32_t>(w),
+            .height = static_cast<uint32_t>(h),
+            .channels = static_cast<uint32_t>(c),
+            .format = VK_FORMAT_R16G16B16A16_SFLOAT,
+            .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .imageViewType = VK_IMAGE_VIEW_TYPE_2D,
+            .queueFamilies = {CommandQueueFamily::Graphics, CommandQueueFamily::Compute},
+            // Read by the clouds on the compute queue and by the god rays and the composition on the graphics queue
+            .sharingMode = VK_SHARING_MODE_CONCURRENT,
+        }
+    );
+
+    // Copy the data from buffer into the image
+    resourceManager.getResource<Image>(blueNoise)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    resourceManager.getResource<Image>(blueNoise)->queueCopyFromBuffer(
+        resourceManager.getResource<Buffer>(blueNoiseStagingBuffer)->getBuffer());
+    resourceManager.getResource<Image>(blueNoise)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
 void Renderer::init() {
     allocateCommandBuffers();
     createSyncObjects();
     prepareGeometry();
+    prepareBlueNoise();
 
     // Initialize threadpool
     processorCount = std::thread::hardware_concurrency();
@@ -249,7 +296,20 @@ void Renderer::init() {
     depthPass.setIndexBuffer(resourceManager.getResource<Buffer>(indexBuffer));
     depthPass.initialize(HmckVec2{(float) lWidth, (float) lHeight});
 
+    // Clouds come first, the aerial perspective reads the cloud shadow map
+    cloudsPass.setCameraDepth(depthPass.getCameraDepth());
+    cloudsPass.setBlueNoise(resourceManager.getResource<Image>(blueNoise));
+    cloudsPass.setRenderScale(cloudsRenderScale);
+    cloudsPass.quality = cloudQuality;
+    cloudsPass.setNoiseCacheDirectory(lutCacheDirectory);
+    cloudsPass.initialize(HmckVec2{static_cast<float>(lWidth), static_cast<float>(lHeight)});
+
     atmospherePass.setShadowMap(depthPass.getSunDepth());
+    atmospherePass.setCloudShadowMap(cloudsPass.getCloudShadowMap());
+    atmospherePass.setPreset(atmospherePreset);
+    atmospherePass.setCacheDirectory(lutCacheDirectory);
+    atmospherePass.setSkyViewBankLayers(skyViewBankLayers);
+    atmospherePass.setQuality(atmosphereQuality);
     atmospherePass.initialize();
 
 
@@ -257,21 +317,50 @@ void Renderer::init() {
     geometryPass.setIndexBuffer(resourceManager.getResource<Buffer>(indexBuffer));
     geometryPass.initialize(HmckVec2{static_cast<float>(lWidth), static_cast<float>(lHeight)});
 
-    cloudsPass.setCameraDepth(depthPass.getCameraDepth());
-    cloudsPass.initialize(HmckVec2{static_cast<float>(lWidth), static_cast<float>(lHeight)});
-
     godRaysPass.setCloudsImage(cloudsPass.getColorTarget());
     godRaysPass.setTerrainDepth(geometryPass.getDepthTarget());
-    godRaysPass.initialize(HmckVec2{static_cast<float>(lWidth) * 0.5f, static_cast<float>(lHeight) * 0.5f});
+    godRaysPass.setCloudShadowMap(cloudsPass.getCloudShadowMap());
+    godRaysPass.setBlueNoise(resourceManager.getResource<Image>(blueNoise));
+    // God rays are rendered in half resolution, sky and composition in full
+    const auto colorTarget = [](uint32_t width, uint32_t height) {
+        return ImageDesc{
+            .width = width,
+            .height = height,
+            .channels = 4,
+            .format = VK_FORMAT_R16G16B16A16_SFLOAT,
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .imageViewType = VK_IMAGE_VIEW_TYPE_2D,
+            .clearValue = {.color = {0.f, 0.f, 0.f, 0.f}},
+        };
+    };
+    const uint32_t mask = transientTargets.add("mask-image", colorTarget(lWidth / 2, lHeight / 2),
+                                               GodRaysMask, GodRaysBlur);
+    const uint32_t godRays = transientTargets.add("god-rays-image", colorTarget(lWidth / 2, lHeight / 2),
+                                                  GodRaysBlur, Composition);
+    const uint32_t sky = transientTargets.add("sky-color-image", colorTarget(lWidth, lHeight), Sky, Composition);
+    const uint32_t composited = transientTargets.add("composited-color-image", colorTarget(lWidth, lHeight),
+                                                     Composition, PostProcessing);
+    transientTargets.place();
+    // Mask is dead before the sky is rendered, they have to share memory
+    ASSERT(transientTargets.getAliasedSize() < transientTargets.getDedicatedSize(),
+           "Transient targets do not share any memory");
+
+    godRaysPass.setTargets(transientTargets.get(mask), transientTargets.get(godRays));
+    godRaysPass.initialize();
 
     compositionPass.setCloudsColor(cloudsPass.getColorTarget());
     compositionPass.setTerrainColor(geometryPass.getColorTarget());
     compositionPass.setTerrainDepth(geometryPass.getDepthTarget());
     compositionPass.setTransmittanceLUT(atmospherePass.transmittance.getLut());
     compositionPass.setSkyViewLUT(atmospherePass.skyView.getLut());
+    compositionPass.setSkyViewBank(atmospherePass.skyViewBank.getLut());
     compositionPass.setAerialPerspectiveLUT(atmospherePass.aerialPerspective.getLut());
     compositionPass.setSunShadow(depthPass.getSunDepth());
+    compositionPass.setCloudShadowMap(cloudsPass.getCloudShadowMap());
     compositionPass.setGodRaysTexture(godRaysPass.getGodRaysTexture());
+    compositionPass.setBlueNoise(resourceManager.getResource<Image>(blueNoise));
+    compositionPass.setTargets(transientTargets.get(sky), transientTargets.get(composited));
     compositionPass.initialize(HmckVec2{static_cast<float>(lWidth), static_cast<float>(lHeight)});
 
     postProcessingPass.setIinput(compositionPass.getColorTarget());
@@ -282,9 +371,55 @@ void Renderer::init() {
     ui->setCamera(&camera);
     ui->setCloudsPushData(&cloudsPass.properties);
     ui->setCloudsUniformData(&cloudsPass.uniform);
+    ui->setTemporalClouds(&cloudsPass.temporal);
+    ui->setCloudShadows(&cloudsPass.cloudShadows);
+    ui->setCloudQuality(&cloudsPass.quality);
+    ui->setWeather(&requestedWeatherMap, &weatherTransitionTime);
     ui->setPostProccessingData(&postProcessingPass.data);
     ui->setCompositionData(&compositionPass.data);
     ui->setGodRaysCoefficients(&godRaysPass.coefficients);
+    ui->setAtmosphereParameters(&atmospherePass.parameters, atmospherePreset);
+    ui->setAtmosphereQuality(&requestedAtmosphereQuality);
+    ui->setTransmittanceIntegrator(&atmospherePass.transmittanceIntegrator);
+}
+
+void Renderer::applyAtmosphereQuality(AtmosphereQuality quality) {
+    // Frames in flight still sample the old LUTs
+    device.waitIdle();
+    atmosphereQuality = quality;
+    requestedAtmosphereQuality = quality;
+    atmospherePass.setQuality(quality);
+
+    compositionPass.setTransmittanceLUT(atmospherePass.transmittance.getLut());
+    compositionPass.setSkyViewLUT(atmospherePass.skyView.getLut());
+    compositionPass.setSkyViewBank(atmospherePass.skyViewBank.getLut());
+    compositionPass.setAerialPerspectiveLUT(atmospherePass.aerialPerspective.getLut());
+    compositionPass.refreshLookUpTables();
+
+    // Cache key includes the LUT dimensions, so the new tier has its own cache entries
+    lutCacheLoaded = false;
+    lutCacheStored = false;
+}
+
+void Renderer::advanceQualitySweep() {
+    if (!qualitySweep->endFrame()) {
+        return;
+    }
+    // LUTs are written by the compute queue and read back from it, like the LUT cache does
+    device.waitIdle();
+    qualitySweep->finishTier(
+        {
+            atmospherePass.transmittance.getExtent(),
+            atmospherePass.multipleScattering.getExtent(),
+            atmospherePass.skyView.getExtent(),
+            atmospherePass.aerialPerspective.getExtent(),
+        },
+        {
+            atmospherePass.transmittance.readback(CommandQueueFamily::Compute),
+            atmospherePass.multipleScattering.readback(CommandQueueFamily::Compute),
+            atmospherePass.skyView.readback(CommandQueueFamily::Compute),
+            atmospherePass.aerialPerspective.readback(CommandQueueFamily::Compute),
+        });
 }
 
 
@@ -462,42 +597,6 @@ void Renderer::recordComputeToGraphicsTransfers(uint32_t frameIndex) {
             device.getGraphicsQueueFamilyIndex()
         );
 
-        atmospherePass.transmittance.getLut()->pipelineBarrier(
-            releaseCommandBuffer,
-            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-            VK_ACCESS_SHADER_WRITE_BIT,
-            VK_PIPELINE_STAGE_NONE,
-            VK_ACCESS_NONE,
-            VK_IMAGE_LAYOUT_GENERAL,
-            VK_IMAGE_LAYOUT_GENERAL,
-            device.getComputeQueueFamilyIndex(),
-            device.getGraphicsQueueFamilyIndex()
-        );
-
-        atmospherePass.skyView.getLut()->pipelineBarrier(
-            releaseCommandBuffer,
-            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-            VK_ACCESS_SHADER_WRITE_BIT,
-            VK_PIPELINE_STAGE_NONE,
-            VK_ACCESS_NONE,
-            VK_IMAGE_LAYOUT_GENERAL,
-            VK_IMAGE_LAYOUT_GENERAL,
-            device.getComputeQueueFamilyIndex(),
-            device.getGraphicsQueueFamilyIndex()
-        );
-
-        atmospherePass.aerialPerspective.getLut()->pipelineBarrier(
-            releaseCommandBuffer,
-            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-            VK_ACCESS_SHADER_WRITE_BIT,
-            VK_PIPELINE_STAGE_NONE,
-            VK_ACCESS_NONE,
-            VK_IMAGE_LAYOUT_GENERAL,
-            VK_IMAGE_LAYOUT_GENERAL,
-            device.getComputeQueueFamilyIndex(),
-            device.getGraphicsQueueFamilyIndex()
-        );
-
         VkSemaphoreSubmitInfo waitSemaphores[] = {
             {
                 .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
@@ -514,7 +613,7 @@ void Renderer::recordComputeToGraphicsTransfers(uint32_t frameIndex) {
         VkSemaphoreSubmitInfo signalSemaphore = {
             .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
             .semaphore = semaphores.computeToGraphicsSync[frameIndex],
-            .stageMask = VK_PIPELINE_STAGE_2_NONE,
+            .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
         };
 
         VkCommandBufferSubmitInfo cmdBufInfo = {
@@ -553,46 +652,26 @@ void Renderer::recordComputeToGraphicsTransfers(uint32_t frameIndex) {
             device.getGraphicsQueueFamilyIndex()
         );
 
-        atmospherePass.transmittance.getLut()->pipelineBarrier(
-            acquireCommandBuffer,
-            VK_PIPELINE_STAGE_NONE,
-            VK_ACCESS_NONE,
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-            VK_ACCESS_SHADER_READ_BIT,
-            VK_IMAGE_LAYOUT_GENERAL,
-            VK_IMAGE_LAYOUT_GENERAL,
-            device.getComputeQueueFamilyIndex(),
-            device.getGraphicsQueueFamilyIndex()
-        );
-
-        atmospherePass.skyView.getLut()->pipelineBarrier(
-            acquireCommandBuffer,
-            VK_PIPELINE_STAGE_NONE,
-            VK_ACCESS_NONE,
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-            VK_ACCESS_SHADER_READ_BIT,
-            VK_IMAGE_LAYOUT_GENERAL,
-            VK_IMAGE_LAYOUT_GENERAL,
-            device.getComputeQueueFamilyIndex(),
-            device.getGraphicsQueueFamilyIndex()
-        );
-
-        atmospherePass.aerialPerspective.getLut()->pipelineBarrier(
-            acquireCommandBuffer,
-            VK_PIPELINE_STAGE_NONE,
-            VK_ACCESS_NONE,
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-            VK_ACCESS_SHADER_READ_BIT,
-            VK_IMAGE_LAYOUT_GENERAL,
-            VK_IMAGE_LAYOUT_GENERAL,
-            device.getComputeQueueFamilyIndex(),
-            device.getGraphicsQueueFamilyIndex()
-        );
+        // Transmittance, sky view, aerial perspective and the sky view bank are shared concurrently and never
+        // transferred, only the compute writes of the frames they were computed in are made visible to the composition
+        VkMemoryBarrier2 lutBarrier = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+            .srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+            .dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT,
+        };
+        VkDependencyInfo lutDependency = {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = &lutBarrier,
+        };
+        vkCmdPipelineBarrier2(acquireCommandBuffer, &lutDependency);
 
         VkSemaphoreSubmitInfo waitSemaphore = {
             .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
             .semaphore = semaphores.computeToGraphicsSync[frameIndex],
-            .stageMask = VK_PIPELINE_STAGE_2_NONE, // Only barriers in the command buffer
+            .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, // Barriers in the command buffer chain with the wait
         };
 
         VkSemaphoreSubmitInfo signalSemaphore = {
@@ -659,7 +738,10 @@ void Renderer::handleInput() {
         camera.position += camera.upDirection() * movementSpeed * deltaTime;
 }
 
-Renderer::Renderer(const int32_t width, const int32_t height, WeatherMap weatherMap, TerrainType terrainType)
+Renderer::Renderer(const int32_t width, const int32_t height, WeatherMap weatherMap, TerrainType terrainType,
+                   AtmospherePreset atmospherePreset, const std::string &lutCacheDirectory,
+                   AtmosphereQuality atmosphereQuality, uint32_t skyViewBankLayers, uint32_t cloudsRenderScale,
+                   CloudQuality cloudQuality)
     : window{instance, "Vulkan atmospheric renderer", static_cast<int>(width), static_cast<int>(height)},
       device{instance, window.getSurface()}, resourceManager{device}, frameManager{window, device},
       profiler{device, 12},
@@ -670,7 +752,11 @@ Renderer::Renderer(const int32_t width, const int32_t height, WeatherMap weather
       atmospherePass(device, resourceManager, profiler),
       godRaysPass(device, resourceManager, profiler),
       compositionPass(device, resourceManager, profiler), postProcessingPass(device, resourceManager, profiler),
-      weatherMap(weatherMap), terrainType(terrainType) {
+      weatherMap(weatherMap), requestedWeatherMap(weatherMap), terrainType(terrainType),
+      atmospherePreset(atmospherePreset),
+      lutCacheDirectory(lutCacheDirectory), atmosphereQuality(atmosphereQuality),
+      requestedAtmosphereQuality(atmosphereQuality), skyViewBankLayers(skyViewBankLayers),
+      cloudsRenderScale(cloudsRenderScale), cloudQuality(cloudQuality) {
     // Initialize the descriptor pool object from which descriptors will be allocated
     // The numbers here are just for safety - there will never be this many allocations from the pool
     // We only need combined image samplers - this way we do not need a separate image and sampler objects - uniform buffers and storage images
@@ -713,6 +799,7 @@ void Renderer::update() {
     cloudsPass.uniform.znear = camera.znear;
     cloudsPass.uniform.zfar = camera.zfar;
     cloudsPass.uniform.frameIndexMod16 = frameIndex % 16;
+    cloudsPass.uniform.frameIndex = static_cast<uint32_t>(frameIndex);
     if (progressTime) {
         cloudsPass.uniform.time = elapsedTime;
     }
@@ -752,6 +839,49 @@ void Renderer::update() {
         HmckVec4{frustum.frustumD, 0.0f}
     );
 
+    // Quality sweep switches the tiers itself and keeps every LUT recomputed so that it can be timed
+    if (qualitySweep && !qualitySweep->isFinished()) {
+        if (qualitySweep->isTierStart()) {
+            applyAtmosphereQuality(qualitySweep->getQuality());
+        }
+        atmospherePass.invalidate();
+    } else if (requestedAtmosphereQuality != atmosphereQuality) {
+        applyAtmosphereQuality(requestedAtmosphereQuality);
+    }
+
+    // Cloud variant benchmark picks the preset and the pipeline kind, the pass switches the pipelines itself
+    if (cloudVariantBenchmark && !cloudVariantBenchmark->isFinished()) {
+        cloudsPass.quality = cloudVariantBenchmark->getQuality();
+        cloudsPass.specialized = cloudVariantBenchmark->isSpecialized();
+    }
+
+    // Cloud capture renders the same frame the CPU reference does, with only the features the reference implements
+    if (cloudCapture) {
+        cloudsPass.uniform.time = 0.0f;
+        cloudsPass.uniform.frameIndex = 0;
+        cloudsPass.uniform.frameIndexMod16 = 0;
+        cloudsPass.quality = cloudQuality;
+        cloudsPass.temporal = false;
+        cloudsPass.properties.lightVolume = 0;
+        cloudsPass.properties.farField = 0;
+        requestedWeatherMap = weatherMap;
+    }
+
+    // Weather streaming is polled here on the main thread as it submits to the transfer queue
+    cloudsPass.getWeather().transitionTo(requestedWeatherMap, weatherTransitionTime);
+    cloudsPass.getWeather().update(deltaTime);
+
+    // LUT cache is handled here on the main thread as it blocks on the compute queue
+    // Previous frame has to be finished before the computed LUTs can be read back
+    if (!lutCacheLoaded) {
+        atmospherePass.loadCache();
+        lutCacheLoaded = true;
+    } else if (!lutCacheStored) {
+        device.waitIdle();
+        atmospherePass.storeCache();
+        lutCacheStored = true;
+    }
+
     // Update depth pass
     depthPass.setCameraProjection(projection);
     depthPass.setCameraView(view);
@@ -776,6 +906,14 @@ void Renderer::update() {
     };
 
     godRaysPass.setSunScreenSpacePosition(screenSpaceSunPos.X, screenSpaceSunPos.Y);
+    godRaysPass.setCameraPosition(HmckVec4{camera.position, 0.0f});
+    godRaysPass.setFrameIndex(static_cast<uint32_t>(frameIndex));
+    godRaysPass.setCameraFrustum(
+        HmckVec4{frustum.frustumA, 0.0f},
+        HmckVec4{frustum.frustumB, 0.0f},
+        HmckVec4{frustum.frustumC, 0.0f},
+        HmckVec4{frustum.frustumD, 0.0f}
+    );
 
     compositionPass.setCameraPosition(HmckVec4{camera.position, 0.0f});
     compositionPass.setInvView(inverseView);
@@ -784,6 +922,7 @@ void Renderer::update() {
     compositionPass.setSunDirection(cloudsPass.uniform.lightDirection);
     compositionPass.setSunColor(cloudsPass.uniform.lightColor);
     compositionPass.setAmbientColor(cloudsPass.uniform.skyColorZenith);
+    compositionPass.setAtmosphereHeight(atmospherePass.parameters.atmosphereRadius - atmospherePass.parameters.planetRadius);
 }
 
 
@@ -792,7 +931,9 @@ void Renderer::render() {
     auto currentTime = std::chrono::high_resolution_clock::now();
 
     // Initialize the rendering loop
-    while (!window.shouldClose()) {
+    while (!window.shouldClose() && !(qualitySweep && qualitySweep->isFinished()) &&
+           !(cloudVariantBenchmark && cloudVariantBenchmark->isFinished()) &&
+           !(cloudCapture && cloudCapture->isFinished())) {
         // Poll for events
         window.pollEvents();
 
@@ -820,6 +961,7 @@ void Renderer::render() {
             // Record render passes
             uint32_t frame = frameManager.getFrameIndex();
             uint32_t image = frameManager.getSwapChainImageIndex();
+            profiler.beginFrame(frame);
 
             // First depth pass
             // Begin the depth pass command buffer
@@ -873,6 +1015,8 @@ void Renderer::render() {
                 frameManager.beginCommandBuffer(commandBuffers.clouds[frame]);
                 // record dispatches
                 cloudsPass.recordCommands(commandBuffers.clouds[frame], frame);
+                // Cloud shadow map is placed while the clouds are recorded
+                atmospherePass.setCloudShadow(cloudsPass.getCloudShadow());
                 // Atmosphere pass
                 frameManager.beginCommandBuffer(commandBuffers.atmosphere[frame]);
                 // record dispatches
@@ -991,6 +1135,11 @@ void Renderer::render() {
 
             // At this point we need to wait until all the commands from atmosphere, clouds and terrain are recorded and submitted
             threadPool.wait();
+            // Sky is sampled from the bank only in frames the atmosphere pass skipped the live sky view for
+            compositionPass.setSkyViewBankLayer(atmospherePass.getSkyViewBankLayer(),
+                                                atmospherePass.skyViewBank.getLayerCount());
+            compositionPass.setCloudShadow(cloudsPass.getCloudShadow());
+            godRaysPass.setCloudShadow(cloudsPass.getCloudShadow());
             // Compute to graphics sync and transfer, this waits on clouds, atmosphere and terrain and signals composition when finished
             recordComputeToGraphicsTransfers(frame);
 
@@ -998,6 +1147,10 @@ void Renderer::render() {
             frameManager.beginCommandBuffer(commandBuffers.composition[frame]);
             // We do not even render the god rays if they are not enabled
             if (compositionPass.data.applyGodRays) {
+                transientTargets.acquire(commandBuffers.composition[frame], GodRaysMask,
+                                         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+                transientTargets.acquire(commandBuffers.composition[frame], GodRaysBlur,
+                                         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
                 godRaysPass.recordCommands(commandBuffers.composition[frame], frame);
             } else {
                 // This is here for the validation layers to not throw error when the god rays pass is skipped
@@ -1011,6 +1164,9 @@ void Renderer::render() {
                 profiler.writeTimestamp(commandBuffers.composition[frame], 14, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT);
                 profiler.writeTimestamp(commandBuffers.composition[frame], 15, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT);
             }
+            transientTargets.acquire(commandBuffers.composition[frame], Sky, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+            transientTargets.acquire(commandBuffers.composition[frame], Composition,
+                                     VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
             compositionPass.recordCommands(commandBuffers.composition[frame], frame);
             // Transition swap image into color attachment layout
             // in big engines this is usually done at the start of the frame along with other resources so that the driver can better optimize that
@@ -1041,7 +1197,9 @@ void Renderer::render() {
 
             // Process results from the profiler
             if (profiler.getResultsIfAvailable()) {
-                std::vector<float> results = profiler.getResults();
+                ProfilerResults profilerResults = profiler.getResults();
+                const std::vector<float> &results = profilerResults.times;
+                const std::vector<bool> &skipped = profilerResults.skipped;
 
                 benchmarkResult.depthPrePass.add(results[0]);
                 benchmarkResult.cloudComputePass.add(results[1]);
@@ -1049,6 +1207,10 @@ void Renderer::render() {
                 benchmarkResult.multipleScatteringLUT.add(results[3]);
                 benchmarkResult.skyViewLUT.add(results[4]);
                 benchmarkResult.aerialPerspectiveLUT.add(results[5]);
+                benchmarkResult.transmittanceLUTSkipped.add(skipped[2]);
+                benchmarkResult.multipleScatteringLUTSkipped.add(skipped[3]);
+                benchmarkResult.skyViewLUTSkipped.add(skipped[4]);
+                benchmarkResult.aerialPerspectiveLUTSkipped.add(skipped[5]);
                 if (compositionPass.data.applyGodRays) {
                     benchmarkResult.godRaysMask.add(results[6]);
                     benchmarkResult.godRaysBlur.add(results[7]);
@@ -1061,6 +1223,29 @@ void Renderer::render() {
                 benchmarkResult.post.add(results[10]);
                 benchmarkResult.terrainDraw.add(results[11]);
                 benchmarkResult.total.add(deltaTime * 1000.0f);
+
+                if (qualitySweep) {
+                    qualitySweep->addTimings({results[2], results[3], results[4], results[5]});
+                }
+                if (cloudVariantBenchmark) {
+                    cloudVariantBenchmark->addTiming(results[1]);
+                }
+            }
+
+            if (qualitySweep) {
+                advanceQualitySweep();
+            }
+            if (cloudVariantBenchmark) {
+                cloudVariantBenchmark->endFrame();
+            }
+            if (cloudCapture) {
+                if (cloudCapture->isCaptureFrame()) {
+                    // Targets are read back from the queues that own them after the frame
+                    device.waitIdle();
+                    cloudCapture->capture(device, resourceManager, cloudsPass.getColorTarget(),
+                                          depthPass.getCameraDepth());
+                }
+                cloudCapture->endFrame();
             }
         }
     }
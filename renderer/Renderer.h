@@ -11,6 +11,10 @@
 #include "ui/UserInterface.h"
 #include "Profiler.h"
 #include "BenchmarkResult.h"
+#include "QualitySweep.h"
+#include "CloudVariantBenchmark.h"
+#include "CloudCapture.h"
+#include "TransientTargets.h"
 
 
 using namespace hammock;
@@ -74,6 +78,9 @@ class Renderer final {
     ResourceHandle vertexBuffer;
     ResourceHandle indexBuffer;
 
+    // Spatiotemporal blue noise shared by the ray-marching passes, rotated every frame
+    ResourceHandle blueNoise;
+
     // Actual geometry
     Geometry geometry;
 
@@ -122,6 +129,18 @@ class Renderer final {
     CompositionPass compositionPass;
     PostProcessingPass postProcessingPass;
 
+    // Steps of the composition command buffer in the order they are recorded, lifetimes of the transient targets
+    enum CompositionStep : uint32_t {
+        GodRaysMask = 0,
+        GodRaysBlur,
+        Sky,
+        Composition,
+        PostProcessing,
+    };
+
+    // Intermediate images of the god rays and the composition, the ones not alive at the same time share memory
+    TransientTargets transientTargets{device, resourceManager};
+
     // User interface system
     std::unique_ptr<::UserInterface> ui;
 
@@ -165,6 +184,11 @@ class Renderer final {
      */
     void prepareGeometry();
 
+    /**
+     * Loads the blue noise texture the clouds, the god rays and the composition sample
+     */
+    void prepareBlueNoise();
+
     /**
      * Initializes the renderer
      */
@@ -198,6 +222,17 @@ class Renderer final {
     void recordComputeToGraphicsTransfers(uint32_t frameIndex);
 
 
+    /**
+     * Recreates the atmosphere LUTs in the dimensions of the quality tier and points the composition to them.
+     * Waits until the GPU is idle.
+     */
+    void applyAtmosphereQuality(AtmosphereQuality quality);
+
+    /**
+     * Drives the quality sweep benchmark, called after the frame is submitted
+     */
+    void advanceQualitySweep();
+
     /**
      * All input related code is in here
      */
@@ -211,12 +246,38 @@ class Renderer final {
 
     // This is used to pass arguments from the main
     WeatherMap weatherMap = WeatherMap::Stratocumulus;
+    // Weather map selected in the user interface, the clouds blend to it over the transition time
+    WeatherMap requestedWeatherMap = WeatherMap::Stratocumulus;
+    float weatherTransitionTime = WEATHER_DEFAULT_TRANSITION_TIME;
     TerrainType terrainType = TerrainType::Default;
+    AtmospherePreset atmospherePreset = AtmospherePreset::Earth;
+    std::string lutCacheDirectory;
+    AtmosphereQuality atmosphereQuality = AtmosphereQuality::High;
+    // Tier selected in the user interface, applied at the start of the next frame
+    AtmosphereQuality requestedAtmosphereQuality = AtmosphereQuality::High;
+    // Active only in the quality sweep benchmark
+    std::unique_ptr<QualitySweep> qualitySweep;
+    // Sun elevations precomputed in the sky view bank, 0 computes the sky view live only
+    uint32_t skyViewBankLayers = 0;
+    // Clouds are ray-marched at the window resolution divided by this
+    uint32_t cloudsRenderScale = 1;
+    CloudQuality cloudQuality = CloudQuality::Medium;
+    // Active only in the cloud variant benchmark
+    std::unique_ptr<CloudVariantBenchmark> cloudVariantBenchmark;
+    // Active only when the clouds are captured for the CPU reference
+    std::unique_ptr<CloudCapture> cloudCapture;
+
+    // LUT cache is restored before the first frame and written once the first frame is finished
+    bool lutCacheLoaded{false};
+    bool lutCacheStored{false};
 
 public:
     // Constructor
     Renderer(const int32_t width, const int32_t height, WeatherMap weatherMap = WeatherMap::Stratocumulus,
-             TerrainType terrainType = TerrainType::Default);
+             TerrainType terrainType = TerrainType::Default, AtmospherePreset atmospherePreset = AtmospherePreset::Earth,
+             const std::string &lutCacheDirectory = "lut-cache",
+             AtmosphereQuality atmosphereQuality = AtmosphereQuality::High, uint32_t skyViewBankLayers = 0,
+             uint32_t cloudsRenderScale = 1, CloudQuality cloudQuality = CloudQuality::Medium);
 
     // Destructor
     ~Renderer();
@@ -228,4 +289,36 @@ public:
 
     // Used to retrieve profiler data after the end of the rendering loo
     BenchmarkResult &getBenchmarkResult() { return benchmarkResult; }
+
+    /**
+     * Makes the rendering loop sweep all atmosphere quality tiers and end once the last tier is done
+     * @param framesPerTier Number of frames rendered with each tier
+     */
+    void enableQualitySweep(uint32_t framesPerTier) { qualitySweep = std::make_unique<QualitySweep>(framesPerTier); }
+
+    // Results of the quality sweep, empty if it was not enabled
+    std::vector<QualitySweep::TierResult> getQualitySweepResults() const {
+        return qualitySweep ? qualitySweep->getResults() : std::vector<QualitySweep::TierResult>{};
+    }
+
+    /**
+     * Makes the rendering loop time every cloud quality preset with and without specialization and end once done
+     * @param framesPerRun Number of frames rendered with each preset and pipeline kind
+     */
+    void enableCloudVariantBenchmark(uint32_t framesPerRun) {
+        cloudVariantBenchmark = std::make_unique<CloudVariantBenchmark>(framesPerRun);
+    }
+
+    // Results of the cloud variant benchmark, empty if it was not enabled
+    std::vector<CloudVariantBenchmark::RunResult> getCloudVariantBenchmarkResults() const {
+        return cloudVariantBenchmark
+                   ? cloudVariantBenchmark->getResults()
+                   : std::vector<CloudVariantBenchmark::RunResult>{};
+    }
+
+    /**
+     * Makes the rendering loop render the clouds with the CPU reference settings, capture them and end
+     * @param directory Directory the capture is written into
+     */
+    void enableCloudCapture(const std::string &directory) { cloudCapture = std::make_unique<CloudCapture>(directory); }
 };
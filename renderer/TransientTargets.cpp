@@ -0,0 +1,74 @@
+#include "TransientTargets.h"
+
+TransientTargets::~TransientTargets() {
+    // Aliased images do not own their memory, release them before the heaps
+    for (const Target &target: targets) {
+        if (target.handle.isValid()) {
+            resourceManager.releaseResource(target.handle.getUid());
+        }
+    }
+    for (VmaAllocation heap: heaps) {
+        vmaFreeMemory(device.allocator(), heap);
+    }
+}
+
+uint32_t TransientTargets::add(const std::string &name, const ImageDesc &desc, uint32_t firstUse, uint32_t lastUse) {
+    ASSERT(heaps.empty(), "Transient targets are already placed");
+    ASSERT(desc.memoryFlags == VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "Transient images are device local");
+    targets.push_back({.name = name, .desc = desc, .firstUse = firstUse, .lastUse = lastUse});
+    return static_cast<uint32_t>(targets.size() - 1);
+}
+
+void TransientTargets::place() {
+    TransientAllocator allocator;
+    for (const Target &target: targets) {
+        VkMemoryRequirements requirements = Image(device, 0, target.name, target.desc).getMemoryRequirements();
+        allocator.addResource(requirements.size, requirements.alignment, requirements.memoryTypeBits,
+                              target.firstUse, target.lastUse);
+    }
+    allocator.place();
+    ASSERT(allocator.isValid(), "Transient targets alive at the same time share memory");
+
+    for (const auto &heap: allocator.getHeaps()) {
+        VkMemoryRequirements requirements = {
+            .size = heap.size, .alignment = heap.alignment, .memoryTypeBits = heap.memoryTypeBits
+        };
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        checkResult(vmaAllocateMemory(device.allocator(), &requirements, &allocInfo, &allocation, nullptr));
+        heaps.push_back(allocation);
+    }
+
+    for (uint32_t i = 0; i < targets.size(); i++) {
+        Target &target = targets[i];
+        const TransientAllocator::Placement &placement = allocator.getPlacement(i);
+        ImageDesc desc = target.desc;
+        desc.aliasingAllocation = heaps[placement.heap];
+        desc.aliasingOffset = placement.offset;
+        target.handle = resourceManager.createResource<Image>(target.name, desc);
+        // Descriptors are written with the layout the images are sampled in
+        get(i)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+
+    dedicatedSize = allocator.getDedicatedSize();
+    aliasedSize = allocator.getAliasedSize();
+    constexpr double megabyte = 1024.0 * 1024.0;
+    Logger::log(LOG_LEVEL_DEBUG, "Transient targets: %d, dedicated %.1f MB, aliased %.1f MB in %d heaps\n",
+                static_cast<int>(targets.size()), dedicatedSize / megabyte, aliasedSize / megabyte,
+                static_cast<int>(heaps.size()));
+}
+
+void TransientTargets::acquire(VkCommandBuffer commandBuffer, uint32_t step, VkImageLayout layout) const {
+    for (uint32_t i = 0; i < targets.size(); i++) {
+        if (targets[i].firstUse != step) {
+            continue;
+        }
+        get(i)->pipelineBarrier(commandBuffer,
+                                VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_WRITE_BIT,
+                                VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                                VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
+                                VK_IMAGE_LAYOUT_UNDEFINED, layout,
+                                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED);
+    }
+}
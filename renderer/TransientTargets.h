@@ -0,0 +1,64 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <hammock/hammock.h>
+
+using namespace hammock;
+
+/**
+ * Intermediate images of the composition command buffer that are only alive between two of its steps. They are placed
+ * by the transient allocator of the render graph, images whose lifetimes do not overlap share memory. Lifetimes are
+ * positions of the steps in the order they are recorded, the renderer declares them by hand as it records the frame
+ * without the render graph. All frames in flight share the images, like the rest of the renderer targets.
+ */
+class TransientTargets final {
+public:
+    TransientTargets(Device &device, ResourceManager &resourceManager) : device(device),
+                                                                         resourceManager(resourceManager) {
+    }
+
+    ~TransientTargets();
+
+    /**
+     * Declares a device local image, has to be called before place
+     * @param firstUse Position of the first step using the image
+     * @param lastUse Position of the last step using the image, inclusive
+     * @return Index of the image
+     */
+    uint32_t add(const std::string &name, const ImageDesc &desc, uint32_t firstUse, uint32_t lastUse);
+
+    /**
+     * Allocates the shared memory and creates the images in it. Logs the memory with and without aliasing and checks
+     * that the images alive together do not overlap.
+     */
+    void place();
+
+    Image *get(uint32_t index) const { return resourceManager.getResource<Image>(targets[index].handle); }
+
+    /**
+     * Discards the content of the images whose lifetime starts at the step. Their memory was used by other images in
+     * between, so all previous access to it has to finish before the image is written.
+     * @param layout Layout the step expects the images in
+     */
+    void acquire(VkCommandBuffer commandBuffer, uint32_t step, VkImageLayout layout) const;
+
+    // Memory the images would take with dedicated allocations and the memory they share, available after place
+    uint64_t getDedicatedSize() const { return dedicatedSize; }
+    uint64_t getAliasedSize() const { return aliasedSize; }
+
+private:
+    struct Target {
+        std::string name;
+        ImageDesc desc;
+        uint32_t firstUse;
+        uint32_t lastUse;
+        ResourceHandle handle;
+    };
+
+    Device &device;
+    ResourceManager &resourceManager;
+    std::vector<Target> targets;
+    std::vector<VmaAllocation> heaps;
+    uint64_t dedicatedSize = 0;
+    uint64_t aliasedSize = 0;
+};
@@ -18,6 +18,35 @@ enum class TerrainType{
     Mountain,
 };
 
+enum class AtmospherePreset{
+    Earth,
+    Mars,
+    HazyEarth,
+};
+
+enum class AtmosphereQuality{
+    Low,
+    Medium,
+    High,
+    Ultra,
+};
+
+// How the transmittance LUT integrates the optical depth
+enum class TransmittanceIntegrator{
+    Raymarch, // Fixed step count
+    Adaptive, // Step length follows the density
+    Chapman, // Closed form for the exponential layers
+};
+
+// Ray-march settings of the clouds, custom reads them from the push constants instead of baking them into the pipeline
+enum class CloudQuality{
+    Low,
+    Medium,
+    High,
+    Ultra,
+    Custom,
+};
+
 struct GeometryPushConstantData {
     HmckMat4 modelViewProjection;
     HmckVec4 lightDirection;
@@ -25,6 +54,15 @@ struct GeometryPushConstantData {
     HmckVec4 ambientLightColor = {0.1f, 0.1f,0.1f,0.0f};
 };
 
+// Placement of the top-down cloud shadow map, mirrors CloudShadowData in toolbox.slang
+struct CloudShadowData {
+    HmckVec4 origin{}; // XZ corner of the map on the cloud base, moved by the wind since the map was built
+    float extent = 0.0f; // XZ size of the map
+    int valid = 0; // 0 while the map is disabled or was never built
+    uint32_t generation = 0; // Incremented whenever the map is rebuilt
+    float _padding;
+};
+
 // Data for cloud pass passed as uniform buffer
 struct CloudsUniformBufferData {
     HmckMat4 invView;
@@ -36,6 +74,12 @@ struct CloudsUniformBufferData {
     HmckVec4 lightDirection{0.0f, 1.0f, 0.f, 0.0f};
     HmckVec4 skyColorZenith{59.0 / 255.0, 110.0 / 255.0, 219.0 / 255.0};
     HmckVec4 windDirection{};
+    HmckMat4 previousViewProj;
+    HmckVec4 windOffset{}; // Wind movement of the clouds since the previous frame
+    HmckVec4 lightVolumeOrigin{}; // XZ corner of the cloud light volume, moved by the wind since it was built
+    HmckVec4 lightVolumeExtent{}; // XZ size of the cloud light volume
+    HmckVec4 farFieldDistances[2]{}; // Far-field distance each impostor face was rendered with, four faces per vector
+    CloudShadowData cloudShadow{};
     float resX;
     float resY;
     float fov;
@@ -43,7 +87,11 @@ struct CloudsUniformBufferData {
     float zfar;
     float time = 0.0f;
     int frameIndexMod16;
-    int _padding[2];
+    int historyValid = 0;
+    int tileSize = 16; // Screen tile the clouds are classified and ray-marched in, in pixels
+    float weatherBlend = 0.0f; // Weight of the second weather map, the first one is weighted by the rest
+    int farFieldFace = 0; // First far-field impostor face refreshed this frame
+    uint32_t frameIndex = 0; // Frame counter the blue noise is rotated by
 };
 
 // Data for cloud pass passed as push constant block
@@ -65,22 +113,27 @@ struct CloudsPushConstantData {
     int DEBUG_epicView = 0;
     int DEBUG_cheapSampleDistance = 93000;
 
-#if defined(HIGH_QUALITY_CLOUDS)
-    int DEBUG_maxSamples = 256;
-    int DEBUG_maxLightSamples = 10;
-#else
+    // Overwritten by the cloud quality preset unless the quality is custom
     int DEBUG_maxSamples = 128;
     int DEBUG_maxLightSamples = 4;
-#endif
-
     int DEBUG_earlyTermination = 0;
     int DEBUG_lateTermination = 0;
-
-#if defined(HIGH_QUALITY_CLOUDS)
-    float DEBUG_longStepMulti = 3.f;
-#else
     float DEBUG_longStepMulti = 2.5f;
-#endif
+    int emptySpaceSkipping = 1;
+    int lightVolume = 1;
+    int tileClassification = 1;
+    int farField = 1;
+    float farFieldDistance = 40000.0f; // Distance from the camera the ray-march hands over to the far-field impostor
+};
+
+// Cloud quality baked into the cloud pipelines as specialization constants, in constant id order
+struct CloudsSpecializationData {
+    VkBool32 specialized = VK_FALSE;
+    int32_t maxSamples = 128;
+    int32_t maxLightSamples = 4;
+    float longStepMultiplier = 2.5f;
+    VkBool32 earlyTermination = VK_FALSE;
+    VkBool32 lateTermination = VK_FALSE;
 };
 
 // Atmospheric pass data
@@ -93,6 +146,76 @@ struct AtmosphereUniformBufferData {
     HmckVec4 frustumA, frustumB, frustumC, frustumD;
     float resX;
     float resY;
+    float _padding[2];
+    CloudShadowData cloudShadow{};
+};
+
+// Temporal amortization of the aerial perspective passed as push constant block
+struct AerialPerspectivePushConstantData {
+    HmckVec4 prevFrustumA, prevFrustumB, prevFrustumC, prevFrustumD;
+    HmckVec4 prevEye;
+    uint32_t frameIndex = 0;
+    uint32_t period = 1;
+    uint32_t _padding[2];
+};
+
+struct SkyViewBankPushConstantData {
+    float eyeHeight;
+    float minElevation;
+    float maxElevation;
+    uint32_t firstLayer;
+};
+
+struct TransmittancePushConstantData {
+    int32_t integrator = static_cast<int32_t>(TransmittanceIntegrator::Raymarch);
+};
+
+// Physical description of the planet and its atmosphere used by the atmosphere LUTs
+// Default values describe the Earth
+struct AtmosphereParameters {
+    HmckVec4 scatterRayleigh{5.802e-6f, 13.558e-6f, 33.1e-6f, 0.0f};
+    HmckVec4 absorbOzone{0.65e-6f, 1.881e-6f, 0.085e-6f, 0.0f};
+    float planetRadius = 6378000.0f; // 6378 km
+    float atmosphereRadius = 6460000.0f; // 6460 km
+    float ozoneThickness = 30000.0f; // 30 km
+    float ozoneCenterHeight = 25000.0f; // 25 km
+    float hDensityMie = 1200.0f;
+    float absorbMie = 4.4e-6f;
+    float asymmetryMie = 0.8f;
+    float scatterMie = 3.996e-6f;
+    float hDensityRayleigh = 8000.0f;
+    float _padding[3];
+
+    static AtmosphereParameters fromPreset(AtmospherePreset preset) {
+        AtmosphereParameters parameters{};
+        switch (preset) {
+            case AtmospherePreset::Earth:
+                break;
+            case AtmospherePreset::Mars:
+                parameters.planetRadius = 3389500.0f; // Mars radius ≈ 3389.5 km
+                parameters.atmosphereRadius = 3489500.0f; // Thin atmosphere (~10 km thick)
+                parameters.ozoneThickness = 1.0f; // No significant ozone layer, non zero to avoid division by zero
+                parameters.ozoneCenterHeight = 0.0f;
+                parameters.absorbOzone = HmckVec4{0.0f, 0.0f, 0.0f, 0.0f};
+                // Mie scattering (dust-heavy but low density)
+                parameters.hDensityMie = 11000.0f; // Less gravity, slower falloff than Earth
+                parameters.absorbMie = 3.0e-7f; // Slightly more absorbing due to dust
+                parameters.asymmetryMie = 0.85f; // Martian dust is highly forward-scattering
+                parameters.scatterMie = 2.0e-7f; // Very low Mie scattering
+                // Rayleigh scattering (mostly CO2, low density)
+                parameters.hDensityRayleigh = 11000.0f; // Extended falloff due to low pressure
+                parameters.scatterRayleigh = HmckVec4{0.0001f, 0.0002f, 0.0003f, 0.0f}; // Very weak blue sky
+                break;
+            case AtmospherePreset::HazyEarth:
+                // Earth with a lot more aerosols in the lower atmosphere
+                parameters.hDensityMie = 2400.0f;
+                parameters.absorbMie = 1.1e-5f;
+                parameters.asymmetryMie = 0.76f;
+                parameters.scatterMie = 2.0e-5f;
+                break;
+        }
+        return parameters;
+    }
 };
 
 // Data for post process pass passed as push constant block
@@ -116,6 +239,14 @@ struct GodRaysCoefficients {
     float activeDistance = 1.0;
     float weight = 1.0;
     float alpha = 0.3;
+    uint32_t frameIndex = 0; // Frame counter the blue noise is rotated by
+};
+
+// Camera rays and cloud shadows for the god rays mask passed as push constant block
+struct GodRaysMaskData {
+    HmckVec4 frustumA, frustumB, frustumC, frustumD;
+    HmckVec4 cameraPosition;
+    CloudShadowData cloudShadow{};
 };
 
 struct CompositionData {
@@ -129,4 +260,9 @@ struct CompositionData {
     float resX;
     float resY;
     int applyGodRays = 0;
+    float atmosphereHeight; // atmosphere radius - planet radius, used to sample transmittance
+    float skyViewBankLayer = -1.0f; // fractional layer of the sky view bank, negative when the live sky view is used
+    float skyViewBankLayerCount = 0.0f;
+    float _padding[2];
+    CloudShadowData cloudShadow{};
 };
\ No newline at end of file
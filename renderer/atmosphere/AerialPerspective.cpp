@@ -3,16 +3,136 @@
 
 void AerialPerspective::recordCommands(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
     profiler.writeTimestamp(commandBuffer, 10, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    Image *volume = resourceManager.getResource<Image>(lut);
+    Image *previousVolume = resourceManager.getResource<Image>(history);
+
+    // Without valid history every column is recomputed
+    const bool reproject = historyValid && temporalPeriod > 1;
+    if (reproject) {
+        bool cameraMoved = HmckLen(currentEye.XYZ - temporal.prevEye.XYZ) > 0.0f;
+        const HmckVec4 previousFrustum[4] = {
+            temporal.prevFrustumA, temporal.prevFrustumB, temporal.prevFrustumC, temporal.prevFrustumD
+        };
+        for (int i = 0; i < 4; i++) {
+            cameraMoved |= HmckLen(currentFrustum[i].XYZ - previousFrustum[i].XYZ) > 0.0f;
+        }
+        // Once the camera stops, remaining columns are recomputed in the following frames
+        if (cameraMoved) {
+            convergenceFrames = temporalPeriod - 1;
+        } else if (convergenceFrames > 0) {
+            convergenceFrames--;
+        }
+
+        // Previous volume was written by the copy at the end of the last update
+        previousVolume->pipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+            VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_READ_BIT,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED
+        );
+    } else {
+        convergenceFrames = 0;
+    }
+
+    temporal.frameIndex = frameCounter++;
+    temporal.period = reproject ? temporalPeriod : 1;
+
+    // Both variants share the layout
+    const bool scan = parallelScan && extent.depth <= AERIAL_PERSPECTIVE_SCAN_MAX_DEPTH;
+    ComputePipeline *variant = scan ? scanPipeline.get() : pipeline.get();
+
     // Bind the descriptor set
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->pipelineLayout, 1, 1,
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, variant->pipelineLayout, 1, 1,
                             &descriptor, 0, nullptr);
     // Bind the pipeline
-    pipeline->bind(commandBuffer);
-    // Dispatch
-    vkCmdDispatch(commandBuffer, GROUPS_COUNT(AERIAL_PERSPECTIVE_LUT_SIZE_X, 8), GROUPS_COUNT(AERIAL_PERSPECTIVE_LUT_SIZE_Y, 8), 1);
+    variant->bind(commandBuffer);
+    // Push the previous frame
+    vkCmdPushConstants(commandBuffer, variant->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(AerialPerspectivePushConstantData), &temporal);
+    // Dispatch, scan variant covers the whole depth within a group
+    if (scan) {
+        vkCmdDispatch(commandBuffer, GROUPS_COUNT(extent.width, AERIAL_PERSPECTIVE_SCAN_GROUP_X),
+                      GROUPS_COUNT(extent.height, AERIAL_PERSPECTIVE_SCAN_GROUP_Y), 1);
+    } else {
+        vkCmdDispatch(commandBuffer, GROUPS_COUNT(extent.width, 8), GROUPS_COUNT(extent.height, 8), 1);
+    }
+
+    // Keep the volume for the next update
+    if (temporalPeriod > 1) {
+        volume->pipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+            VK_ACCESS_2_TRANSFER_READ_BIT,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED
+        );
+        previousVolume->pipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_NONE,
+            VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+            VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED
+        );
+
+        VkImageCopy region = {
+            .srcSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1},
+            .srcOffset = {0, 0, 0},
+            .dstSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1},
+            .dstOffset = {0, 0, 0},
+            .extent = volume->getExtent(),
+        };
+        vkCmdCopyImage(commandBuffer, volume->getImage(), VK_IMAGE_LAYOUT_GENERAL, previousVolume->getImage(),
+                       VK_IMAGE_LAYOUT_GENERAL, 1, &region);
+        historyValid = true;
+    } else {
+        historyValid = false;
+    }
+
+    temporal.prevEye = currentEye;
+    temporal.prevFrustumA = currentFrustum[0];
+    temporal.prevFrustumB = currentFrustum[1];
+    temporal.prevFrustumC = currentFrustum[2];
+    temporal.prevFrustumD = currentFrustum[3];
+    lastSunDirection = currentSunDirection;
+
     profiler.writeTimestamp(commandBuffer, 11, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
 }
 
+void AerialPerspective::setTemporalPeriod(uint32_t period) {
+    ASSERT(period >= 1 && period <= 16 && (period & (period - 1)) == 0,
+           "Aerial perspective temporal period has to be a power of two up to 16");
+    temporalPeriod = period;
+    convergenceFrames = 0;
+    resetHistory();
+    invalidate();
+}
+
+void AerialPerspective::setCurrentFrame(const AtmosphereUniformBufferData &atmosphere) {
+    // Reprojection only follows the camera, moving sun changes the light in every froxel
+    if (HmckLen(atmosphere.sunDirection.XYZ - lastSunDirection.XYZ) > AERIAL_PERSPECTIVE_SUN_TOLERANCE) {
+        resetHistory();
+    }
+    currentEye = atmosphere.eye;
+    currentSunDirection = atmosphere.sunDirection;
+    currentFrustum[0] = atmosphere.frustumA;
+    currentFrustum[1] = atmosphere.frustumB;
+    currentFrustum[2] = atmosphere.frustumC;
+    currentFrustum[3] = atmosphere.frustumD;
+}
+
 void AerialPerspective::initialize(VkDescriptorSetLayout descriptorSetLayout) {
     AerialPerspective::prepareLut();
     AerialPerspective::prepareDescriptors();
@@ -25,23 +145,56 @@ void AerialPerspective::initialize(VkDescriptorSetLayout descriptorSetLayout) {
 void AerialPerspective::prepareLut() {
     lut = resourceManager.createResource<Image>(
         "aerial-perspective-lut", ImageDesc{
-            .width = AERIAL_PERSPECTIVE_LUT_SIZE_X,
-            .height = AERIAL_PERSPECTIVE_LUT_SIZE_Y,
+            .width = extent.width,
+            .height = extent.height,
             .channels = 4,
-            .depth = AERIAL_PERSPECTIVE_LUT_SIZE_Z,
+            .depth = extent.depth,
             .format = VK_FORMAT_R16G16B16A16_SFLOAT,
-            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
             .imageType = VK_IMAGE_TYPE_3D,
             .imageViewType = VK_IMAGE_VIEW_TYPE_3D,
             .currentQueueFamily = CommandQueueFamily::Compute,
             .queueFamilies = {CommandQueueFamily::Compute, CommandQueueFamily::Graphics},
-            .sharingMode = VK_SHARING_MODE_EXCLUSIVE
+            // Computed only in some frames but read by both queues in every frame, so it is never transferred
+            .sharingMode = VK_SHARING_MODE_CONCURRENT
         }
     );
     // transition
     resourceManager.getResource<Image>(lut)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_GENERAL);
 
     sampler = resourceManager.createResource<Sampler>("aerial-perspective-sampler", SamplerDesc{});
+
+    // Previous volume for the temporal reprojection
+    history = resourceManager.createResource<Image>(
+        "aerial-perspective-history", ImageDesc{
+            .width = extent.width,
+            .height = extent.height,
+            .channels = 4,
+            .depth = extent.depth,
+            .format = VK_FORMAT_R16G16B16A16_SFLOAT,
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            .imageType = VK_IMAGE_TYPE_3D,
+            .imageViewType = VK_IMAGE_VIEW_TYPE_3D,
+            .currentQueueFamily = CommandQueueFamily::Compute,
+            .queueFamilies = {CommandQueueFamily::Compute},
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE
+        }
+    );
+    resourceManager.getResource<Image>(history)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_GENERAL);
+
+    // Clamped so that the edges of the previous volume do not wrap around
+    historySampler = resourceManager.createResource<Sampler>("aerial-perspective-history-sampler", SamplerDesc{
+                                                                 .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                 .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                 .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                             });
+}
+
+void AerialPerspective::releaseLut() {
+    ILookUpTable::releaseLut();
+    resourceManager.releaseResource(history.getUid());
+    resourceManager.releaseResource(historySampler.getUid());
+    resetHistory();
 }
 
 void AerialPerspective::prepareDescriptors() {
@@ -50,6 +203,8 @@ void AerialPerspective::prepareDescriptors() {
             .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Multiple scattering
             .addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Shadow map
             .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT) // aerial perspective
+            .addBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // previous volume
+            .addBinding(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Cloud shadow map
             .build();
 
     Sampler *s = resourceManager.getResource<Sampler>(sampler);
@@ -57,11 +212,16 @@ void AerialPerspective::prepareDescriptors() {
     VkDescriptorImageInfo transmittanceInfo = transmittance->getDescriptorImageInfo(s->getSampler());
     VkDescriptorImageInfo multipleScatteringInfo = multipleScattering->getDescriptorImageInfo(s->getSampler());
     VkDescriptorImageInfo shadowMapInfo = shadowMap->getDescriptorImageInfo(s->getSampler());
+    VkDescriptorImageInfo cloudShadowMapInfo = cloudShadowMap->getDescriptorImageInfo(s->getSampler());
+    VkDescriptorImageInfo historyInfo = resourceManager.getResource<Image>(history)->getDescriptorImageInfo(
+        resourceManager.getResource<Sampler>(historySampler)->getSampler());
     DescriptorWriter(*layout, *descriptorPool)
             .writeImage(0, &transmittanceInfo)
             .writeImage(1, &multipleScatteringInfo)
             .writeImage(2, &shadowMapInfo)
             .writeImage(3, &lutInfo)
+            .writeImage(4, &historyInfo)
+            .writeImage(5, &cloudShadowMapInfo)
             .build(descriptor);
 }
 
@@ -74,6 +234,16 @@ void AerialPerspective::preparePipeline(VkDescriptorSetLayout descriptorSetLayou
             descriptorSetLayout,
             layout->getDescriptorSetLayout()
         },
-        .pushConstantRanges{}
+        .pushConstantRanges{{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AerialPerspectivePushConstantData)}}
+    });
+    scanPipeline = ComputePipeline::create({
+        .debugName = "aerial-perspective-scan-compute-pipeline",
+        .device = device,
+        .computeShader{.byteCode = Filesystem::readFile(COMPILED_SHADER_PATH("aerialperspective_scan.comp")),},
+        .descriptorSetLayouts = {
+            descriptorSetLayout,
+            layout->getDescriptorSetLayout()
+        },
+        .pushConstantRanges{{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AerialPerspectivePushConstantData)}}
     });
 }
@@ -4,12 +4,22 @@
 #define AERIAL_PERSPECTIVE_LUT_SIZE_X 32
 #define AERIAL_PERSPECTIVE_LUT_SIZE_Y 32
 #define AERIAL_PERSPECTIVE_LUT_SIZE_Z 32
+// Frames over which all froxel columns are recomputed while the camera moves, 1 recomputes all of them every frame
+#define AERIAL_PERSPECTIVE_TEMPORAL_PERIOD 4
+// Sun movement that still allows the previous volume to be reprojected
+#define AERIAL_PERSPECTIVE_SUN_TOLERANCE 1e-4f
+// Parallel scan variant works on 2x4 columns per group with 32 threads along each column,
+// deeper volumes than 32 * 4 slices fall back to the serial variant
+#define AERIAL_PERSPECTIVE_SCAN_GROUP_X 2
+#define AERIAL_PERSPECTIVE_SCAN_GROUP_Y 4
+#define AERIAL_PERSPECTIVE_SCAN_MAX_DEPTH 128
 
 
 class AerialPerspective final : public ILookUpTable {
 public:
     AerialPerspective(Device &device, ResourceManager &resourceManager, Profiler& profiler)
         : ILookUpTable(device, resourceManager, profiler) {
+        extent = {AERIAL_PERSPECTIVE_LUT_SIZE_X, AERIAL_PERSPECTIVE_LUT_SIZE_Y, AERIAL_PERSPECTIVE_LUT_SIZE_Z};
     }
 
     void recordCommands(VkCommandBuffer commandBuffer, uint32_t frameIndex) override;
@@ -19,6 +29,43 @@ public:
     void setMultipleScattering(Image *image) { multipleScattering = image; }
     void setTransmittance(Image *image) { transmittance = image; }
     void setShadowMap(Image *image) { shadowMap = image; }
+    void setCloudShadowMap(Image *image) { cloudShadowMap = image; }
+
+    /**
+     * Sets the number of frames over which every froxel column gets recomputed. Columns that are not due in the frame
+     * are reprojected from the previous volume using the previous camera frustum.
+     * @param period One of 1, 2, 4, 8 or 16, 1 disables the reprojection
+     */
+    void setTemporalPeriod(uint32_t period);
+
+    uint32_t getTemporalPeriod() const { return temporalPeriod; }
+
+    /**
+     * Selects the integration variant. Serial variant walks all slices of a froxel column in a single thread,
+     * parallel scan variant spreads the slices of a column over a workgroup and chains them with a prefix scan,
+     * which gives many more threads for the same volume. Both integrate the same samples.
+     * @param enabled true for the parallel scan variant
+     */
+    void setParallelScan(bool enabled) { parallelScan = enabled; }
+
+    bool isParallelScan() const { return parallelScan; }
+
+    /**
+     * Discards the previous volume so that the next update recomputes every froxel. Reprojection only accounts for
+     * the camera motion, so this has to be called whenever the LUTs the froxels are integrated from change.
+     */
+    void resetHistory() { historyValid = false; }
+
+    /**
+     * @return true while some froxels still hold reprojected data, the volume has to be updated even if the camera
+     * does not move until every column is recomputed
+     */
+    bool isConverging() const { return convergenceFrames > 0; }
+
+    /**
+     * Passes the camera and sun of the frame that is about to be recorded, has to be called before recordCommands
+     */
+    void setCurrentFrame(const AtmosphereUniformBufferData &atmosphere);
 
 protected:
 
@@ -26,11 +73,49 @@ protected:
     Image *multipleScattering;
     Image *transmittance;
     Image *shadowMap;
+    Image *cloudShadowMap;
+
+    // Previous volume, the froxels that are not due are reprojected from it
+    ResourceHandle history;
+    ResourceHandle historySampler;
+
+    std::unique_ptr<ComputePipeline> scanPipeline;
+    bool parallelScan = true;
+
+    AerialPerspectivePushConstantData temporal;
+    uint32_t temporalPeriod = AERIAL_PERSPECTIVE_TEMPORAL_PERIOD;
+    uint32_t convergenceFrames = 0;
+    uint32_t frameCounter = 0;
+    bool historyValid = false;
+    HmckVec4 currentEye{}, currentSunDirection{}, lastSunDirection{};
+    HmckVec4 currentFrustum[4]{};
 
 
     void prepareLut() override;
 
+    void releaseLut() override;
+
     void prepareDescriptors() override;
 
     void preparePipeline(VkDescriptorSetLayout descriptorSetLayout) override;
+
+    // Froxels are camera aligned so everything that moves the camera or the sun invalidates them
+    void declareInputs(const AtmosphereUniformBufferData &atmosphere, const AtmosphereParameters &parameters,
+                       std::vector<float> &inputs) const override {
+        inputs.insert(inputs.end(), atmosphere.eye.Elements, atmosphere.eye.Elements + 3);
+        inputs.insert(inputs.end(), atmosphere.sunDirection.Elements, atmosphere.sunDirection.Elements + 3);
+        for (const HmckVec4 &corner: {atmosphere.frustumA, atmosphere.frustumB, atmosphere.frustumC, atmosphere.frustumD}) {
+            inputs.insert(inputs.end(), corner.Elements, corner.Elements + 3);
+        }
+        const float *shadowViewProj = &atmosphere.shadowViewProj.Elements[0][0];
+        inputs.insert(inputs.end(), shadowViewProj, shadowViewProj + 16);
+        // Cloud shadows drift with the wind every frame, only whole texel movements are visible
+        const CloudShadowData &cloudShadow = atmosphere.cloudShadow;
+        const float texel = cloudShadow.extent / static_cast<float>(cloudShadowMap->getExtent().width);
+        inputs.insert(inputs.end(), {
+                          static_cast<float>(cloudShadow.valid), static_cast<float>(cloudShadow.generation),
+                          texel > 0.0f ? std::floor(cloudShadow.origin.X / texel) : 0.0f,
+                          texel > 0.0f ? std::floor(cloudShadow.origin.Z / texel) : 0.0f
+                      });
+    }
 };
@@ -12,14 +12,87 @@ void AtmospherePass::initialize() {
     skyView.setTransmittance(transmittance.getLut());
     skyView.setMultipleScattering(multipleScattering.getLut());
     skyView.initialize(layout->getDescriptorSetLayout());
+    skyViewBank.setTransmittance(transmittance.getLut());
+    skyViewBank.setMultipleScattering(multipleScattering.getLut());
+    skyViewBank.initialize(layout->getDescriptorSetLayout());
     aerialPerspective.setTransmittance(transmittance.getLut());
     aerialPerspective.setMultipleScattering(multipleScattering.getLut());
     aerialPerspective.initialize(layout->getDescriptorSetLayout());
+
+    // Declare which LUTs are read by which so that invalidation propagates
+    multipleScattering.addDependency(&transmittance);
+    skyView.addDependency(&transmittance);
+    skyView.addDependency(&multipleScattering);
+    skyViewBank.addDependency(&transmittance);
+    skyViewBank.addDependency(&multipleScattering);
+    aerialPerspective.addDependency(&transmittance);
+    aerialPerspective.addDependency(&multipleScattering);
+}
+
+void AtmospherePass::setQuality(AtmosphereQuality newQuality) {
+    quality = newQuality;
+    const AtmosphereLutExtents extents = AtmosphereLutExtents::fromQuality(quality);
+    transmittance.resize(extents.transmittance);
+    multipleScattering.resize(extents.multipleScattering);
+    skyView.resize(extents.skyView);
+    skyViewBank.resize({extents.skyView.width, extents.skyView.height, skyViewBank.getLayerCount()});
+    aerialPerspective.resize(extents.aerialPerspective);
+
+    // Nothing to rewire before initialization
+    if (descriptor == VK_NULL_HANDLE) {
+        return;
+    }
+
+    // Every LUT that reads another one has to point to the recreated images
+    multipleScattering.setTransmittance(transmittance.getLut());
+    skyView.setTransmittance(transmittance.getLut());
+    skyView.setMultipleScattering(multipleScattering.getLut());
+    skyViewBank.setTransmittance(transmittance.getLut());
+    skyViewBank.setMultipleScattering(multipleScattering.getLut());
+    aerialPerspective.setTransmittance(transmittance.getLut());
+    aerialPerspective.setMultipleScattering(multipleScattering.getLut());
+
+    transmittance.refreshDescriptors();
+    multipleScattering.refreshDescriptors();
+    skyView.refreshDescriptors();
+    skyViewBank.refreshDescriptors();
+    aerialPerspective.refreshDescriptors();
+}
+
+void AtmospherePass::invalidate() {
+    transmittance.invalidate();
+    multipleScattering.invalidate();
+    skyView.invalidate();
+    skyViewBank.invalidate();
+    aerialPerspective.invalidate();
+    aerialPerspective.resetHistory();
+}
+
+void AtmospherePass::loadCache() {
+    if (cacheDirectory.empty()) {
+        return;
+    }
+    // Dependency order, key of each LUT is chained from the keys of the LUTs it reads
+    // Uploaded by the compute queue that produces the LUTs, the ones the graphics queue samples are shared concurrently
+    transmittance.loadCache(cacheDirectory, atmosphere, parameters, CommandQueueFamily::Compute);
+    multipleScattering.loadCache(cacheDirectory, atmosphere, parameters, CommandQueueFamily::Compute);
+    skyView.loadCache(cacheDirectory, atmosphere, parameters, CommandQueueFamily::Compute);
+}
+
+void AtmospherePass::storeCache() {
+    if (cacheDirectory.empty()) {
+        return;
+    }
+    // Read back on the compute queue that produces the LUTs
+    transmittance.storeCache(cacheDirectory, CommandQueueFamily::Compute);
+    multipleScattering.storeCache(cacheDirectory, CommandQueueFamily::Compute);
+    skyView.storeCache(cacheDirectory, CommandQueueFamily::Compute);
 }
 
 void AtmospherePass::recordCommands(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
     // Update the buffer
     resourceManager.getResource<Buffer>(atmosphereBuffer)->writeToBuffer(&atmosphere);
+    resourceManager.getResource<Buffer>(parametersBuffer)->writeToBuffer(&parameters);
 
     // Bind the common descriptor set
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, transmittance.getPipelineLayout(), 0, 1,
@@ -35,12 +108,52 @@ void AtmospherePass::recordCommands(VkCommandBuffer commandBuffer, uint32_t fram
     profiler.resetTimestamp(commandBuffer, 11);
 
 
-    // Record transmittance
+    // Record only the LUTs whose inputs changed, in dependency order
+    // Skipped LUTs still write their timestamps so that the profiler queries stay valid
+    transmittance.setIntegrator(transmittanceIntegrator);
+    if (transmittance.update(atmosphere, parameters)) {
+        transmittance.recordCommands(commandBuffer, frameIndex);
+    } else {
+        profiler.skipTimestamps(commandBuffer, 4);
+    }
+
+    if (multipleScattering.update(atmosphere, parameters)) {
+        multipleScattering.recordCommands(commandBuffer, frameIndex);
+    } else {
+        profiler.skipTimestamps(commandBuffer, 6);
+    }
+
+    // Bank is built a few layers per frame, until it is complete or while it does not cover the eye and the sun,
+    // the sky view is computed live
+    skyViewBank.prepareFrame(atmosphere, parameters);
+    if (skyViewBank.isBuilding()) {
+        skyViewBank.recordCommands(commandBuffer, frameIndex);
+    }
+    skyViewBankLayer = skyViewBank.getLayer(atmosphere);
 
-    transmittance.recordCommands(commandBuffer, frameIndex);
-    multipleScattering.recordCommands(commandBuffer, frameIndex);
-    skyView.recordCommands(commandBuffer, frameIndex);
-    aerialPerspective.recordCommands(commandBuffer, frameIndex);
+    if (skyViewBankLayer >= 0.0f) {
+        skyView.skipUpdate();
+        profiler.skipTimestamps(commandBuffer, 8);
+    } else if (skyView.update(atmosphere, parameters)) {
+        skyView.recordCommands(commandBuffer, frameIndex);
+    } else {
+        profiler.skipTimestamps(commandBuffer, 8);
+    }
+
+    // Reprojected froxels were integrated through the old LUTs
+    if (transmittance.isUpdated() || multipleScattering.isUpdated()) {
+        aerialPerspective.resetHistory();
+    }
+    // Froxels that still hold reprojected data are recomputed in the following frames even if nothing moves
+    if (aerialPerspective.isConverging()) {
+        aerialPerspective.invalidate();
+    }
+    if (aerialPerspective.update(atmosphere, parameters)) {
+        aerialPerspective.setCurrentFrame(atmosphere);
+        aerialPerspective.recordCommands(commandBuffer, frameIndex);
+    } else {
+        profiler.skipTimestamps(commandBuffer, 10);
+    }
 
 }
 
@@ -53,17 +166,29 @@ void AtmospherePass::prepareBuffers() {
             .allocationFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
         }
     );
+    parametersBuffer = resourceManager.createResource<Buffer>(
+        "atmosphere-parameters-buffer", BufferDesc{
+            .instanceSize = sizeof(AtmosphereParameters),
+            .instanceCount = 1,
+            .usageFlags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            .allocationFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+        }
+    );
     // Map the buffers
     resourceManager.getResource<Buffer>(atmosphereBuffer)->map();
+    resourceManager.getResource<Buffer>(parametersBuffer)->map();
 }
 
 void AtmospherePass::prepareDescriptors() {
     layout = DescriptorSetLayout::Builder(device)
             .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
             .build();
 
     VkDescriptorBufferInfo atmosphereBufferInfo = resourceManager.getResource<Buffer>(atmosphereBuffer)->descriptorInfo();
+    VkDescriptorBufferInfo parametersBufferInfo = resourceManager.getResource<Buffer>(parametersBuffer)->descriptorInfo();
     DescriptorWriter(*layout, *descriptorPool)
             .writeBuffer(0, &atmosphereBufferInfo)
+            .writeBuffer(1, &parametersBufferInfo)
             .build(descriptor);
 }
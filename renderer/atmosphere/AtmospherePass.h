@@ -3,6 +3,8 @@
 #include "Transmittance.h"
 #include "MultipleScattering.h"
 #include "SkyView.h"
+#include "SkyViewBank.h"
+#include "AtmosphereQuality.h"
 #include "../IRenderGroup.h"
 #include "../Types.h"
 
@@ -14,6 +16,7 @@ public:
           transmittance(device, resourceManager, profiler),
           multipleScattering(device, resourceManager, profiler),
           skyView(device, resourceManager, profiler),
+          skyViewBank(device, resourceManager, profiler),
           aerialPerspective(device, resourceManager, profiler) {
     }
 
@@ -27,8 +30,22 @@ public:
         atmosphere.sunDirection = HmckVec4{sunDirection, 0.0f};
     }
 
+    // Only the LUTs that depend on the changed parameters are rebuilt in the next frame
+    void setParameters(const AtmosphereParameters &params) { parameters = params; }
+    void setPreset(AtmospherePreset preset) { parameters = AtmosphereParameters::fromPreset(preset); }
+
     void setShadowMap(Image *image) { aerialPerspective.setShadowMap(image); }
     void setShadowViewProjection(HmckMat4 mat) { atmosphere.shadowViewProj = mat; }
+    void setCloudShadowMap(Image *image) { aerialPerspective.setCloudShadowMap(image); }
+
+    // Rebuilt or toggled cloud shadows change the light in every froxel, so the previous volume cannot be reprojected
+    void setCloudShadow(const CloudShadowData &cloudShadow) {
+        if (cloudShadow.generation != atmosphere.cloudShadow.generation ||
+            cloudShadow.valid != atmosphere.cloudShadow.valid) {
+            aerialPerspective.resetHistory();
+        }
+        atmosphere.cloudShadow = cloudShadow;
+    }
     void setCameraInverseView(HmckMat4 mat) { atmosphere.inverseView = mat; }
     void setCameraInverseProjection(HmckMat4 mat) { atmosphere.inverseProjection = mat; }
 
@@ -39,25 +56,76 @@ public:
         atmosphere.frustumD = d;
     }
 
+    /**
+     * Resizes all LUTs to the dimensions of the quality tier. Can be called before initialize, afterward the GPU
+     * has to be idle, the LUT images are recreated and recomputed in the next frame. Passes that sample the LUTs
+     * have to pick up the new images.
+     */
+    void setQuality(AtmosphereQuality newQuality);
+
+    AtmosphereQuality getQuality() const { return quality; }
+
+    /**
+     * Enables the sky view bank, has to be called before initialize
+     * @param layerCount Number of precomputed sun elevations, 0 disables the bank
+     */
+    void setSkyViewBankLayers(uint32_t layerCount) { skyViewBank.setLayerCount(layerCount); }
+
+    /**
+     * @return Fractional layer of the sky view bank the sky is sampled from in the recorded frame, negative when the
+     * live sky view LUT was computed instead
+     */
+    float getSkyViewBankLayer() const { return skyViewBankLayer; }
+
+    /**
+     * Forces recomputation of every LUT in the next frame, aerial perspective included
+     */
+    void invalidate();
+
+    // Empty directory disables the LUT cache
+    void setCacheDirectory(const std::string &directory) { cacheDirectory = directory; }
+
+    /**
+     * Restores transmittance, multiple scattering and sky view LUTs baked by previous runs.
+     * Call once before the first frame is recorded, after the atmosphere data for that frame are set.
+     */
+    void loadCache();
+
+    /**
+     * Writes the computed transmittance, multiple scattering and sky view LUTs into the cache.
+     * Aerial perspective is not cached as it follows the camera. GPU has to be idle.
+     */
+    void storeCache();
+
     void recordCommands(VkCommandBuffer commandBuffer, uint32_t frameIndex) override;
 
     AtmosphereUniformBufferData atmosphere;
+    AtmosphereParameters parameters;
+    // Picked up by the transmittance LUT in the next frame
+    TransmittanceIntegrator transmittanceIntegrator = TransmittanceIntegrator::Raymarch;
 
     // Luts
     Transmittance transmittance;
     MultipleScattering multipleScattering;
     SkyView skyView;
+    SkyViewBank skyViewBank;
     AerialPerspective aerialPerspective;
 
 private:
+    std::string cacheDirectory;
+    AtmosphereQuality quality = AtmosphereQuality::High;
+    float skyViewBankLayer = -1.0f;
+
     // Buffers
     // There is one common buffer for all luts bound once at the start of the pass
     ResourceHandle atmosphereBuffer;
+    // Planet parameters, rarely changing, bound next to the common buffer
+    ResourceHandle parametersBuffer;
     // Then each dispatch uses its own buffer for its custom data
 
     // Descriptors
     std::unique_ptr<DescriptorSetLayout> layout;
-    VkDescriptorSet descriptor;
+    VkDescriptorSet descriptor = VK_NULL_HANDLE;
 
     void prepareBuffers();
 
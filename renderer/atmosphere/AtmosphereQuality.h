@@ -0,0 +1,45 @@
+#pragma once
+#include "Transmittance.h"
+#include "MultipleScattering.h"
+#include "SkyView.h"
+#include "AerialPerspective.h"
+
+/**
+ * LUT dimensions of a quality tier. High tier uses the default LUT sizes.
+ * All LUTs are parametrized by texel centers, so lower tiers cover the same domain with fewer texels.
+ */
+struct AtmosphereLutExtents {
+    VkExtent3D transmittance;
+    VkExtent3D multipleScattering;
+    VkExtent3D skyView;
+    VkExtent3D aerialPerspective;
+
+    static AtmosphereLutExtents fromQuality(AtmosphereQuality quality) {
+        switch (quality) {
+            case AtmosphereQuality::Low:
+                return {{128, 32, 1}, {16, 16, 1}, {96, 48, 1}, {16, 16, 16}};
+            case AtmosphereQuality::Medium:
+                return {{192, 48, 1}, {32, 32, 1}, {128, 64, 1}, {32, 32, 16}};
+            case AtmosphereQuality::Ultra:
+                return {{512, 128, 1}, {64, 64, 1}, {400, 200, 1}, {64, 64, 64}};
+            case AtmosphereQuality::High:
+            default:
+                return {
+                    {TRANSMITTANCE_LUT_SIZE_X, TRANSMITTANCE_LUT_SIZE_Y, 1},
+                    {MULTI_SCATTER_LUT_SIZE_X, MULTI_SCATTER_LUT_SIZE_Y, 1},
+                    {SKY_VIEW_LUT_SIZE_X, SKY_VIEW_LUT_SIZE_Y, 1},
+                    {AERIAL_PERSPECTIVE_LUT_SIZE_X, AERIAL_PERSPECTIVE_LUT_SIZE_Y, AERIAL_PERSPECTIVE_LUT_SIZE_Z}
+                };
+        }
+    }
+
+    static const char *name(AtmosphereQuality quality) {
+        switch (quality) {
+            case AtmosphereQuality::Low: return "low";
+            case AtmosphereQuality::Medium: return "medium";
+            case AtmosphereQuality::Ultra: return "ultra";
+            case AtmosphereQuality::High:
+            default: return "high";
+        }
+    }
+};
@@ -0,0 +1,271 @@
+#include "ILookUpTable.h"
+
+#include <cstring>
+#include <filesystem>
+
+// All LUTs are R16G16B16A16_SFLOAT
+#define LUT_TEXEL_SIZE (4 * sizeof(uint16_t))
+
+namespace {
+    // Single time commands on the queue of given family, device helpers only use the graphics queue
+    VkCommandBuffer beginCommands(Device &device, CommandQueueFamily queueFamily) {
+        VkCommandBufferAllocateInfo allocInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = queueFamily == CommandQueueFamily::Compute
+                               ? device.getComputeCommandPool()
+                               : device.getGraphicsCommandPool(),
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        };
+        VkCommandBuffer commandBuffer;
+        ASSERT(vkAllocateCommandBuffers(device.device(), &allocInfo, &commandBuffer) == VK_SUCCESS,
+               "Failed to allocate LUT cache command buffer!");
+
+        VkCommandBufferBeginInfo beginInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        };
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        return commandBuffer;
+    }
+
+    void endCommands(Device &device, CommandQueueFamily queueFamily, VkCommandBuffer commandBuffer) {
+        vkEndCommandBuffer(commandBuffer);
+        VkQueue queue = queueFamily == CommandQueueFamily::Compute ? device.computeQueue() : device.graphicsQueue();
+        VkCommandPool pool = queueFamily == CommandQueueFamily::Compute
+                                 ? device.getComputeCommandPool()
+                                 : device.getGraphicsCommandPool();
+
+        VkSubmitInfo submitInfo = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &commandBuffer,
+        };
+        vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+        vkQueueWaitIdle(queue);
+        vkFreeCommandBuffers(device.device(), pool, 1, &commandBuffer);
+    }
+
+    VkBufferImageCopy wholeImageRegion(const Image *image) {
+        return {
+            .bufferOffset = 0,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+            .imageOffset = {0, 0, 0},
+            .imageExtent = image->getExtent(),
+        };
+    }
+}
+
+uint64_t ILookUpTable::computeCacheKey(uint64_t inputHash) const {
+    const uint32_t version = LUT_CACHE_VERSION;
+    const VkExtent3D imageExtent = getLut()->getExtent();
+    uint64_t key = hashBytes(&version, sizeof(version));
+    key = hashBytes(&inputHash, sizeof(inputHash), key);
+    key = hashBytes(&imageExtent, sizeof(imageExtent), key);
+    // Content depends on the content of the dependencies too
+    for (const ILookUpTable *dependency: dependencies) {
+        key = hashBytes(&dependency->cacheKey, sizeof(dependency->cacheKey), key);
+    }
+    return key;
+}
+
+std::string ILookUpTable::getCacheFilename(const std::string &directory, uint64_t key) const {
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(directory) / (getLut()->getName() + "-" + hex + ".lut")).string();
+}
+
+bool ILookUpTable::loadCache(const std::string &directory, const AtmosphereUniformBufferData &atmosphere,
+                             const AtmosphereParameters &parameters, CommandQueueFamily queueFamily) {
+    // Key is chained from the keys of the dependencies which are only known once they are computed or restored
+    for (const ILookUpTable *dependency: dependencies) {
+        if (dependency->dirty) {
+            return false;
+        }
+    }
+
+    std::vector<float> inputs;
+    declareInputs(atmosphere, parameters, inputs);
+    const uint64_t hash = hashInputs(inputs);
+    const uint64_t key = computeCacheKey(hash);
+    const std::string filename = getCacheFilename(directory, key);
+    if (!std::filesystem::exists(filename)) {
+        return false;
+    }
+
+    Image *image = getLut();
+    const VkExtent3D imageExtent = image->getExtent();
+    const size_t texelCount = static_cast<size_t>(imageExtent.width) * imageExtent.height * imageExtent.depth;
+    std::vector<char> data = Filesystem::readFile(filename);
+    if (data.size() != texelCount * LUT_TEXEL_SIZE) {
+        Logger::log(LOG_LEVEL_WARN, "LUT cache file %s has unexpected size, ignoring it\n", filename.c_str());
+        return false;
+    }
+
+    ResourceHandle stagingBuffer = resourceManager.createResource<Buffer>(
+        "lut-cache-staging-buffer", BufferDesc{
+            .instanceSize = LUT_TEXEL_SIZE,
+            .instanceCount = static_cast<uint32_t>(texelCount),
+            .usageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .allocationFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+        }
+    );
+    Buffer *buffer = resourceManager.getResource<Buffer>(stagingBuffer);
+    buffer->map();
+    buffer->writeToBuffer(data.data());
+
+    VkCommandBuffer commandBuffer = beginCommands(device, queueFamily);
+    image->pipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_2_NONE,
+        VK_ACCESS_2_NONE,
+        VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+        VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED
+    );
+    VkBufferImageCopy region = wholeImageRegion(image);
+    vkCmdCopyBufferToImage(commandBuffer, buffer->getBuffer(), image->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           1, &region);
+    image->pipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+        VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED
+    );
+    endCommands(device, queueFamily, commandBuffer);
+    resourceManager.releaseResource(stagingBuffer.getUid());
+
+    // From now on the LUT behaves as if it was computed from these inputs
+    lastInputs = std::move(inputs);
+    lastHash = hash;
+    cacheKey = key;
+    dirty = false;
+    updated = false;
+
+    Logger::log(LOG_LEVEL_DEBUG, "Restored %s from %s\n", image->getName().c_str(), filename.c_str());
+    return true;
+}
+
+void ILookUpTable::storeCache(const std::string &directory, CommandQueueFamily queueFamily) {
+    if (dirty) {
+        return;
+    }
+
+    const std::string filename = getCacheFilename(directory, cacheKey);
+    if (std::filesystem::exists(filename)) {
+        return;
+    }
+
+    const std::vector<uint16_t> texels = readback(queueFamily);
+    std::filesystem::create_directories(directory);
+    std::ofstream file{filename, std::ios::binary};
+    if (file.is_open()) {
+        file.write(reinterpret_cast<const char *>(texels.data()),
+                   static_cast<std::streamsize>(texels.size() * sizeof(uint16_t)));
+        Logger::log(LOG_LEVEL_DEBUG, "Stored %s into %s\n", getLut()->getName().c_str(), filename.c_str());
+    } else {
+        Logger::log(LOG_LEVEL_WARN, "Failed to open LUT cache file %s\n", filename.c_str());
+    }
+}
+
+std::vector<uint16_t> ILookUpTable::readback(CommandQueueFamily queueFamily) {
+    Image *image = getLut();
+    const VkExtent3D imageExtent = image->getExtent();
+    const size_t texelCount = static_cast<size_t>(imageExtent.width) * imageExtent.height * imageExtent.depth;
+
+    ResourceHandle readbackBuffer = resourceManager.createResource<Buffer>(
+        "lut-readback-buffer", BufferDesc{
+            .instanceSize = LUT_TEXEL_SIZE,
+            .instanceCount = static_cast<uint32_t>(texelCount),
+            .usageFlags = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            .allocationFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+        }
+    );
+    Buffer *buffer = resourceManager.getResource<Buffer>(readbackBuffer);
+
+    VkCommandBuffer commandBuffer = beginCommands(device, queueFamily);
+    image->pipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        VK_ACCESS_2_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+        VK_ACCESS_2_TRANSFER_READ_BIT,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED
+    );
+    VkBufferImageCopy region = wholeImageRegion(image);
+    vkCmdCopyImageToBuffer(commandBuffer, image->getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer->getBuffer(),
+                           1, &region);
+    image->pipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+        VK_ACCESS_2_NONE,
+        VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED
+    );
+    endCommands(device, queueFamily, commandBuffer);
+
+    std::vector<uint16_t> texels(texelCount * 4);
+    buffer->map();
+    buffer->invalidate();
+    std::memcpy(texels.data(), buffer->getMappedMemory(), texelCount * LUT_TEXEL_SIZE);
+    buffer->unmap();
+    resourceManager.releaseResource(readbackBuffer.getUid());
+    return texels;
+}
+
+void ILookUpTable::recordWriteBarrier(VkCommandBuffer commandBuffer) const {
+    getLut()->pipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_READ_BIT,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED
+    );
+}
+
+void ILookUpTable::resize(const VkExtent3D &newExtent) {
+    extent = newExtent;
+    // Before initialization the LUT is created with these dimensions
+    if (!lut.isValid()) {
+        return;
+    }
+    releaseLut();
+    prepareLut();
+    invalidate();
+}
+
+void ILookUpTable::refreshDescriptors() {
+    descriptorPool->freeDescriptors({descriptor});
+    prepareDescriptors();
+}
+
+void ILookUpTable::releaseLut() {
+    resourceManager.releaseResource(lut.getUid());
+    resourceManager.releaseResource(sampler.getUid());
+}
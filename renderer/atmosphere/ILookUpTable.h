@@ -2,6 +2,9 @@
 #include "../IRenderGroup.h"
 #include "../Types.h"
 
+// Bump when the LUT shaders change so that stale cache files are not loaded
+#define LUT_CACHE_VERSION 2
+
 
 /**
  * Look Up Table common interface
@@ -17,14 +20,173 @@ public:
     Image *getLut() const { return resourceManager.getResource<Image>(lut); }
     VkPipelineLayout getPipelineLayout() const { return pipeline->pipelineLayout; }
 
+    /**
+     * Declares LUT that has to be recomputed before this one. If the dependency is updated in the frame, so is this LUT.
+     * @param lookUpTable LUT this LUT reads from
+     */
+    void addDependency(const ILookUpTable *lookUpTable) { dependencies.push_back(lookUpTable); }
+
+    /**
+     * Forces recomputation of the LUT in the next frame regardless of its inputs
+     */
+    void invalidate() { dirty = true; }
+
+    /**
+     * Decides whether the LUT needs to be recomputed this frame. Inputs declared by the LUT are hashed and compared
+     * with the inputs used for the last recomputation. LUT is recomputed only if hash differs and any of the inputs
+     * moved by more than the tolerance, or if any of the dependencies were recomputed this frame.
+     * Has to be called once per frame, in dependency order.
+     * @param atmosphere Atmosphere data that are about to be uploaded to the GPU
+     * @param parameters Planet parameters that are about to be uploaded to the GPU
+     * @return true if LUT has to be recomputed this frame
+     */
+    bool update(const AtmosphereUniformBufferData &atmosphere, const AtmosphereParameters &parameters) {
+        std::vector<float> inputs;
+        declareInputs(atmosphere, parameters, inputs);
+        const uint64_t hash = hashInputs(inputs);
+
+        bool changed = dirty || inputs.size() != lastInputs.size();
+        if (!changed && hash != lastHash) {
+            // Hash differs, check if the change is large enough to be visible
+            for (size_t i = 0; i < inputs.size(); i++) {
+                if (std::abs(inputs[i] - lastInputs[i]) > inputTolerance()) {
+                    changed = true;
+                    break;
+                }
+            }
+        }
+        for (const ILookUpTable *dependency: dependencies) {
+            changed |= dependency->isUpdated();
+        }
+
+        if (changed) {
+            // Inputs are only remembered when used, so slow drift accumulates until it crosses the tolerance
+            lastInputs = std::move(inputs);
+            lastHash = hash;
+            cacheKey = computeCacheKey(hash);
+            dirty = false;
+        }
+        updated = changed;
+        return updated;
+    }
+
+    /**
+     * Used instead of update in frames the LUT is not needed in. The LUT is not recomputed, but if any of its
+     * dependencies were, it is recomputed in the next update.
+     */
+    void skipUpdate() {
+        for (const ILookUpTable *dependency: dependencies) {
+            dirty |= dependency->isUpdated();
+        }
+        updated = false;
+    }
+
+    /**
+     * @return true if LUT was recomputed in the current frame
+     */
+    bool isUpdated() const { return updated; }
+
+    VkExtent3D getExtent() const { return extent; }
+
+    /**
+     * Changes the LUT dimensions. Before initialization only the dimensions are remembered, afterward the LUT image is
+     * recreated and recomputed in the next frame. GPU has to be idle. The descriptors of this LUT and of everything
+     * that reads it have to be refreshed afterward, as the image they point to no longer exists.
+     * @param newExtent New dimensions, depth is 1 for 2D LUTs
+     */
+    void resize(const VkExtent3D &newExtent);
+
+    /**
+     * Rewrites the descriptors after the LUT or any of the images it reads were recreated
+     */
+    void refreshDescriptors();
+
+    /**
+     * Copies the LUT content into host memory. The GPU has to be idle, blocks until the readback is finished.
+     * @param queueFamily Queue family that currently owns the LUT, the readback is submitted to it
+     * @return R16G16B16A16_SFLOAT texels, x fastest then y then z
+     */
+    std::vector<uint16_t> readback(CommandQueueFamily queueFamily);
+
+    /**
+     * Tries to fill the LUT from the on-disk cache. The cache key is derived from the inputs the LUT would be computed
+     * from right now, its dimensions and the keys of its dependencies, so dependencies have to be restored first.
+     * Restored LUT is not recomputed until its inputs change. Blocks until the upload is finished.
+     * @param directory Cache directory
+     * @param atmosphere Atmosphere data that are about to be uploaded to the GPU
+     * @param parameters Planet parameters that are about to be uploaded to the GPU
+     * @param queueFamily Queue family that produces the LUT, the upload is submitted to it
+     * @return true if the LUT was restored from the cache
+     */
+    bool loadCache(const std::string &directory, const AtmosphereUniformBufferData &atmosphere,
+                   const AtmosphereParameters &parameters, CommandQueueFamily queueFamily);
+
+    /**
+     * Writes the LUT into the cache under the key of the inputs it was last computed from. Does nothing if the LUT was
+     * never computed or if the file exists already. The GPU has to be idle, blocks until the readback is finished.
+     * @param directory Cache directory, created if it does not exist
+     * @param queueFamily Queue family that currently owns the LUT, the readback is submitted to it
+     */
+    void storeCache(const std::string &directory, CommandQueueFamily queueFamily);
+
 protected:
     ResourceHandle lut;
     ResourceHandle sampler;
     std::unique_ptr<DescriptorSetLayout> layout;
     VkDescriptorSet descriptor;
     std::unique_ptr<ComputePipeline> pipeline;
+    // Dimensions prepareLut creates the LUT with
+    VkExtent3D extent{};
 
     virtual void prepareLut() = 0;
+
+    /**
+     * Makes the dispatch that wrote the LUT visible to the dispatches reading it later in the same command buffer.
+     * LUTs are computed once and then skipped, a race with a dependent LUT would stay baked in.
+     */
+    void recordWriteBarrier(VkCommandBuffer commandBuffer) const;
+    // Releases everything prepareLut created
+    virtual void releaseLut();
     virtual void prepareDescriptors() = 0;
     virtual void preparePipeline(VkDescriptorSetLayout descriptorSetLayout) = 0;
+
+    /**
+     * Pushes runtime values the LUT depends on into inputs. LUT that declares no inputs is only computed
+     * when invalidated or when its dependencies change.
+     */
+    virtual void declareInputs(const AtmosphereUniformBufferData &atmosphere, const AtmosphereParameters &parameters,
+                               std::vector<float> &inputs) const {
+    }
+
+    /**
+     * Largest per input change that is still considered the same input
+     */
+    virtual float inputTolerance() const { return 0.0f; }
+
+private:
+    std::vector<const ILookUpTable *> dependencies;
+    std::vector<float> lastInputs;
+    uint64_t lastHash = 0;
+    uint64_t cacheKey = 0;
+    bool dirty = true;
+    bool updated = false;
+
+    // FNV-1a over raw bytes, hash can be chained through the seed
+    static uint64_t hashBytes(const void *data, size_t size, uint64_t hash = 14695981039346656037ull) {
+        const auto *bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static uint64_t hashInputs(const std::vector<float> &inputs) {
+        return hashBytes(inputs.data(), inputs.size() * sizeof(float));
+    }
+
+    // Identifies LUT content computed from inputs with given hash
+    uint64_t computeCacheKey(uint64_t inputHash) const;
+
+    std::string getCacheFilename(const std::string &directory, uint64_t key) const;
 };
@@ -19,9 +19,11 @@ void MultipleScattering::recordCommands(VkCommandBuffer commandBuffer, uint32_t
     // Bind the pipeline
     pipeline->bind(commandBuffer);
 
-    // Dispatch
-    vkCmdDispatch(commandBuffer, GROUPS_COUNT(MULTI_SCATTER_LUT_SIZE_X, 16), GROUPS_COUNT(MULTI_SCATTER_LUT_SIZE_Y, 16), 1);
+    // Dispatch, one group per texel, its threads split the sample directions
+    vkCmdDispatch(commandBuffer, extent.width, extent.height, 1);
     profiler.writeTimestamp(commandBuffer, 7, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    // Read by the LUTs recorded after it
+    recordWriteBarrier(commandBuffer);
 }
 
 void MultipleScattering::prepareDescriptors() {
@@ -42,8 +44,8 @@ void MultipleScattering::prepareDescriptors() {
 void MultipleScattering::prepareLut() {
     lut = resourceManager.createResource<Image>(
         "multiple-scattering-lut", ImageDesc{
-            .width = MULTI_SCATTER_LUT_SIZE_X,
-            .height = MULTI_SCATTER_LUT_SIZE_Y,
+            .width = extent.width,
+            .height = extent.height,
             .channels = 4,
             .format = VK_FORMAT_R16G16B16A16_SFLOAT,
             .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
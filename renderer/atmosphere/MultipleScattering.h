@@ -10,6 +10,7 @@ class MultipleScattering final : public ILookUpTable {
 public:
     MultipleScattering(Device &device, ResourceManager &resourceManager, Profiler& profiler)
         : ILookUpTable(device, resourceManager, profiler) {
+        extent = {MULTI_SCATTER_LUT_SIZE_X, MULTI_SCATTER_LUT_SIZE_Y, 1};
     }
 
     void initialize(VkDescriptorSetLayout descriptorSetLayout) override;
@@ -26,4 +27,10 @@ protected:
     void prepareLut() override;
 
     void preparePipeline(VkDescriptorSetLayout descriptorSetLayout) override;
+
+    // Everything else is covered by the dependency on transmittance
+    void declareInputs(const AtmosphereUniformBufferData &atmosphere, const AtmosphereParameters &parameters,
+                       std::vector<float> &inputs) const override {
+        inputs.push_back(parameters.asymmetryMie);
+    }
 };
\ No newline at end of file
@@ -11,7 +11,7 @@ void SkyView::recordCommands(VkCommandBuffer commandBuffer, uint32_t frameIndex)
     pipeline->bind(commandBuffer);
 
     // Dispatch
-    vkCmdDispatch(commandBuffer, GROUPS_COUNT(SKY_VIEW_LUT_SIZE_X, 8), GROUPS_COUNT(SKY_VIEW_LUT_SIZE_Y, 8), 1);
+    vkCmdDispatch(commandBuffer, GROUPS_COUNT(extent.width, 8), GROUPS_COUNT(extent.height, 8), 1);
     profiler.writeTimestamp(commandBuffer, 9, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
 }
 
@@ -27,8 +27,8 @@ void SkyView::initialize(VkDescriptorSetLayout descriptorSetLayout) {
 void SkyView::prepareLut() {
     lut = resourceManager.createResource<Image>(
         "sky-view-lut", ImageDesc{
-            .width = SKY_VIEW_LUT_SIZE_X,
-            .height = SKY_VIEW_LUT_SIZE_Y,
+            .width = extent.width,
+            .height = extent.height,
             .channels = 4,
             .format = VK_FORMAT_R16G16B16A16_SFLOAT,
             .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
@@ -36,7 +36,8 @@ void SkyView::prepareLut() {
             .imageViewType = VK_IMAGE_VIEW_TYPE_2D,
             .currentQueueFamily = CommandQueueFamily::Compute,
             .queueFamilies = {CommandQueueFamily::Compute, CommandQueueFamily::Graphics},
-            .sharingMode = VK_SHARING_MODE_EXCLUSIVE
+            // Computed only in some frames but read by both queues in every frame, so it is never transferred
+            .sharingMode = VK_SHARING_MODE_CONCURRENT
         }
     );
     // transition
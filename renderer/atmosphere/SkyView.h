@@ -3,11 +3,14 @@
 
 #define SKY_VIEW_LUT_SIZE_X 200
 #define SKY_VIEW_LUT_SIZE_Y 100
+// Changes of eye altitude and sun direction smaller than this do not trigger recomputation
+#define SKY_VIEW_INPUT_TOLERANCE 1e-4f
 
 class SkyView final : public ILookUpTable {
 public:
     SkyView(Device &device, ResourceManager &resourceManager, Profiler& profiler)
         : ILookUpTable(device, resourceManager, profiler) {
+        extent = {SKY_VIEW_LUT_SIZE_X, SKY_VIEW_LUT_SIZE_Y, 1};
     }
 
     void recordCommands(VkCommandBuffer commandBuffer, uint32_t frameIndex) override;
@@ -26,4 +29,15 @@ protected:
     void prepareDescriptors() override;
 
     void preparePipeline(VkDescriptorSetLayout descriptorSetLayout) override;
+
+    // Sky view only depends on eye altitude and sun direction
+    void declareInputs(const AtmosphereUniformBufferData &atmosphere, const AtmosphereParameters &parameters,
+                       std::vector<float> &inputs) const override {
+        inputs.push_back(atmosphere.eye.Y);
+        inputs.push_back(atmosphere.sunDirection.X);
+        inputs.push_back(atmosphere.sunDirection.Y);
+        inputs.push_back(atmosphere.sunDirection.Z);
+    }
+
+    float inputTolerance() const override { return SKY_VIEW_INPUT_TOLERANCE; }
 };
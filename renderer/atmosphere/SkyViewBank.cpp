@@ -0,0 +1,132 @@
+#include "SkyViewBank.h"
+
+void SkyViewBank::recordCommands(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+    const uint32_t layerCount = std::min<uint32_t>(SKY_VIEW_BANK_LAYERS_PER_FRAME, extent.depth - builtLayers);
+    data.firstLayer = builtLayers;
+
+    // Bind the descriptor set
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->pipelineLayout, 1, 1,
+                            &descriptor, 0, nullptr);
+
+    // Bind the pipeline
+    pipeline->bind(commandBuffer);
+
+    // Push the layers of this frame
+    vkCmdPushConstants(commandBuffer, pipeline->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(SkyViewBankPushConstantData), &data);
+
+    // Dispatch, one layer per z
+    vkCmdDispatch(commandBuffer, GROUPS_COUNT(extent.width, 8), GROUPS_COUNT(extent.height, 8), layerCount);
+    // Layers of the batch are sampled once the bank covers the eye and the sun
+    recordWriteBarrier(commandBuffer);
+
+    builtLayers += layerCount;
+}
+
+void SkyViewBank::initialize(VkDescriptorSetLayout descriptorSetLayout) {
+    SkyViewBank::prepareLut();
+    SkyViewBank::prepareDescriptors();
+    SkyViewBank::preparePipeline(descriptorSetLayout);
+
+    device.waitIdle();
+    processDeletionQueue();
+}
+
+void SkyViewBank::setLayerCount(uint32_t count) {
+    ASSERT(count != 1, "Sky view bank needs at least two layers to interpolate between");
+    ASSERT(!lut.isValid(), "Sky view bank layer count has to be set before initialization");
+    enabled = count > 0;
+    extent.depth = enabled ? count : 1;
+}
+
+void SkyViewBank::prepareFrame(const AtmosphereUniformBufferData &atmosphere, const AtmosphereParameters &parameters) {
+    if (!enabled) {
+        skipUpdate();
+        return;
+    }
+    if (drainFrames > 0) {
+        drainFrames--;
+    }
+    if (update(atmosphere, parameters)) {
+        // Built from scratch at the current altitude, partially built bank is never sampled. Frames still in flight
+        // may sample the previous bank, so the first layers are written once all of them have finished.
+        if (isReady()) {
+            drainFrames = SwapChain::MAX_FRAMES_IN_FLIGHT;
+        }
+        builtLayers = 0;
+        data.eyeHeight = atmosphere.eye.Y;
+        data.minElevation = SKY_VIEW_BANK_MIN_ELEVATION;
+        data.maxElevation = SKY_VIEW_BANK_MAX_ELEVATION;
+    }
+}
+
+float SkyViewBank::getLayer(const AtmosphereUniformBufferData &atmosphere) const {
+    if (!isReady() || std::abs(atmosphere.eye.Y - data.eyeHeight) > SKY_VIEW_BANK_HEIGHT_TOLERANCE) {
+        return -1.0f;
+    }
+    const float elevation = std::asin(std::clamp(HmckNorm(atmosphere.sunDirection.XYZ).Y, -1.0f, 1.0f));
+    if (elevation < SKY_VIEW_BANK_MIN_ELEVATION || elevation > SKY_VIEW_BANK_MAX_ELEVATION) {
+        return -1.0f;
+    }
+    return (elevation - SKY_VIEW_BANK_MIN_ELEVATION) / (SKY_VIEW_BANK_MAX_ELEVATION - SKY_VIEW_BANK_MIN_ELEVATION) *
+           static_cast<float>(extent.depth - 1);
+}
+
+void SkyViewBank::prepareLut() {
+    lut = resourceManager.createResource<Image>(
+        "sky-view-bank", ImageDesc{
+            .width = extent.width,
+            .height = extent.height,
+            .channels = 4,
+            .layers = extent.depth,
+            .format = VK_FORMAT_R16G16B16A16_SFLOAT,
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .imageViewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+            .currentQueueFamily = CommandQueueFamily::Compute,
+            .queueFamilies = {CommandQueueFamily::Compute, CommandQueueFamily::Graphics},
+            .sharingMode = VK_SHARING_MODE_CONCURRENT
+        }
+    );
+    // transition
+    resourceManager.getResource<Image>(lut)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_GENERAL);
+
+    sampler = resourceManager.createResource<Sampler>("sky-view-bank-sampler", SamplerDesc{});
+}
+
+void SkyViewBank::releaseLut() {
+    ILookUpTable::releaseLut();
+    builtLayers = 0;
+    drainFrames = 0;
+}
+
+void SkyViewBank::prepareDescriptors() {
+    layout = DescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Transmittance
+            .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Multiple scattering
+            .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT) // Sky view bank
+            .build();
+
+    Sampler *s = resourceManager.getResource<Sampler>(sampler);
+    VkDescriptorImageInfo lutInfo = resourceManager.getResource<Image>(lut)->getDescriptorImageInfo(s->getSampler());
+    VkDescriptorImageInfo transmittanceInfo = transmittance->getDescriptorImageInfo(s->getSampler());
+    VkDescriptorImageInfo multipleScatteringInfo = multipleScattering->getDescriptorImageInfo(s->getSampler());
+    DescriptorWriter(*layout, *descriptorPool)
+            .writeImage(0, &transmittanceInfo)
+            .writeImage(1, &multipleScatteringInfo)
+            .writeImage(2, &lutInfo)
+            .build(descriptor);
+}
+
+void SkyViewBank::preparePipeline(VkDescriptorSetLayout descriptorSetLayout) {
+    pipeline = ComputePipeline::create({
+        .debugName = "sky-view-bank-compute-pipeline",
+        .device = device,
+        .computeShader{.byteCode = Filesystem::readFile(COMPILED_SHADER_PATH("skyviewbank.comp")),},
+        .descriptorSetLayouts = {
+            descriptorSetLayout,
+            layout->getDescriptorSetLayout()
+        },
+        .pushConstantRanges{{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SkyViewBankPushConstantData)}}
+    });
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "ILookUpTable.h"
+#include "SkyView.h"
+
+// Layers computed per frame while the bank is being built
+#define SKY_VIEW_BANK_LAYERS_PER_FRAME 4
+// Sun elevations covered by the bank in radians, from below the horizon to zenith
+#define SKY_VIEW_BANK_MIN_ELEVATION -0.2f
+#define SKY_VIEW_BANK_MAX_ELEVATION 1.5707964f
+// How far the eye can move vertically from the altitude the bank was built at before the live sky view takes over
+#define SKY_VIEW_BANK_HEIGHT_TOLERANCE 0.1f
+
+/**
+ * Sky view LUTs precomputed for evenly spaced sun elevations at a fixed eye altitude, stored as layers of a 2D array.
+ * Sky view is rotationally symmetric around the vertical axis, so the layers are computed with the sun at zero
+ * azimuth and the lookup is rotated by the sun azimuth. The bank is built a few layers per frame and rebuilt when the
+ * planet or the LUTs it reads change. Until it is complete, or when the eye or the sun leave its range, the live sky
+ * view LUT is used. The bank is written by the compute queue and sampled by the graphics queue, it is shared
+ * concurrently so a rebuild never has to take it back from the graphics queue.
+ */
+class SkyViewBank final : public ILookUpTable {
+public:
+    SkyViewBank(Device &device, ResourceManager &resourceManager, Profiler &profiler)
+        : ILookUpTable(device, resourceManager, profiler) {
+        // Single layer placeholder while disabled, the composition binds the bank either way
+        extent = {SKY_VIEW_LUT_SIZE_X, SKY_VIEW_LUT_SIZE_Y, 1};
+    }
+
+    void recordCommands(VkCommandBuffer commandBuffer, uint32_t frameIndex) override;
+
+    void initialize(VkDescriptorSetLayout descriptorSetLayout) override;
+
+    void setTransmittance(Image *image) { transmittance = image; }
+    void setMultipleScattering(Image *image) { multipleScattering = image; }
+
+    /**
+     * Sets the number of sun elevations, has to be called before initialization
+     * @param count Number of layers, at least 2, 0 disables the bank
+     */
+    void setLayerCount(uint32_t count);
+
+    bool isEnabled() const { return enabled; }
+
+    /**
+     * Restarts the build if the planet or the LUTs the bank reads changed, has to be called once per frame instead
+     * of update, in dependency order
+     */
+    void prepareFrame(const AtmosphereUniformBufferData &atmosphere, const AtmosphereParameters &parameters);
+
+    // All layers are computed
+    bool isReady() const { return enabled && builtLayers == extent.depth; }
+
+    // Layers have to be computed in the current frame
+    bool isBuilding() const { return enabled && !isReady() && drainFrames == 0; }
+
+    /**
+     * @return Fractional layer to sample for the eye and sun of the frame, negative if the bank does not cover them
+     */
+    float getLayer(const AtmosphereUniformBufferData &atmosphere) const;
+
+    uint32_t getLayerCount() const { return extent.depth; }
+
+protected:
+    Image *transmittance;
+    Image *multipleScattering;
+
+    SkyViewBankPushConstantData data{};
+    bool enabled = false;
+    uint32_t builtLayers = 0;
+    // Frames left until no frame in flight samples the bank, the rebuild does not write before that
+    uint32_t drainFrames = 0;
+
+    void prepareLut() override;
+
+    void releaseLut() override;
+
+    void prepareDescriptors() override;
+
+    void preparePipeline(VkDescriptorSetLayout descriptorSetLayout) override;
+
+    // Eye and sun are handled by the range check, only the planet itself invalidates the layers
+    void declareInputs(const AtmosphereUniformBufferData &atmosphere, const AtmosphereParameters &parameters,
+                       std::vector<float> &inputs) const override {
+        inputs.insert(inputs.end(), parameters.scatterRayleigh.Elements, parameters.scatterRayleigh.Elements + 3);
+        inputs.insert(inputs.end(), parameters.absorbOzone.Elements, parameters.absorbOzone.Elements + 3);
+        inputs.insert(inputs.end(), {
+                          parameters.planetRadius, parameters.atmosphereRadius, parameters.ozoneThickness,
+                          parameters.ozoneCenterHeight, parameters.hDensityMie, parameters.absorbMie,
+                          parameters.asymmetryMie, parameters.scatterMie, parameters.hDensityRayleigh
+                      });
+    }
+};
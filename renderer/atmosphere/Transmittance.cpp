@@ -19,9 +19,15 @@ void Transmittance::recordCommands(VkCommandBuffer commandBuffer, uint32_t frame
     // Bind the pipeline
     pipeline->bind(commandBuffer);
 
+    // Push the integrator
+    vkCmdPushConstants(commandBuffer, pipeline->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(TransmittancePushConstantData), &data);
+
     // Dispatch
-    vkCmdDispatch(commandBuffer, GROUPS_COUNT(TRANSMITTANCE_LUT_SIZE_X,16), GROUPS_COUNT(TRANSMITTANCE_LUT_SIZE_Y,16), 1);
+    vkCmdDispatch(commandBuffer, GROUPS_COUNT(extent.width, 16), GROUPS_COUNT(extent.height, 16), 1);
     profiler.writeTimestamp(commandBuffer, 5, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    // Read by the LUTs recorded after it
+    recordWriteBarrier(commandBuffer);
 }
 
 void Transmittance::prepareDescriptors() {
@@ -39,8 +45,8 @@ void Transmittance::prepareDescriptors() {
 void Transmittance::prepareLut() {
     lut = resourceManager.createResource<Image>(
         "transmittance-lut", ImageDesc{
-            .width = TRANSMITTANCE_LUT_SIZE_X,
-            .height = TRANSMITTANCE_LUT_SIZE_Y,
+            .width = extent.width,
+            .height = extent.height,
             .channels = 4,
             .format = VK_FORMAT_R16G16B16A16_SFLOAT,
             .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
@@ -48,7 +54,8 @@ void Transmittance::prepareLut() {
             .imageViewType = VK_IMAGE_VIEW_TYPE_2D,
             .currentQueueFamily = CommandQueueFamily::Compute,
             .queueFamilies = {CommandQueueFamily::Compute, CommandQueueFamily::Graphics},
-            .sharingMode = VK_SHARING_MODE_EXCLUSIVE
+            // Computed only in some frames but read by both queues in every frame, so it is never transferred
+            .sharingMode = VK_SHARING_MODE_CONCURRENT
         }
     );
     // transition
@@ -68,6 +75,6 @@ void Transmittance::preparePipeline(VkDescriptorSetLayout descriptorSetLayout) {
             descriptorSetLayout,
             layout->getDescriptorSetLayout()
         },
-        .pushConstantRanges{}
+        .pushConstantRanges{{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(TransmittancePushConstantData)}}
     });
 }
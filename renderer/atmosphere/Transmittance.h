@@ -11,17 +11,39 @@ class Transmittance : public ILookUpTable {
 public:
     Transmittance(Device &device, ResourceManager &resourceManager, Profiler& profiler)
         : ILookUpTable(device, resourceManager, profiler) {
+        extent = {TRANSMITTANCE_LUT_SIZE_X, TRANSMITTANCE_LUT_SIZE_Y, 1};
     }
 
     void initialize(VkDescriptorSetLayout descriptorSetLayout) override;
 
     void recordCommands(VkCommandBuffer commandBuffer, uint32_t frameIndex) override;
 
+    // LUT is recomputed in the next update when the integrator changes
+    void setIntegrator(TransmittanceIntegrator newIntegrator) {
+        data.integrator = static_cast<int32_t>(newIntegrator);
+    }
+
+    TransmittanceIntegrator getIntegrator() const { return static_cast<TransmittanceIntegrator>(data.integrator); }
+
 protected:
+    TransmittancePushConstantData data;
+
     void prepareDescriptors() override;
 
     void prepareLut() override;
 
     void preparePipeline(VkDescriptorSetLayout descriptorSetLayout) override;
 
+    // Transmittance depends on the planet only, phase function does not affect it
+    void declareInputs(const AtmosphereUniformBufferData &atmosphere, const AtmosphereParameters &parameters,
+                       std::vector<float> &inputs) const override {
+        inputs.insert(inputs.end(), parameters.scatterRayleigh.Elements, parameters.scatterRayleigh.Elements + 3);
+        inputs.insert(inputs.end(), parameters.absorbOzone.Elements, parameters.absorbOzone.Elements + 3);
+        inputs.insert(inputs.end(), {
+                          parameters.planetRadius, parameters.atmosphereRadius, parameters.ozoneThickness,
+                          parameters.ozoneCenterHeight, parameters.hDensityMie, parameters.absorbMie,
+                          parameters.scatterMie, parameters.hDensityRayleigh,
+                          static_cast<float>(data.integrator)
+                      });
+    }
 };
@@ -0,0 +1,223 @@
+#include "CloudNoiseGenerator.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+    // FNV-1a over raw bytes, hash can be chained through the seed
+    uint64_t hashBytes(const void *data, size_t size, uint64_t hash = 14695981039346656037ull) {
+        const auto *bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Single time commands on the compute queue, device helpers only use the graphics queue
+    VkCommandBuffer beginCommands(Device &device) {
+        VkCommandBufferAllocateInfo allocInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = device.getComputeCommandPool(),
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        };
+        VkCommandBuffer commandBuffer;
+        ASSERT(vkAllocateCommandBuffers(device.device(), &allocInfo, &commandBuffer) == VK_SUCCESS,
+               "Failed to allocate cloud noise command buffer!");
+
+        VkCommandBufferBeginInfo beginInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        };
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        return commandBuffer;
+    }
+
+    void endCommands(Device &device, VkCommandBuffer commandBuffer) {
+        vkEndCommandBuffer(commandBuffer);
+        VkSubmitInfo submitInfo = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &commandBuffer,
+        };
+        vkQueueSubmit(device.computeQueue(), 1, &submitInfo, VK_NULL_HANDLE);
+        vkQueueWaitIdle(device.computeQueue());
+        vkFreeCommandBuffers(device.device(), device.getComputeCommandPool(), 1, &commandBuffer);
+    }
+}
+
+CloudNoiseGenerator::CloudNoiseGenerator(Device &device, ResourceManager &resourceManager,
+                                         const CloudNoiseParameters &parameters, const std::string &cacheDirectory)
+    : device(device), resourceManager(resourceManager), parameters(parameters), cacheDirectory(cacheDirectory) {
+    ASSERT(parameters.baseSize % (2 * CLOUD_NOISE_WORK_GROUP_SIZE) == 0 &&
+           parameters.detailSize % (4 * CLOUD_NOISE_WORK_GROUP_SIZE) == 0,
+           "Cloud noise volumes have to be multiples of the packed work group size");
+
+    descriptorPool = DescriptorPool::Builder(device)
+            .setMaxSets(2)
+            .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2)
+            .build();
+
+    layout = DescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Packed texels
+            .build();
+
+    basePipeline = ComputePipeline::create({
+        .debugName = "cloud-base-noise-compute-pipeline",
+        .device = device,
+        .computeShader{.byteCode = Filesystem::readFile(COMPILED_SHADER_PATH("cloudnoisebase.comp")),},
+        .descriptorSetLayouts = {
+            layout->getDescriptorSetLayout()
+        },
+        .pushConstantRanges{{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstantData)}}
+    });
+
+    detailPipeline = ComputePipeline::create({
+        .debugName = "cloud-detail-noise-compute-pipeline",
+        .device = device,
+        .computeShader{.byteCode = Filesystem::readFile(COMPILED_SHADER_PATH("cloudnoisedetail.comp")),},
+        .descriptorSetLayouts = {
+            layout->getDescriptorSetLayout()
+        },
+        .pushConstantRanges{{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstantData)}}
+    });
+}
+
+CloudNoiseGenerator::~CloudNoiseGenerator() = default;
+
+std::vector<uint8_t> CloudNoiseGenerator::generateBase() {
+    return generate("cloud-base-noise", *basePipeline, getBaseData(parameters), 2, 2);
+}
+
+std::vector<uint8_t> CloudNoiseGenerator::generateDetail() {
+    return generate("cloud-detail-noise", *detailPipeline, getDetailData(parameters), 1, 4);
+}
+
+std::string CloudNoiseGenerator::getBaseCacheFilename(const std::string &cacheDirectory,
+                                                      const CloudNoiseParameters &parameters) {
+    return getCacheFilename(cacheDirectory, "cloud-base-noise", getBaseData(parameters));
+}
+
+std::string CloudNoiseGenerator::getDetailCacheFilename(const std::string &cacheDirectory,
+                                                        const CloudNoiseParameters &parameters) {
+    return getCacheFilename(cacheDirectory, "cloud-detail-noise", getDetailData(parameters));
+}
+
+CloudNoiseGenerator::PushConstantData CloudNoiseGenerator::getBaseData(const CloudNoiseParameters &parameters) {
+    return {
+        .size = parameters.baseSize,
+        .seed = parameters.seed,
+        .perlinFrequency = parameters.basePerlinFrequency,
+        .perlinOctaves = parameters.basePerlinOctaves,
+        .worleyFrequency = parameters.baseWorleyFrequency,
+    };
+}
+
+CloudNoiseGenerator::PushConstantData CloudNoiseGenerator::getDetailData(const CloudNoiseParameters &parameters) {
+    return {
+        .size = parameters.detailSize,
+        .seed = parameters.seed,
+        .perlinFrequency = 0.0f,
+        .perlinOctaves = 0,
+        .worleyFrequency = parameters.detailWorleyFrequency,
+    };
+}
+
+std::vector<uint8_t> CloudNoiseGenerator::generate(const std::string &name, ComputePipeline &pipeline,
+                                                   const PushConstantData &data, uint32_t bytesPerTexel,
+                                                   uint32_t texelsPerWord) {
+    const size_t byteCount = static_cast<size_t>(data.size) * data.size * data.size * bytesPerTexel;
+
+    const std::string filename = cacheDirectory.empty() ? "" : getCacheFilename(cacheDirectory, name, data);
+    if (!filename.empty() && std::filesystem::exists(filename)) {
+        std::vector<char> file = Filesystem::readFile(filename);
+        if (file.size() == byteCount) {
+            Logger::log(LOG_LEVEL_DEBUG, "Restored %s from %s\n", name.c_str(), filename.c_str());
+            return {file.begin(), file.end()};
+        }
+        Logger::log(LOG_LEVEL_WARN, "Cloud noise cache file %s has unexpected size, ignoring it\n", filename.c_str());
+    }
+
+    std::vector<uint8_t> texels = dispatch(pipeline, data, byteCount, texelsPerWord);
+
+    if (!filename.empty()) {
+        std::filesystem::create_directories(cacheDirectory);
+        std::ofstream file{filename, std::ios::binary};
+        if (file.is_open()) {
+            file.write(reinterpret_cast<const char *>(texels.data()), static_cast<std::streamsize>(texels.size()));
+            Logger::log(LOG_LEVEL_DEBUG, "Stored %s into %s\n", name.c_str(), filename.c_str());
+        } else {
+            Logger::log(LOG_LEVEL_WARN, "Failed to open cloud noise cache file %s\n", filename.c_str());
+        }
+    }
+    return texels;
+}
+
+std::vector<uint8_t> CloudNoiseGenerator::dispatch(ComputePipeline &pipeline, const PushConstantData &data,
+                                                   size_t byteCount, uint32_t texelsPerWord) {
+    // Shader writes straight into host visible memory, the volume is read once
+    ResourceHandle outputBuffer = resourceManager.createResource<Buffer>(
+        "cloud-noise-output-buffer", BufferDesc{
+            .instanceSize = sizeof(uint32_t),
+            .instanceCount = static_cast<uint32_t>(byteCount / sizeof(uint32_t)),
+            .usageFlags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            .allocationFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+        }
+    );
+    Buffer *buffer = resourceManager.getResource<Buffer>(outputBuffer);
+
+    VkDescriptorSet descriptor;
+    VkDescriptorBufferInfo bufferInfo = buffer->descriptorInfo();
+    DescriptorWriter(*layout, *descriptorPool)
+            .writeBuffer(0, &bufferInfo)
+            .build(descriptor);
+
+    VkCommandBuffer commandBuffer = beginCommands(device);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipelineLayout, 0, 1,
+                            &descriptor, 0, nullptr);
+    pipeline.bind(commandBuffer);
+    vkCmdPushConstants(commandBuffer, pipeline.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(PushConstantData), &data);
+    vkCmdDispatch(commandBuffer, GROUPS_COUNT(data.size / texelsPerWord, CLOUD_NOISE_WORK_GROUP_SIZE),
+                  GROUPS_COUNT(data.size, CLOUD_NOISE_WORK_GROUP_SIZE),
+                  GROUPS_COUNT(data.size, CLOUD_NOISE_WORK_GROUP_SIZE));
+
+    // Make the shader writes visible to the host
+    VkMemoryBarrier2 barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+        .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        .srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT,
+        .dstAccessMask = VK_ACCESS_2_HOST_READ_BIT,
+    };
+    VkDependencyInfo dependencyInfo = {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &barrier,
+    };
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+    endCommands(device, commandBuffer);
+
+    std::vector<uint8_t> texels(byteCount);
+    buffer->map();
+    buffer->invalidate();
+    std::memcpy(texels.data(), buffer->getMappedMemory(), byteCount);
+    buffer->unmap();
+
+    descriptorPool->freeDescriptors({descriptor});
+    resourceManager.releaseResource(outputBuffer.getUid());
+    return texels;
+}
+
+std::string CloudNoiseGenerator::getCacheFilename(const std::string &cacheDirectory, const std::string &name,
+                                                  const PushConstantData &data) {
+    const uint32_t version = CLOUD_NOISE_CACHE_VERSION;
+    uint64_t key = hashBytes(&version, sizeof(version));
+    key = hashBytes(&data, sizeof(data), key);
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(cacheDirectory) / (name + "-" + hex + ".noise")).string();
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <hammock/hammock.h>
+#include "../Types.h"
+
+using namespace hammock;
+
+// Bump when the noise shader changes so that stale cache files are not loaded
+#define CLOUD_NOISE_CACHE_VERSION 1
+#define CLOUD_NOISE_WORK_GROUP_SIZE 8
+
+// Everything the noise volumes are generated from, hashed into the cache key
+struct CloudNoiseParameters {
+    uint32_t seed = 1;
+    uint32_t baseSize = 128;
+    uint32_t detailSize = 32;
+    // Lattice cells per side of the lowest Perlin octave of the base volume
+    float basePerlinFrequency = 8.0f;
+    uint32_t basePerlinOctaves = 3;
+    // Cells per side of the lowest Worley octave, the next octaves double it
+    float baseWorleyFrequency = 4.0f;
+    float detailWorleyFrequency = 4.0f;
+};
+
+/**
+ * Generates the tileable cloud noise volumes on the compute queue. Base volume is R8G8, Perlin-Worley in red and the
+ * FBM of the Worley octaves in green, detail volume is R8 Worley FBM. Texels are returned packed the way the images
+ * store them, x fastest then y then z, so that they can be uploaded like any other texture. Generated volumes are
+ * stored in the cache directory under a hash of the parameters and loaded from it the next time.
+ */
+class CloudNoiseGenerator final {
+public:
+    /**
+     * @param cacheDirectory Directory of the cached volumes, empty disables the cache
+     */
+    CloudNoiseGenerator(Device &device, ResourceManager &resourceManager, const CloudNoiseParameters &parameters,
+                        const std::string &cacheDirectory);
+
+    ~CloudNoiseGenerator();
+
+    // Blocks until the volume is generated or loaded, baseSize^3 texels of two bytes
+    std::vector<uint8_t> generateBase();
+
+    // Blocks until the volume is generated or loaded, detailSize^3 texels of one byte
+    std::vector<uint8_t> generateDetail();
+
+    const CloudNoiseParameters &getParameters() const { return parameters; }
+
+    // Cache files the volumes are stored into, also read by the CPU reference of the clouds
+    static std::string getBaseCacheFilename(const std::string &cacheDirectory, const CloudNoiseParameters &parameters);
+
+    static std::string getDetailCacheFilename(const std::string &cacheDirectory, const CloudNoiseParameters &parameters);
+
+private:
+    struct PushConstantData {
+        uint32_t size;
+        uint32_t seed;
+        float perlinFrequency;
+        uint32_t perlinOctaves;
+        float worleyFrequency;
+    };
+
+    Device &device;
+    ResourceManager &resourceManager;
+    CloudNoiseParameters parameters;
+    std::string cacheDirectory;
+
+    // Storage buffers are not in the pool of the render groups
+    std::unique_ptr<DescriptorPool> descriptorPool;
+    std::unique_ptr<DescriptorSetLayout> layout;
+    std::unique_ptr<ComputePipeline> basePipeline;
+    std::unique_ptr<ComputePipeline> detailPipeline;
+
+    /**
+     * Loads the volume from the cache or dispatches the pipeline and stores the result into the cache
+     * @param name Volume name, part of the cache file name
+     * @param texelsPerWord Texels one shader invocation packs into a 32-bit word
+     */
+    std::vector<uint8_t> generate(const std::string &name, ComputePipeline &pipeline, const PushConstantData &data,
+                                  uint32_t bytesPerTexel, uint32_t texelsPerWord);
+
+    std::vector<uint8_t> dispatch(ComputePipeline &pipeline, const PushConstantData &data, size_t byteCount,
+                                  uint32_t texelsPerWord);
+
+    static PushConstantData getBaseData(const CloudNoiseParameters &parameters);
+
+    static PushConstantData getDetailData(const CloudNoiseParameters &parameters);
+
+    static std::string getCacheFilename(const std::string &cacheDirectory, const std::string &name,
+                                        const PushConstantData &data);
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include "../Types.h"
+
+/**
+ * Ray-march settings of a cloud quality preset. Medium is the default, high and ultra are the settings used for
+ * captures. Presets are baked into the cloud pipelines as specialization constants, so the shader compiler sees
+ * constant loop bounds and drops the debug views.
+ */
+struct CloudQualitySettings {
+    int32_t maxSamples;
+    int32_t maxLightSamples;
+    float longStepMultiplier;
+
+    static CloudQualitySettings fromQuality(CloudQuality quality) {
+        switch (quality) {
+            case CloudQuality::Low:
+                return {64, 3, 3.0f};
+            case CloudQuality::High:
+                return {256, 10, 3.0f};
+            case CloudQuality::Ultra:
+                return {512, 16, 2.0f};
+            case CloudQuality::Medium:
+            default:
+                return {128, 4, 2.5f};
+        }
+    }
+
+    // Same settings as they are passed through the push constants, debug views are off in every preset
+    void apply(CloudsPushConstantData &properties) const {
+        properties.DEBUG_maxSamples = maxSamples;
+        properties.DEBUG_maxLightSamples = maxLightSamples;
+        properties.DEBUG_longStepMulti = longStepMultiplier;
+        properties.DEBUG_earlyTermination = 0;
+        properties.DEBUG_lateTermination = 0;
+    }
+
+    // Same settings as the specialization constants of the preset pipelines
+    CloudsSpecializationData specialization() const {
+        return {
+            .specialized = VK_TRUE,
+            .maxSamples = maxSamples,
+            .maxLightSamples = maxLightSamples,
+            .longStepMultiplier = longStepMultiplier,
+        };
+    }
+
+    static const char *name(CloudQuality quality) {
+        switch (quality) {
+            case CloudQuality::Low: return "low";
+            case CloudQuality::High: return "high";
+            case CloudQuality::Ultra: return "ultra";
+            case CloudQuality::Custom: return "custom";
+            case CloudQuality::Medium:
+            default: return "medium";
+        }
+    }
+};
@@ -1,5 +1,47 @@
 #include "CloudsPass.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace {
+    // Orders the accesses to the tile lists between the classification, the indirect dispatches and the next frame
+    void tileListsBarrier(VkCommandBuffer commandBuffer, VkBuffer buffer, VkPipelineStageFlags2 srcStage,
+                          VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess) {
+        VkBufferMemoryBarrier2 barrier = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+            .srcStageMask = srcStage,
+            .srcAccessMask = srcAccess,
+            .dstStageMask = dstStage,
+            .dstAccessMask = dstAccess,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer = buffer,
+            .offset = 0,
+            .size = VK_WHOLE_SIZE,
+        };
+        VkDependencyInfo dependencyInfo = {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .bufferMemoryBarrierCount = 1,
+            .pBufferMemoryBarriers = &barrier,
+        };
+        vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+    }
+
+    // Mirrors projectOnCloudBase in toolbox.slang, in double precision as the shell dwarfs the distances on it
+    HmckVec2 projectOnCloudBase(const HmckVec3 &position, const HmckVec3 &direction) {
+        const double ox = position.X;
+        const double oy = position.Y + CLOUDS_EARTH_RADIUS;
+        const double oz = position.Z;
+        const double b = ox * direction.X + oy * direction.Y + oz * direction.Z;
+        const double c = ox * ox + oy * oy + oz * oz - CLOUDS_BOTTOM_RADIUS * CLOUDS_BOTTOM_RADIUS;
+        const double t = std::max(-b + std::sqrt(std::max(b * b - c, 0.0)), 0.0);
+        return HmckVec2{
+            static_cast<float>(position.X + direction.X * t), static_cast<float>(position.Z + direction.Z * t)
+        };
+    }
+}
+
 void CloudsPass::initialize(HmckVec2 resolution) {
     prepareResources();
     prepareTargets(static_cast<uint32_t>(resolution.X), static_cast<uint32_t>(resolution.Y));
@@ -10,14 +52,45 @@ void CloudsPass::initialize(HmckVec2 resolution) {
     processDeletionQueue();
 }
 
+void CloudsPass::setRenderScale(uint32_t divisor) {
+    ASSERT(divisor == 1 || divisor == 2 || divisor == 4, "Clouds can be rendered at 1/1, 1/2 or 1/4 resolution");
+    ASSERT(!color.isValid(), "Clouds render scale has to be set before initialization");
+    renderScale = divisor;
+}
+
 void CloudsPass::recordCommands(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
-    // Update buffer
-    resourceManager.getResource<Buffer>(uniformBuffers[frameIndex])->writeToBuffer(&uniform);
+    // Presets keep the push constants in sync with the pipelines, so that switching to custom starts from the preset
+    if (quality != CloudQuality::Custom) {
+        CloudQualitySettings::fromQuality(quality).apply(properties);
+    }
+    PipelineVariant &variant = getPipelineVariant(specialized ? quality : CloudQuality::Custom);
 
     // Get target pointers
-    // We are drawing into two storage images
-    Image *cloudsColorTarget = resourceManager.getResource<Image>(color);
-    VkExtent3D cloudsDispatchSize = cloudsColorTarget->getExtent();
+    Image *raymarchTarget = resourceManager.getResource<Image>(raymarchColor);
+    VkExtent3D cloudsDispatchSize = raymarchTarget->getExtent();
+
+    // Rays are generated for the ray-march target, not the window
+    uniform.resX = static_cast<float>(cloudsDispatchSize.width);
+    uniform.resY = static_cast<float>(cloudsDispatchSize.height);
+    uniform.tileSize = temporal ? CLOUDS_TEMPORAL_TILE_SIZE : CLOUDS_TILE_SIZE;
+    uniform.weatherBlend = weather->getBlend();
+
+    // Reprojection data, history is dropped whenever the temporal mode is switched off
+    const HmckMat4 viewProj = uniform.proj * uniform.view;
+    historyValid = historyValid && temporal;
+    uniform.historyValid = historyValid ? 1 : 0;
+    uniform.previousViewProj = historyValid ? previousViewProj : viewProj;
+    // Clouds are sampled at p + wind * time, so the same cloud was at p + wind * dt in the previous frame
+    const HmckVec3 wind = HmckLenSqrV3(uniform.windDirection.XYZ) > 0.0f
+                              ? HmckNorm(uniform.windDirection.XYZ)
+                              : HmckVec3{};
+    uniform.windOffset = HmckVec4{wind * properties.cloudSpeed * (uniform.time - previousTime), 0.0f};
+    const bool rebuildLightVolume = updateLightVolume(wind);
+    const bool rebuildShadowMap = updateShadowMap(wind);
+    const uint32_t farFieldFaces = updateFarField();
+
+    // Update buffer
+    resourceManager.getResource<Buffer>(uniformBuffers[frameIndex])->writeToBuffer(&uniform);
 
     // Storage image do not change layout from VK_IMAGE_LAYOUT_GENERAL the entire frame, so no need for layout transition
 
@@ -27,22 +100,402 @@ void CloudsPass::recordCommands(VkCommandBuffer commandBuffer, uint32_t frameInd
 
     profiler.writeTimestamp(commandBuffer, 2, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
 
-    // Bind descriptor set
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->pipelineLayout, 0, 1,
+    ComputePipeline *cloudsPipeline = temporal ? variant.temporalPipeline.get() : variant.pipeline.get();
+
+    // Bind descriptor set, shared by all the cloud pipelines
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cloudsPipeline->pipelineLayout, 0, 1,
                             &descriptors[frameIndex], 0, nullptr);
 
+    if (rebuildLightVolume) {
+        recordLightVolume(commandBuffer, variant.lightVolumePipeline.get());
+    }
+    if (rebuildShadowMap) {
+        recordShadowMap(commandBuffer);
+    }
+    if (farFieldFaces > 0) {
+        recordFarField(commandBuffer, variant.farFieldPipeline.get(), farFieldFaces);
+    }
+    const bool tiled = properties.tileClassification == 1;
+    if (tiled) {
+        recordTileClassification(commandBuffer);
+    }
+
     // Bind the cloud pipeline
-    pipeline->bind(commandBuffer);
+    cloudsPipeline->bind(commandBuffer);
 
     // Push data
-    vkCmdPushConstants(commandBuffer, pipeline->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+    vkCmdPushConstants(commandBuffer, cloudsPipeline->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
                        0, sizeof(CloudsPushConstantData), &properties);
 
 
     // Record the first dispatch that performs the raymarching and writes clouds and occlusion mask
-    vkCmdDispatch(commandBuffer, CLOUDS_GROUPS_X(cloudsDispatchSize.width), CLOUDS_GROUPS_Y(cloudsDispatchSize.height), 1);
+    if (tiled) {
+        // One group per full tile, the tile size follows the mode
+        vkCmdDispatchIndirect(commandBuffer, resourceManager.getResource<Buffer>(tileLists)->getBuffer(),
+                              CLOUDS_TILE_DISPATCH_OFFSET(CLOUDS_TILE_FULL));
+        recordTileFill(commandBuffer);
+    } else if (temporal) {
+        vkCmdDispatch(commandBuffer, CLOUDS_TEMPORAL_GROUPS(cloudsDispatchSize.width),
+                      CLOUDS_TEMPORAL_GROUPS(cloudsDispatchSize.height), 1);
+    } else {
+        vkCmdDispatch(commandBuffer, CLOUDS_GROUPS_X(cloudsDispatchSize.width),
+                      CLOUDS_GROUPS_Y(cloudsDispatchSize.height), 1);
+    }
+
+    // Ray-march target is read by the upsample and the history copy
+    if (renderScale > 1 || temporal) {
+        raymarchTarget->pipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_COPY_BIT,
+            VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_TRANSFER_READ_BIT,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED
+        );
+    }
+    if (renderScale > 1) {
+        recordUpsample(commandBuffer);
+    }
+    if (temporal) {
+        recordHistoryCopy(commandBuffer);
+    }
+    if (renderScale > 1 || temporal) {
+        // Next frame ray-marches into the target only once it is read, the color target is then released to the
+        // graphics queue
+        raymarchTarget->pipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_COPY_BIT,
+            VK_ACCESS_2_NONE,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_NONE,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED
+        );
+    }
 
     profiler.writeTimestamp(commandBuffer, 3, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+
+    previousViewProj = viewProj;
+    previousTime = uniform.time;
+    historyValid = temporal;
+}
+
+float CloudsPass::getWeatherBlendStep() const {
+    return std::floor(uniform.weatherBlend * CLOUDS_WEATHER_BLEND_STEPS) / CLOUDS_WEATHER_BLEND_STEPS;
+}
+
+bool CloudsPass::updateLightVolume(const HmckVec3 &wind) {
+    // Clouds drifted with the wind since the volume was built, so the volume has to be looked up further upwind
+    const HmckVec3 drift = wind * properties.cloudSpeed * (uniform.time - lightVolumeTime);
+    const HmckVec3 extent{CLOUDS_LIGHT_VOLUME_EXTENT, 0.0f, CLOUDS_LIGHT_VOLUME_EXTENT};
+
+    std::vector<float> inputs;
+    inputs.insert(inputs.end(), uniform.lightDirection.Elements, uniform.lightDirection.Elements + 3);
+    inputs.insert(inputs.end(), wind.Elements, wind.Elements + 3);
+    inputs.insert(inputs.end(), {
+                      properties.cloudSpeed, properties.anvilBias, properties.globalDensity,
+                      properties.globalCoverage, properties.baseMultiplier, properties.baseScale,
+                      properties.absorption, static_cast<float>(properties.DEBUG_maxLightSamples),
+                      getWeatherBlendStep()
+                  });
+
+    bool rebuild = properties.lightVolume == 1 && inputs != lightVolumeInputs;
+    if (!rebuild && properties.lightVolume == 1) {
+        const HmckVec3 center = lightVolumeOrigin - drift + extent * 0.5f;
+        const float dx = uniform.cameraPosition.X - center.X;
+        const float dz = uniform.cameraPosition.Z - center.Z;
+        rebuild = std::max(std::abs(dx), std::abs(dz)) > CLOUDS_LIGHT_VOLUME_RECENTER_DISTANCE *
+                  CLOUDS_LIGHT_VOLUME_EXTENT;
+    }
+
+    if (rebuild) {
+        lightVolumeInputs = std::move(inputs);
+        lightVolumeOrigin = HmckVec3{uniform.cameraPosition.X, 0.0f, uniform.cameraPosition.Z} - extent * 0.5f;
+        lightVolumeTime = uniform.time;
+        uniform.lightVolumeOrigin = HmckVec4{lightVolumeOrigin, 0.0f};
+    } else {
+        uniform.lightVolumeOrigin = HmckVec4{lightVolumeOrigin - drift, 0.0f};
+    }
+    uniform.lightVolumeExtent = HmckVec4{extent, 0.0f};
+    return rebuild;
+}
+
+void CloudsPass::recordLightVolume(VkCommandBuffer commandBuffer, ComputePipeline *lightVolumePipeline) {
+    Image *lightVolumeImage = resourceManager.getResource<Image>(lightVolume);
+
+    // Previous frame may still be reading the volume
+    lightVolumeImage->pipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_READ_BIT,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED
+    );
+
+    lightVolumePipeline->bind(commandBuffer);
+    vkCmdPushConstants(commandBuffer, lightVolumePipeline->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                       0, sizeof(CloudsPushConstantData), &properties);
+    vkCmdDispatch(commandBuffer,
+                  GROUPS_COUNT(CLOUDS_LIGHT_VOLUME_SIZE_XZ, CLOUDS_LIGHT_VOLUME_WORK_GROUP_SIZE_XZ),
+                  GROUPS_COUNT(CLOUDS_LIGHT_VOLUME_SIZE_Y, CLOUDS_LIGHT_VOLUME_WORK_GROUP_SIZE_Y),
+                  GROUPS_COUNT(CLOUDS_LIGHT_VOLUME_SIZE_XZ, CLOUDS_LIGHT_VOLUME_WORK_GROUP_SIZE_XZ));
+
+    lightVolumeImage->pipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_READ_BIT,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED
+    );
+}
+
+bool CloudsPass::updateShadowMap(const HmckVec3 &wind) {
+    const HmckVec3 extent{CLOUDS_SHADOW_MAP_EXTENT, 0.0f, CLOUDS_SHADOW_MAP_EXTENT};
+    // Shadows around the camera are cast by the clouds the sun shines through above it
+    const HmckVec3 sunDirection = HmckNorm(uniform.lightDirection.XYZ);
+    const HmckVec2 above = projectOnCloudBase(uniform.cameraPosition.XYZ, sunDirection);
+
+    std::vector<float> inputs;
+    inputs.insert(inputs.end(), uniform.lightDirection.Elements, uniform.lightDirection.Elements + 3);
+    inputs.insert(inputs.end(), wind.Elements, wind.Elements + 3);
+    inputs.insert(inputs.end(), {
+                      properties.cloudSpeed, properties.anvilBias, properties.globalDensity,
+                      properties.globalCoverage, properties.baseMultiplier, properties.baseScale,
+                      properties.absorption, getWeatherBlendStep()
+                  });
+
+    // Sun below the horizon casts no cloud shadows
+    const bool enabled = cloudShadows && sunDirection.Y > 0.0f;
+    bool rebuild = enabled && inputs != shadowMapInputs;
+    if (!rebuild && enabled) {
+        const HmckVec3 drift = wind * properties.cloudSpeed * (uniform.time - shadowMapTime);
+        const HmckVec3 center = shadowMapOrigin - drift + extent * 0.5f;
+        rebuild = std::max(std::abs(above.X - center.X), std::abs(above.Y - center.Z)) >
+                  CLOUDS_SHADOW_MAP_RECENTER_DISTANCE * CLOUDS_SHADOW_MAP_EXTENT;
+    }
+
+    CloudShadowData &shadow = uniform.cloudShadow;
+    if (rebuild) {
+        shadowMapInputs = std::move(inputs);
+        shadowMapOrigin = HmckVec3{above.X, 0.0f, above.Y} - extent * 0.5f;
+        shadowMapTime = uniform.time;
+        shadow.generation++;
+    }
+    // Same as the light volume, the map is looked up further upwind the longer ago it was built
+    const HmckVec3 drift = wind * properties.cloudSpeed * (uniform.time - shadowMapTime);
+    shadow.origin = HmckVec4{shadowMapOrigin - drift, 0.0f};
+    shadow.extent = CLOUDS_SHADOW_MAP_EXTENT;
+    shadow.valid = enabled && !shadowMapInputs.empty() ? 1 : 0;
+    return rebuild;
+}
+
+void CloudsPass::recordShadowMap(VkCommandBuffer commandBuffer) {
+    Image *shadowMapImage = resourceManager.getResource<Image>(shadowMap);
+
+    // Previous frame may still be reading the map on this queue, graphics queue reads finished before the clouds
+    // command buffer started
+    shadowMapImage->pipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_READ_BIT,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED
+    );
+
+    shadowMapPipeline->bind(commandBuffer);
+    vkCmdPushConstants(commandBuffer, shadowMapPipeline->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                       0, sizeof(CloudsPushConstantData), &properties);
+    vkCmdDispatch(commandBuffer, GROUPS_COUNT(CLOUDS_SHADOW_MAP_SIZE, CLOUDS_SHADOW_MAP_WORK_GROUP_SIZE),
+                  GROUPS_COUNT(CLOUDS_SHADOW_MAP_SIZE, CLOUDS_SHADOW_MAP_WORK_GROUP_SIZE), 1);
+
+    // Aerial perspective reads the map later on this queue, graphics queue waits for the clouds semaphore
+    shadowMapImage->pipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_READ_BIT,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED
+    );
+}
+
+uint32_t CloudsPass::updateFarField() {
+    if (properties.farField != 1) {
+        farFieldValid = false;
+        return 0;
+    }
+
+    // Faces are refreshed around the camera, parallax of the far clouds is negligible until the camera moves far.
+    // A new distance is picked up by the faces as they are refreshed, so dragging the slider does not rebuild all of
+    // them every frame. Each face keeps the distance it was rendered with for the near march that is composited with it.
+    const float moved = HmckLenV3(uniform.cameraPosition.XYZ - farFieldOrigin);
+    if (!farFieldValid || moved > CLOUDS_FAR_FIELD_RECENTER_DISTANCE * properties.farFieldDistance) {
+        farFieldValid = true;
+        farFieldOrigin = uniform.cameraPosition.XYZ;
+        farFieldFace = 0;
+        uniform.farFieldFace = 0;
+        for (uint32_t face = 0; face < CLOUDS_FAR_FIELD_FACES; face++) {
+            uniform.farFieldDistances[face / 4][face % 4] = properties.farFieldDistance;
+        }
+        return CLOUDS_FAR_FIELD_FACES;
+    }
+
+    uniform.farFieldFace = static_cast<int>(farFieldFace);
+    uniform.farFieldDistances[farFieldFace / 4][farFieldFace % 4] = properties.farFieldDistance;
+    farFieldFace = (farFieldFace + 1) % CLOUDS_FAR_FIELD_FACES;
+    return 1;
+}
+
+void CloudsPass::recordFarField(VkCommandBuffer commandBuffer, ComputePipeline *farFieldPipeline, uint32_t faceCount) {
+    Image *farFieldImage = resourceManager.getResource<Image>(farField);
+
+    // Previous frame may still be reading the impostor
+    farFieldImage->pipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_READ_BIT,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED
+    );
+
+    farFieldPipeline->bind(commandBuffer);
+    vkCmdPushConstants(commandBuffer, farFieldPipeline->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                       0, sizeof(CloudsPushConstantData), &properties);
+    vkCmdDispatch(commandBuffer, GROUPS_COUNT(CLOUDS_FAR_FIELD_SIZE, CLOUDS_FAR_FIELD_WORK_GROUP_SIZE),
+                  GROUPS_COUNT(CLOUDS_FAR_FIELD_SIZE, CLOUDS_FAR_FIELD_WORK_GROUP_SIZE), faceCount);
+
+    farFieldImage->pipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_READ_BIT,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED
+    );
+}
+
+void CloudsPass::recordTileClassification(VkCommandBuffer commandBuffer) {
+    VkBuffer buffer = resourceManager.getResource<Buffer>(tileLists)->getBuffer();
+    const VkExtent3D extent = resourceManager.getResource<Image>(raymarchColor)->getExtent();
+    const uint32_t tileSize = static_cast<uint32_t>(uniform.tileSize);
+
+    // Previous frame may still be dispatching from the lists
+    tileListsBarrier(commandBuffer, buffer,
+                     VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_NONE,
+                     VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+
+    // Empty lists, each dispatch is one group high and deep
+    const std::array<uint32_t, CLOUDS_TILE_LIST_HEADER_SIZE> header = {0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0};
+    vkCmdUpdateBuffer(commandBuffer, buffer, 0, sizeof(header), header.data());
+
+    tileListsBarrier(commandBuffer, buffer,
+                     VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                     VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                     VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+    classifyTilesPipeline->bind(commandBuffer);
+    vkCmdPushConstants(commandBuffer, classifyTilesPipeline->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                       0, sizeof(CloudsPushConstantData), &properties);
+    vkCmdDispatch(commandBuffer, GROUPS_COUNT(extent.width, tileSize), GROUPS_COUNT(extent.height, tileSize), 1);
+
+    // Counts are read as the group counts of the indirect dispatches, the lists by the groups themselves
+    tileListsBarrier(commandBuffer, buffer,
+                     VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                     VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                     VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+}
+
+void CloudsPass::recordTileFill(VkCommandBuffer commandBuffer) {
+    VkBuffer buffer = resourceManager.getResource<Buffer>(tileLists)->getBuffer();
+
+    fillOccludedTilesPipeline->bind(commandBuffer);
+    vkCmdPushConstants(commandBuffer, fillOccludedTilesPipeline->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                       0, sizeof(CloudsPushConstantData), &properties);
+    vkCmdDispatchIndirect(commandBuffer, buffer, CLOUDS_TILE_DISPATCH_OFFSET(CLOUDS_TILE_OCCLUDED));
+
+    fillEmptyTilesPipeline->bind(commandBuffer);
+    vkCmdPushConstants(commandBuffer, fillEmptyTilesPipeline->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                       0, sizeof(CloudsPushConstantData), &properties);
+    vkCmdDispatchIndirect(commandBuffer, buffer, CLOUDS_TILE_DISPATCH_OFFSET(CLOUDS_TILE_EMPTY));
+}
+
+void CloudsPass::recordHistoryCopy(VkCommandBuffer commandBuffer) {
+    Image *raymarchTarget = resourceManager.getResource<Image>(raymarchColor);
+    Image *historyImage = resourceManager.getResource<Image>(history);
+
+    // Both images stay in general layout, only the accesses are ordered
+    historyImage->pipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_READ_BIT,
+        VK_PIPELINE_STAGE_2_COPY_BIT,
+        VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED
+    );
+
+    const VkExtent3D imageExtent = raymarchTarget->getExtent();
+    VkImageCopy region{
+        .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .srcOffset = {0, 0, 0},
+        .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .dstOffset = {0, 0, 0},
+        .extent = imageExtent,
+    };
+    vkCmdCopyImage(commandBuffer, raymarchTarget->getImage(), VK_IMAGE_LAYOUT_GENERAL, historyImage->getImage(),
+                   VK_IMAGE_LAYOUT_GENERAL, 1, &region);
+
+    // Next frame reads the history
+    historyImage->pipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_2_COPY_BIT,
+        VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_READ_BIT,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED
+    );
+}
+
+void CloudsPass::recordUpsample(VkCommandBuffer commandBuffer) {
+    VkExtent3D imageExtent = resourceManager.getResource<Image>(color)->getExtent();
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, upsamplePipeline->pipelineLayout, 0, 1,
+                            &upsampleDescriptor, 0, nullptr);
+    upsamplePipeline->bind(commandBuffer);
+    vkCmdDispatch(commandBuffer, GROUPS_COUNT(imageExtent.width, CLOUDS_UPSAMPLE_WORK_GROUP_SIZE),
+                  GROUPS_COUNT(imageExtent.height, CLOUDS_UPSAMPLE_WORK_GROUP_SIZE), 1);
 }
 
 void CloudsPass::prepareBuffers() {
@@ -65,38 +518,37 @@ void CloudsPass::prepareBuffers() {
 }
 
 void CloudsPass::prepareResources() {
-    int w, h, c, d;
+    int w, h, c;
+    // Noise volumes are generated on the compute queue, or restored from the cache
+    CloudNoiseGenerator noiseGenerator(device, resourceManager, noiseParameters, noiseCacheDirectory);
     // Low frequency noise
     {
-        // Read the data from disk
-        AutoDelete lowFreqNoiseData(readVolume(Filesystem::ls(ASSET_PATH("base")), w, h, c, d,
-                                               Filesystem::ImageFormat::R16G16B16A16_SFLOAT), [](const void *p) {
-            delete[] static_cast<const float16_t *>(p);
-        });
+        const std::vector<uint8_t> noise = noiseGenerator.generateBase();
+        const uint32_t size = noiseParameters.baseSize;
         // Create staging buffer
         ResourceHandle lowFreqNoiseStagingBuffer = queueForDeletion(resourceManager.createResource<Buffer>(
             "base-noise-staging-buffer",
             BufferDesc{
-                .instanceSize = sizeof(float16_t),
-                .instanceCount = static_cast<uint32_t>(w * h * d * c),
+                .instanceSize = sizeof(uint8_t),
+                .instanceCount = static_cast<uint32_t>(noise.size()),
                 .usageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                 .allocationFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
             }
         ));
         // Write data to the buffer
         resourceManager.getResource<Buffer>(lowFreqNoiseStagingBuffer)->map();
-        resourceManager.getResource<Buffer>(lowFreqNoiseStagingBuffer)->writeToBuffer(lowFreqNoiseData.get());
+        resourceManager.getResource<Buffer>(lowFreqNoiseStagingBuffer)->writeToBuffer(noise.data());
 
         // Create the actual image resource
         lowFrequencyNoise = resourceManager.createResource<Image>(
             "base-noise",
             ImageDesc{
-                .width = static_cast<uint32_t>(w),
-                .height = static_cast<uint32_t>(h),
-                .channels = static_cast<uint32_t>(c),
-                .depth = static_cast<uint32_t>(d),
-                .mips = getNumberOfMipLevels(static_cast<uint32_t>(w), static_cast<uint32_t>(h)),
-                .format = VK_FORMAT_R16G16B16A16_SFLOAT,
+                .width = size,
+                .height = size,
+                .channels = 2,
+                .depth = size,
+                .mips = getNumberOfMipLevels(size, size),
+                .format = VK_FORMAT_R8G8_UNORM,
                 .usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                 .imageType = VK_IMAGE_TYPE_3D,
                 .imageViewType = VK_IMAGE_VIEW_TYPE_3D,
@@ -112,17 +564,14 @@ void CloudsPass::prepareResources() {
     }
     // High frequency noise
     {
-        // Read the data from disk
-        AutoDelete highFrequencyNoiseData(readVolume(Filesystem::ls(ASSET_PATH("detail")), w, h, c, d,
-                                                     Filesystem::ImageFormat::R16G16B16A16_SFLOAT), [](const void *p) {
-            delete[] static_cast<const float16_t *>(p);
-        });
+        const std::vector<uint8_t> noise = noiseGenerator.generateDetail();
+        const uint32_t size = noiseParameters.detailSize;
         // Create staging buffer
         ResourceHandle highFrequencyNoiseStagingBuffer = queueForDeletion(resourceManager.createResource<Buffer>(
             "detail-noise-staging-buffer",
             BufferDesc{
-                .instanceSize = sizeof(float16_t),
-                .instanceCount = static_cast<uint32_t>(w * h * d * c),
+                .instanceSize = sizeof(uint8_t),
+                .instanceCount = static_cast<uint32_t>(noise.size()),
                 .usageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                 .allocationFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
             }
@@ -130,19 +579,18 @@ void CloudsPass::prepareResources() {
 
         // Write data to the buffer
         resourceManager.getResource<Buffer>(highFrequencyNoiseStagingBuffer)->map();
-        resourceManager.getResource<Buffer>(highFrequencyNoiseStagingBuffer)->writeToBuffer(highFrequencyNoiseData.get());
+        resourceManager.getResource<Buffer>(highFrequencyNoiseStagingBuffer)->writeToBuffer(noise.data());
 
         // Create the actual image resource
         highFrequencyNoise = resourceManager.createResource<Image>(
             "detail-noise",
             ImageDesc{
-                .width = static_cast<uint32_t>(w),
-                .height = static_cast<uint32_t>(h),
-                .channels = static_cast<uint32_t>(c),
-                .depth = static_cast<uint32_t>(d),
-                .mips = getNumberOfMipLevels(static_cast<uint32_t>(w), static_cast<uint32_t>(h)),
-                .format = VK_FORMAT_R16G16B16A16_SFLOAT,
-                // We only use RGB channels but most devices do not support 3D RGB textures so we use RGBA
+                .width = size,
+                .height = size,
+                .channels = 1,
+                .depth = size,
+                .mips = getNumberOfMipLevels(size, size),
+                .format = VK_FORMAT_R8_UNORM,
                 .usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                 .imageType = VK_IMAGE_TYPE_3D,
                 .imageViewType = VK_IMAGE_VIEW_TYPE_3D,
@@ -156,59 +604,8 @@ void CloudsPass::prepareResources() {
         resourceManager.getResource<Image>(highFrequencyNoise)->generateMips();
         resourceManager.getResource<Image>(highFrequencyNoise)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     }
-    // Weather map
-    {
-        std::string weatherMapName = ASSET_PATH("weather/stratocumulus.png");
-        if(weatherMapEnum == WeatherMap::Stratus) {
-            weatherMapName = ASSET_PATH("weather/stratus.png");
-        } else if(weatherMapEnum == WeatherMap::Stratocumulus) {
-            weatherMapName = ASSET_PATH("weather/stratocumulus.png");
-        } else if(weatherMapEnum == WeatherMap::Cumulus) {
-            weatherMapName = ASSET_PATH("weather/cumulus.png");
-        } else if(weatherMapEnum == WeatherMap::Nubis) {
-            weatherMapName = ASSET_PATH("weather/nubis.png");
-        }
-
-        AutoDelete weatherMapData(readImage(weatherMapName, w, h, c,
-                                            Filesystem::ImageFormat::R8G8B8A8_UNORM), [](const void *p) {
-            delete[] static_cast<const uchar8_t *>(p);
-        });
-
-        // Create host visible staging buffer on device
-        ResourceHandle weatherMapStagingBuffer = queueForDeletion(resourceManager.createResource<Buffer>(
-            "weather-staging-buffer",
-            BufferDesc{
-                .instanceSize = sizeof(uchar8_t),
-                .instanceCount = static_cast<uint32_t>(w * h * c),
-                .usageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                .allocationFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
-            }
-        ));
-
-        // Write the data into the staging buffer
-        resourceManager.getResource<Buffer>(weatherMapStagingBuffer)->map();
-        resourceManager.getResource<Buffer>(weatherMapStagingBuffer)->writeToBuffer(weatherMapData.get());
-
-        // Create the image resource
-        weatherMap = resourceManager.createResource<Image>(
-            "weather-map",
-            ImageDesc{
-                .width = static_cast<uint32_t>(w),
-                .height = static_cast<uint32_t>(h),
-                .channels = static_cast<uint32_t>(c),
-                .format = VK_FORMAT_R8G8B8A8_UNORM,
-                .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                .imageType = VK_IMAGE_TYPE_2D,
-                .imageViewType = VK_IMAGE_VIEW_TYPE_2D,
-            }
-        );
-
-        // Copy the data from buffer into the image
-        resourceManager.getResource<Image>(weatherMap)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        resourceManager.getResource<Image>(weatherMap)->queueCopyFromBuffer(
-            resourceManager.getResource<Buffer>(weatherMapStagingBuffer)->getBuffer());
-        resourceManager.getResource<Image>(weatherMap)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    }
+    // Weather maps, the first one is loaded here and the others are streamed when switched to
+    weather = std::make_unique<WeatherSystem>(device, resourceManager, weatherMapEnum);
     // Curl noise
     {
         AutoDelete curlNoiseData(readImage(ASSET_PATH("curlNoise.png"), w, h, c,
@@ -260,7 +657,7 @@ void CloudsPass::prepareTargets(uint32_t width, uint32_t height) {
             .height = height,
             .channels = 4,
             .format = VK_FORMAT_R16G16B16A16_SFLOAT,
-            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
             .imageType = VK_IMAGE_TYPE_2D,
             .imageViewType = VK_IMAGE_VIEW_TYPE_2D,
             .currentQueueFamily = CommandQueueFamily::Compute,
@@ -271,6 +668,104 @@ void CloudsPass::prepareTargets(uint32_t width, uint32_t height) {
     // Set initial layout
     resourceManager.getResource<Image>(color)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_GENERAL);
 
+    // Reduced resolution ray-march target never leaves the compute queue
+    const uint32_t raymarchWidth = std::max(width / renderScale, 1u);
+    const uint32_t raymarchHeight = std::max(height / renderScale, 1u);
+    raymarchColor = color;
+    if (renderScale > 1) {
+        raymarchColor = resourceManager.createResource<Image>(
+            "clouds-raymarch-image", ImageDesc{
+                .width = raymarchWidth,
+                .height = raymarchHeight,
+                .channels = 4,
+                .format = VK_FORMAT_R16G16B16A16_SFLOAT,
+                .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                .imageType = VK_IMAGE_TYPE_2D,
+                .imageViewType = VK_IMAGE_VIEW_TYPE_2D,
+            }
+        );
+        resourceManager.getResource<Image>(raymarchColor)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_GENERAL);
+    }
+
+    // History never leaves the compute queue
+    history = resourceManager.createResource<Image>(
+        "clouds-history-image", ImageDesc{
+            .width = raymarchWidth,
+            .height = raymarchHeight,
+            .channels = 4,
+            .format = VK_FORMAT_R16G16B16A16_SFLOAT,
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .imageViewType = VK_IMAGE_VIEW_TYPE_2D,
+        }
+    );
+    resourceManager.getResource<Image>(history)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_GENERAL);
+
+    // Tile lists never leave the compute queue
+    const uint32_t tileListCapacity = GROUPS_COUNT(raymarchWidth, CLOUDS_TILE_SIZE) *
+                                      GROUPS_COUNT(raymarchHeight, CLOUDS_TILE_SIZE);
+    tileLists = resourceManager.createResource<Buffer>(
+        "clouds-tile-lists", BufferDesc{
+            .instanceSize = sizeof(uint32_t),
+            .instanceCount = CLOUDS_TILE_LIST_HEADER_SIZE + CLOUDS_TILE_CLASS_COUNT * tileListCapacity,
+            .usageFlags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                          VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        }
+    );
+
+    // Light volume never leaves the compute queue
+    lightVolume = resourceManager.createResource<Image>(
+        "clouds-light-volume", ImageDesc{
+            .width = CLOUDS_LIGHT_VOLUME_SIZE_XZ,
+            .height = CLOUDS_LIGHT_VOLUME_SIZE_Y,
+            .channels = 1,
+            .depth = CLOUDS_LIGHT_VOLUME_SIZE_XZ,
+            .format = VK_FORMAT_R16_SFLOAT,
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+            .imageType = VK_IMAGE_TYPE_3D,
+            .imageViewType = VK_IMAGE_VIEW_TYPE_3D,
+        }
+    );
+    resourceManager.getResource<Image>(lightVolume)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_GENERAL);
+
+    // Far-field impostor never leaves the compute queue either, faces are layers so that they can be written
+    farField = resourceManager.createResource<Image>(
+        "clouds-far-field", ImageDesc{
+            .width = CLOUDS_FAR_FIELD_SIZE,
+            .height = CLOUDS_FAR_FIELD_SIZE,
+            .channels = 4,
+            .layers = CLOUDS_FAR_FIELD_FACES,
+            .format = VK_FORMAT_R16G16B16A16_SFLOAT,
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .imageViewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+        }
+    );
+    resourceManager.getResource<Image>(farField)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_GENERAL);
+    // Clamped so that the face edges do not wrap around to the opposite edge
+    farFieldSampler = resourceManager.createResource<Sampler>("clouds-far-field-sampler", SamplerDesc{
+                                                                  .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                  .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                  .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                              });
+
+    // Cloud shadow map is read by both queues, concurrent sharing spares the ownership transfers
+    shadowMap = resourceManager.createResource<Image>(
+        "clouds-shadow-map", ImageDesc{
+            .width = CLOUDS_SHADOW_MAP_SIZE,
+            .height = CLOUDS_SHADOW_MAP_SIZE,
+            .channels = 1,
+            .format = VK_FORMAT_R16_SFLOAT,
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .imageViewType = VK_IMAGE_VIEW_TYPE_2D,
+            .currentQueueFamily = CommandQueueFamily::Compute,
+            .queueFamilies = {CommandQueueFamily::Compute, CommandQueueFamily::Graphics},
+            .sharingMode = VK_SHARING_MODE_CONCURRENT,
+        }
+    );
+    resourceManager.getResource<Image>(shadowMap)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_GENERAL);
+
     sampler = resourceManager.createResource<Sampler>("clouds-sampler", SamplerDesc{});
 }
 
@@ -284,21 +779,50 @@ void CloudsPass::prepareDescriptors() {
             .addBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // weather map
             .addBinding(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Curl
             .addBinding(6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Camera depth
+            .addBinding(7, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // History
+            .addBinding(8, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Coverage distance
+            .addBinding(9, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT) // Light volume
+            .addBinding(10, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Light volume
+            .addBinding(11, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT) // Cloud shadow map
+            .addBinding(12, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Tile lists
+            .addBinding(13, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Second weather map
+            .addBinding(14, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Second coverage distance
+            .addBinding(15, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT) // Far field
+            .addBinding(16, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Far field
+            .addBinding(17, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Blue noise
             .build();
 
     // Default sampler
     Sampler *s = resourceManager.getResource<Sampler>(sampler);
-    VkDescriptorImageInfo cloudsImageInfo = resourceManager.getResource<Image>(color)->getDescriptorImageInfo(
+    VkDescriptorImageInfo cloudsImageInfo = resourceManager.getResource<Image>(raymarchColor)->getDescriptorImageInfo(
         s->getSampler());
     VkDescriptorImageInfo lowFreqNoiseInfo = resourceManager.getResource<Image>(lowFrequencyNoise)->getDescriptorImageInfo(
         s->getSampler());
     VkDescriptorImageInfo highFreqNoiseInfo = resourceManager.getResource<Image>(highFrequencyNoise)->getDescriptorImageInfo(
         s->getSampler());
-    VkDescriptorImageInfo weatherMapInfo = resourceManager.getResource<Image>(weatherMap)->getDescriptorImageInfo(
+    // Both weather slots stay bound, streaming a map only changes their contents
+    VkDescriptorImageInfo weatherMapInfo = weather->getWeatherMapImage(0)->getDescriptorImageInfo(s->getSampler());
+    VkDescriptorImageInfo secondWeatherMapInfo = weather->getWeatherMapImage(1)->getDescriptorImageInfo(
         s->getSampler());
     VkDescriptorImageInfo curlNoiseInfo = resourceManager.getResource<Image>(curlNoise)->getDescriptorImageInfo(
         s->getSampler());
     VkDescriptorImageInfo cameraDepthInfo = cameraDepth->getDescriptorImageInfo(s->getSampler());
+    VkDescriptorImageInfo blueNoiseInfo = blueNoise->getDescriptorImageInfo(s->getSampler());
+    VkDescriptorImageInfo historyInfo = resourceManager.getResource<Image>(history)->getDescriptorImageInfo(
+        s->getSampler());
+    VkDescriptorImageInfo coverageDistanceInfo = weather->getCoverageDistanceImage(0)->getDescriptorImageInfo(
+        s->getSampler());
+    VkDescriptorImageInfo secondCoverageDistanceInfo = weather->getCoverageDistanceImage(1)->getDescriptorImageInfo(
+        s->getSampler());
+    VkDescriptorImageInfo lightVolumeInfo = resourceManager.getResource<Image>(lightVolume)->getDescriptorImageInfo(
+        s->getSampler());
+    VkDescriptorImageInfo shadowMapInfo = resourceManager.getResource<Image>(shadowMap)->getDescriptorImageInfo(
+        s->getSampler());
+
+    VkDescriptorImageInfo farFieldInfo = resourceManager.getResource<Image>(farField)->getDescriptorImageInfo(
+        resourceManager.getResource<Sampler>(farFieldSampler)->getSampler());
+
+    VkDescriptorBufferInfo tileListsInfo = resourceManager.getResource<Buffer>(tileLists)->descriptorInfo();
 
     // global descriptor set
     for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
@@ -311,18 +835,171 @@ void CloudsPass::prepareDescriptors() {
                 .writeImage(4, &weatherMapInfo)
                 .writeImage(5, &curlNoiseInfo)
                 .writeImage(6, &cameraDepthInfo)
+                .writeImage(7, &historyInfo)
+                .writeImage(8, &coverageDistanceInfo)
+                .writeImage(9, &lightVolumeInfo)
+                .writeImage(10, &lightVolumeInfo)
+                .writeImage(11, &shadowMapInfo)
+                .writeBuffer(12, &tileListsInfo)
+                .writeImage(13, &secondWeatherMapInfo)
+                .writeImage(14, &secondCoverageDistanceInfo)
+                .writeImage(15, &farFieldInfo)
+                .writeImage(16, &farFieldInfo)
+                .writeImage(17, &blueNoiseInfo)
                 .build(descriptors[i]);
     }
+
+    // Upsample
+    upsampleLayout = DescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Ray-marched clouds
+            .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Camera depth
+            .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT) // Clouds image
+            .build();
+    VkDescriptorImageInfo colorInfo = resourceManager.getResource<Image>(color)->getDescriptorImageInfo(
+        s->getSampler());
+    DescriptorWriter(*upsampleLayout, *descriptorPool)
+            .writeImage(0, &cloudsImageInfo)
+            .writeImage(1, &cameraDepthInfo)
+            .writeImage(2, &colorInfo)
+            .build(upsampleDescriptor);
 }
 
 void CloudsPass::preparePipelines() {
-    pipeline = ComputePipeline::create({
-        .debugName = "clouds-compute-pipeline",
+    // Default quality is ready before the first frame, the others are created when switched to
+    getPipelineVariant(quality);
+    getPipelineVariant(CloudQuality::Custom);
+
+    shadowMapPipeline = ComputePipeline::create({
+        .debugName = "clouds-shadow-map-compute-pipeline",
         .device = device,
-        .computeShader{.byteCode = Filesystem::readFile(COMPILED_SHADER_PATH(CLOUDS_SHADER_NAME)),},
+        .computeShader{.byteCode = Filesystem::readFile(COMPILED_SHADER_PATH("cloudsshadowmap.comp")),},
+        .descriptorSetLayouts = {
+            layout->getDescriptorSetLayout()
+        },
+        .pushConstantRanges{{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CloudsPushConstantData)}}
+    });
+
+    // Classification and the fills only depend on the push constants, they are shared by every quality
+    classifyTilesPipeline = ComputePipeline::create({
+        .debugName = "clouds-classify-tiles-compute-pipeline",
+        .device = device,
+        .computeShader{.byteCode = Filesystem::readFile(COMPILED_SHADER_PATH("cloudsclassifytiles.comp")),},
+        .descriptorSetLayouts = {
+            layout->getDescriptorSetLayout()
+        },
+        .pushConstantRanges{{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CloudsPushConstantData)}}
+    });
+
+    fillOccludedTilesPipeline = ComputePipeline::create({
+        .debugName = "clouds-fill-occluded-tiles-compute-pipeline",
+        .device = device,
+        .computeShader{.byteCode = Filesystem::readFile(COMPILED_SHADER_PATH("cloudsfilloccluded.comp")),},
+        .descriptorSetLayouts = {
+            layout->getDescriptorSetLayout()
+        },
+        .pushConstantRanges{{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CloudsPushConstantData)}}
+    });
+
+    fillEmptyTilesPipeline = ComputePipeline::create({
+        .debugName = "clouds-fill-empty-tiles-compute-pipeline",
+        .device = device,
+        .computeShader{.byteCode = Filesystem::readFile(COMPILED_SHADER_PATH("cloudsfillempty.comp")),},
+        .descriptorSetLayouts = {
+            layout->getDescriptorSetLayout()
+        },
+        .pushConstantRanges{{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CloudsPushConstantData)}}
+    });
+
+    upsamplePipeline = ComputePipeline::create({
+        .debugName = "clouds-upsample-compute-pipeline",
+        .device = device,
+        .computeShader{.byteCode = Filesystem::readFile(COMPILED_SHADER_PATH("cloudsupsample.comp")),},
+        .descriptorSetLayouts = {
+            upsampleLayout->getDescriptorSetLayout()
+        },
+    });
+}
+
+CloudsPass::PipelineVariant &CloudsPass::getPipelineVariant(CloudQuality variantQuality) {
+    PipelineVariant &variant = pipelineVariants[static_cast<size_t>(variantQuality)];
+    if (variant.pipeline) {
+        return variant;
+    }
+
+    // Custom quality keeps the default values of the specialization constants, which makes it read the push constants
+    const CloudsSpecializationData specialization = variantQuality == CloudQuality::Custom
+                                                        ? CloudsSpecializationData{}
+                                                        : CloudQualitySettings::fromQuality(variantQuality).
+                                                        specialization();
+    const std::vector<VkSpecializationMapEntry> mapEntries = {
+        Init::specializationMapEntry(0, offsetof(CloudsSpecializationData, specialized), sizeof(VkBool32)),
+        Init::specializationMapEntry(1, offsetof(CloudsSpecializationData, maxSamples), sizeof(int32_t)),
+        Init::specializationMapEntry(2, offsetof(CloudsSpecializationData, maxLightSamples), sizeof(int32_t)),
+        Init::specializationMapEntry(3, offsetof(CloudsSpecializationData, longStepMultiplier), sizeof(float)),
+        Init::specializationMapEntry(4, offsetof(CloudsSpecializationData, earlyTermination), sizeof(VkBool32)),
+        Init::specializationMapEntry(5, offsetof(CloudsSpecializationData, lateTermination), sizeof(VkBool32)),
+    };
+    const auto *specializationBytes = reinterpret_cast<const uint8_t *>(&specialization);
+    const std::vector<uint8_t> specializationData(specializationBytes,
+                                                  specializationBytes + sizeof(CloudsSpecializationData));
+
+    const std::string name = CloudQualitySettings::name(variantQuality);
+
+    // All variants share the layout so that the quality and the mode can be switched between frames
+    variant.pipeline = ComputePipeline::create({
+        .debugName = "clouds-" + name + "-compute-pipeline",
+        .device = device,
+        .computeShader{
+            .byteCode = Filesystem::readFile(COMPILED_SHADER_PATH("clouds.comp")),
+            .specializationMapEntries = mapEntries,
+            .specializationData = specializationData
+        },
+        .descriptorSetLayouts = {
+            layout->getDescriptorSetLayout()
+        },
+        .pushConstantRanges{{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CloudsPushConstantData)}}
+    });
+
+    variant.temporalPipeline = ComputePipeline::create({
+        .debugName = "clouds-" + name + "-temporal-compute-pipeline",
+        .device = device,
+        .computeShader{
+            .byteCode = Filesystem::readFile(COMPILED_SHADER_PATH("clouds_repr.comp")),
+            .specializationMapEntries = mapEntries,
+            .specializationData = specializationData
+        },
+        .descriptorSetLayouts = {
+            layout->getDescriptorSetLayout()
+        },
+        .pushConstantRanges{{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CloudsPushConstantData)}}
+    });
+
+    variant.lightVolumePipeline = ComputePipeline::create({
+        .debugName = "clouds-" + name + "-light-volume-compute-pipeline",
+        .device = device,
+        .computeShader{
+            .byteCode = Filesystem::readFile(COMPILED_SHADER_PATH("cloudslightvolume.comp")),
+            .specializationMapEntries = mapEntries,
+            .specializationData = specializationData
+        },
+        .descriptorSetLayouts = {
+            layout->getDescriptorSetLayout()
+        },
+        .pushConstantRanges{{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CloudsPushConstantData)}}
+    });
+
+    variant.farFieldPipeline = ComputePipeline::create({
+        .debugName = "clouds-" + name + "-far-field-compute-pipeline",
+        .device = device,
+        .computeShader{
+            .byteCode = Filesystem::readFile(COMPILED_SHADER_PATH("cloudsfarfield.comp")),
+            .specializationMapEntries = mapEntries,
+            .specializationData = specializationData
+        },
         .descriptorSetLayouts = {
             layout->getDescriptorSetLayout()
         },
         .pushConstantRanges{{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CloudsPushConstantData)}}
     });
+    return variant;
 }
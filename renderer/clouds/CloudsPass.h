@@ -1,28 +1,61 @@
 #pragma once
 #include "../IRenderGroup.h"
 #include "../Types.h"
+#include "CloudQuality.h"
+#include "CloudNoiseGenerator.h"
+#include "WeatherSystem.h"
 
 #define CLOUDS_WORK_GROUP_SIZE_X 16
 #define CLOUDS_WORK_GROUP_SIZE_Y 16
-#ifndef CLOUD_RENDER_SUBSAMPLE
 #define CLOUDS_GROUPS_X(w) ((w + CLOUDS_WORK_GROUP_SIZE_X - 1) / CLOUDS_WORK_GROUP_SIZE_X)
 #define CLOUDS_GROUPS_Y(h) ((h + CLOUDS_WORK_GROUP_SIZE_Y - 1) / CLOUDS_WORK_GROUP_SIZE_Y)
-#else
-#define CLOUDS_GROUPS_X(w) (ceil(w/4/8))
-#define CLOUDS_GROUPS_Y(h) (ceil(h/4/8))
-#endif
+// Temporal mode, each thread handles a 4x4 block of pixels and ray-marches one of them per frame
+#define CLOUDS_TEMPORAL_BLOCK_SIZE 4
+#define CLOUDS_TEMPORAL_WORK_GROUP_SIZE 8
+#define CLOUDS_TEMPORAL_GROUPS(res) GROUPS_COUNT(res, CLOUDS_TEMPORAL_BLOCK_SIZE * CLOUDS_TEMPORAL_WORK_GROUP_SIZE)
+#define CLOUDS_UPSAMPLE_WORK_GROUP_SIZE 16
+// Screen tiles are classified as occluded, empty or full before the ray-march, a tile is the footprint of one
+// ray-march work group. Lists are sized for the non-temporal tiles, which are the smaller ones.
+#define CLOUDS_TILE_SIZE CLOUDS_WORK_GROUP_SIZE_X
+#define CLOUDS_TEMPORAL_TILE_SIZE (CLOUDS_TEMPORAL_BLOCK_SIZE * CLOUDS_TEMPORAL_WORK_GROUP_SIZE)
+// Tile classes in the order of their lists, mirrors the shader
+#define CLOUDS_TILE_OCCLUDED 0
+#define CLOUDS_TILE_EMPTY 1
+#define CLOUDS_TILE_FULL 2
+#define CLOUDS_TILE_CLASS_COUNT 3
+// Dispatch indirect command of each tile list is padded to four words
+#define CLOUDS_TILE_LIST_HEADER_SIZE (CLOUDS_TILE_CLASS_COUNT * 4)
+#define CLOUDS_TILE_DISPATCH_OFFSET(tileClass) ((tileClass) * 4 * sizeof(uint32_t))
+// Sun transmittance volume around the camera, voxels in x, height fraction and z
+#define CLOUDS_LIGHT_VOLUME_SIZE_XZ 192
+#define CLOUDS_LIGHT_VOLUME_SIZE_Y 32
+#define CLOUDS_LIGHT_VOLUME_WORK_GROUP_SIZE_XZ 8
+#define CLOUDS_LIGHT_VOLUME_WORK_GROUP_SIZE_Y 4
+// World space size of the light volume, clouds further away are light-marched
+#define CLOUDS_LIGHT_VOLUME_EXTENT 60000.0f
+// Fraction of the extent the camera can drift from the center of the volume before it is rebuilt around the camera
+#define CLOUDS_LIGHT_VOLUME_RECENTER_DISTANCE 0.25f
+// Cloud layer shell, mirrors the toolbox constants
+#define CLOUDS_EARTH_RADIUS 637800.0
+#define CLOUDS_BOTTOM_RADIUS (CLOUDS_EARTH_RADIUS + 6000.0)
+// Top-down optical depth of the cloud layer along the sun direction, read by the terrain, aerial perspective and god rays
+#define CLOUDS_SHADOW_MAP_SIZE 512
+#define CLOUDS_SHADOW_MAP_WORK_GROUP_SIZE 16
+// World space size of the cloud shadow map on the cloud base, shadows outside of it are not cast
+#define CLOUDS_SHADOW_MAP_EXTENT 40000.0f
+// Fraction of the extent the point above the camera can drift from the center of the map before it is rebuilt
+#define CLOUDS_SHADOW_MAP_RECENTER_DISTANCE 0.25f
+// Clouds beyond the far-field distance are rendered into an impostor cubemap around the camera, a face per frame
+#define CLOUDS_FAR_FIELD_SIZE 512
+#define CLOUDS_FAR_FIELD_FACES 6
+#define CLOUDS_FAR_FIELD_WORK_GROUP_SIZE 16
+// Fraction of the far-field distance the camera can move before every face is refreshed at once
+#define CLOUDS_FAR_FIELD_RECENTER_DISTANCE 0.02f
+// Light volume and shadow map follow a weather transition in this many steps instead of being rebuilt every frame
+#define CLOUDS_WEATHER_BLEND_STEPS 32
 
 class CloudsPass final : public IRenderGroup {
 public:
-
-#ifdef CLOUD_RENDER_SUBSAMPLE
-#define CLOUDS_SHADER_NAME "clouds_repr.comp"
-#else
-#define CLOUDS_SHADER_NAME "clouds.comp"
-#endif
-
-
-
     CloudsPass(Device &device, ResourceManager &resourceManager, Profiler& profiler, WeatherMap weatherMap)
         : IRenderGroup(device, resourceManager, profiler), weatherMapEnum(weatherMap) {
     }
@@ -33,9 +66,39 @@ public:
     // This is passed as push data
     CloudsPushConstantData properties{};
 
+    // Ray-marches every 16th pixel per frame and reprojects the rest from the previous frame, can be toggled any frame
+#ifdef CLOUD_RENDER_SUBSAMPLE
+    bool temporal = true;
+#else
+    bool temporal = false;
+#endif
+
+    // Casts cloud shadows on the terrain, into the aerial perspective and the god rays, can be toggled any frame
+    bool cloudShadows = true;
+
+    // Ray-march settings, can be switched any frame. Presets overwrite the sampling push constants every frame.
+    CloudQuality quality = CloudQuality::Medium;
+
+    // Presets use pipelines with the settings baked in, otherwise they are pushed to the custom quality pipeline
+    bool specialized = true;
+
 
     void initialize(HmckVec2 resolution);
 
+    /**
+     * Sets the resolution the clouds are ray-marched at, has to be called before initialization. Reduced resolution
+     * clouds are upsampled to the full resolution color target guided by the camera depth.
+     * @param divisor Full resolution divided by 1, 2 or 4
+     */
+    void setRenderScale(uint32_t divisor);
+
+    uint32_t getRenderScale() const { return renderScale; }
+
+    // Seed and frequencies of the generated noise volumes, has to be set before initialization
+    void setNoiseParameters(const CloudNoiseParameters &parameters) { noiseParameters = parameters; }
+
+    // Empty directory disables the noise cache, has to be set before initialization
+    void setNoiseCacheDirectory(const std::string &directory) { noiseCacheDirectory = directory; }
 
     void setView(const HmckMat4 &view) {
         uniform.view = view;
@@ -49,8 +112,24 @@ public:
 
     void setCameraDepth(Image *image) { cameraDepth = image; }
 
+    // Shared blue noise the ray start is jittered by
+    void setBlueNoise(Image *image) { blueNoise = image; }
+
+    // Resident weather maps and the transitions between them, available after initialization
+    WeatherSystem &getWeather() const { return *weather; }
+
+    // Full resolution clouds, upsampled if the clouds are ray-marched at reduced resolution
     Image *getColorTarget() const { return resourceManager.getResource<Image>(color); }
 
+    /**
+     * Cloud shadow map is written by the compute queue and read by both queues without ownership transfers. It is
+     * complete once the clouds command buffer finished.
+     */
+    Image *getCloudShadowMap() const { return resourceManager.getResource<Image>(shadowMap); }
+
+    // Placement of the cloud shadow map in the recorded frame, consumers have to use it in the same frame
+    const CloudShadowData &getCloudShadow() const { return uniform.cloudShadow; }
+
     void recordCommands(VkCommandBuffer commandBuffer, uint32_t frameIndex) override;
 
 private:
@@ -61,31 +140,139 @@ private:
     std::unique_ptr<DescriptorSetLayout> layout;
     std::array<VkDescriptorSet, SwapChain::MAX_FRAMES_IN_FLIGHT> descriptors;
 
-    // Compute pipeline
-    std::unique_ptr<ComputePipeline> pipeline;
+    // Upsample descriptors
+    std::unique_ptr<DescriptorSetLayout> upsampleLayout;
+    VkDescriptorSet upsampleDescriptor;
+
+    // Cloud pipelines that depend on the ray-march settings
+    struct PipelineVariant {
+        std::unique_ptr<ComputePipeline> pipeline;
+        std::unique_ptr<ComputePipeline> temporalPipeline;
+        std::unique_ptr<ComputePipeline> lightVolumePipeline;
+        std::unique_ptr<ComputePipeline> farFieldPipeline;
+    };
+
+    // One variant per quality, created the first time the quality is used. Custom quality is not specialized.
+    std::array<PipelineVariant, static_cast<size_t>(CloudQuality::Custom) + 1> pipelineVariants;
+
+    // Compute pipelines
+    std::unique_ptr<ComputePipeline> upsamplePipeline;
+    std::unique_ptr<ComputePipeline> shadowMapPipeline;
+    std::unique_ptr<ComputePipeline> classifyTilesPipeline;
+    std::unique_ptr<ComputePipeline> fillOccludedTilesPipeline;
+    std::unique_ptr<ComputePipeline> fillEmptyTilesPipeline;
 
     // Targets
     ResourceHandle color;
+    // Reduced resolution target the clouds are ray-marched into, same as color at full resolution
+    ResourceHandle raymarchColor;
+    // Copy of the ray-march target from the previous frame
+    ResourceHandle history;
+    // Sun transmittance through the clouds, rebuilt only when the light or the cloud shape change
+    ResourceHandle lightVolume;
+    // Optical depth of the cloud layer along the sun direction, rebuilt only when the light or the cloud shape change
+    ResourceHandle shadowMap;
+    // Indirect dispatch arguments followed by the occluded, empty and full tile lists, rebuilt every frame
+    ResourceHandle tileLists;
+    // Clouds beyond the far-field distance, a layer per cube face, one face is refreshed per frame
+    ResourceHandle farField;
+    ResourceHandle farFieldSampler;
+    uint32_t renderScale = 1;
+
+    // State of the previous frame the history was rendered with
+    HmckMat4 previousViewProj{};
+    float previousTime = 0.0f;
+    bool historyValid = false;
+
+    // Light volume was built around this corner at this time, the clouds have drifted with the wind since
+    HmckVec3 lightVolumeOrigin{};
+    float lightVolumeTime = 0.0f;
+    // Values the light volume was built from, empty if it was never built
+    std::vector<float> lightVolumeInputs;
+
+    // Cloud shadow map was built around this corner at this time
+    HmckVec3 shadowMapOrigin{};
+    float shadowMapTime = 0.0f;
+    // Values the cloud shadow map was built from, empty if it was never built
+    std::vector<float> shadowMapInputs;
+
+    // Far-field faces were all refreshed around this position, next face is refreshed next
+    HmckVec3 farFieldOrigin{};
+    bool farFieldValid = false;
+    uint32_t farFieldFace = 0;
 
     // Resources
     ResourceHandle lowFrequencyNoise;
     ResourceHandle highFrequencyNoise;
-    ResourceHandle weatherMap;
     ResourceHandle curlNoise;
     ResourceHandle sampler;
+    std::unique_ptr<WeatherSystem> weather;
 
     // Inputs
     Image *cameraDepth;
+    Image *blueNoise;
 
     WeatherMap weatherMapEnum;
 
+    CloudNoiseParameters noiseParameters{};
+    std::string noiseCacheDirectory;
+
     void prepareBuffers();
 
     void prepareResources();
 
     void prepareTargets(uint32_t width, uint32_t height);
 
+    // Keeps the output of this frame as the history of the next one
+    void recordHistoryCopy(VkCommandBuffer commandBuffer);
+
+    void recordUpsample(VkCommandBuffer commandBuffer);
+
+    // Sorts the tiles of the ray-march target into the tile lists and fills their dispatch arguments
+    void recordTileClassification(VkCommandBuffer commandBuffer);
+
+    // Fills the occluded and the empty tiles, the full tiles are ray-marched
+    void recordTileFill(VkCommandBuffer commandBuffer);
+
+    /**
+     * Places the light volume into the uniform data for this frame
+     * @param wind Normalized wind direction, zero if there is no wind
+     * @return true if the volume has to be rebuilt because the sun, the wind or the cloud shape changed, or because
+     * the camera moved too far from its center
+     */
+    bool updateLightVolume(const HmckVec3 &wind);
+
+    // Weather blend of this frame rounded down to the steps the light volume and the shadow map are rebuilt in
+    float getWeatherBlendStep() const;
+
+    void recordLightVolume(VkCommandBuffer commandBuffer, ComputePipeline *lightVolumePipeline);
+
+    /**
+     * Places the cloud shadow map into the uniform data for this frame
+     * @param wind Normalized wind direction, zero if there is no wind
+     * @return true if the map has to be rebuilt because the sun, the wind or the cloud shape changed, or because the
+     * camera moved too far from its center
+     */
+    bool updateShadowMap(const HmckVec3 &wind);
+
+    void recordShadowMap(VkCommandBuffer commandBuffer);
+
+    /**
+     * Picks the far-field impostor faces refreshed this frame and places the first one into the uniform data
+     * @return Number of faces to refresh, all of them when the far field was switched on or the camera moved too far,
+     * none when it is off
+     */
+    uint32_t updateFarField();
+
+    void recordFarField(VkCommandBuffer commandBuffer, ComputePipeline *farFieldPipeline, uint32_t faceCount);
+
     void prepareDescriptors();
 
     void preparePipelines();
+
+    /**
+     * Returns the pipelines for the quality, creates them if the quality was not used before
+     * @param variantQuality Quality preset, custom for the pipelines that read the settings from the push constants
+     */
+    PipelineVariant &getPipelineVariant(CloudQuality variantQuality);
 };
@@ -0,0 +1,442 @@
+#include "WeatherSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+    // Stands for texels with no coverage anywhere, larger than any squared distance on the map
+    constexpr double COVERAGE_DISTANCE_INFINITY = 1e20;
+
+    // Squared distance transform of a sampled function (Felzenszwalb and Huttenlocher) in place. The function is
+    // tiled three times and the middle copy is kept, so that distances wrap around like the repeating weather map.
+    void distanceTransform(std::vector<double> &values) {
+        const int n = static_cast<int>(values.size());
+        const int m = 3 * n;
+        std::vector<double> f(m);
+        for (int q = 0; q < m; q++) {
+            f[q] = values[q % n];
+        }
+
+        // Lower envelope of the parabolas rooted at each sample
+        std::vector<int> v(m);
+        std::vector<double> z(m + 1);
+        int k = 0;
+        v[0] = 0;
+        z[0] = -COVERAGE_DISTANCE_INFINITY;
+        z[1] = COVERAGE_DISTANCE_INFINITY;
+        for (int q = 1; q < m; q++) {
+            double s;
+            while (true) {
+                const int r = v[k];
+                s = ((f[q] + static_cast<double>(q) * q) - (f[r] + static_cast<double>(r) * r)) / (2.0 * (q - r));
+                if (s > z[k] || k == 0) {
+                    break;
+                }
+                k--;
+            }
+            k++;
+            v[k] = q;
+            z[k] = s;
+            z[k + 1] = COVERAGE_DISTANCE_INFINITY;
+        }
+
+        k = 0;
+        for (int q = 0; q < 2 * n; q++) {
+            while (z[k + 1] < q) {
+                k++;
+            }
+            if (q >= n) {
+                const double d = q - v[k];
+                values[q - n] = d * d + f[v[k]];
+            }
+        }
+    }
+
+    // Distance in texels from each texel to the nearest texel that can produce clouds, which is a texel with coverage
+    // in either the red or the green channel as the green channel is enabled by the global coverage
+    std::vector<float> computeCoverageDistance(const uchar8_t *texels, int width, int height, int channels) {
+        std::vector<double> field(static_cast<size_t>(width) * height);
+        for (size_t i = 0; i < field.size(); i++) {
+            const bool covered = texels[i * channels] > 0 || texels[i * channels + 1] > 0;
+            field[i] = covered ? 0.0 : COVERAGE_DISTANCE_INFINITY;
+        }
+
+        // Separable, rows first then columns of the row distances
+        std::vector<double> line(width);
+        for (int y = 0; y < height; y++) {
+            std::copy_n(field.begin() + static_cast<size_t>(y) * width, width, line.begin());
+            distanceTransform(line);
+            std::copy_n(line.begin(), width, field.begin() + static_cast<size_t>(y) * width);
+        }
+        line.resize(height);
+        for (int x = 0; x < width; x++) {
+            for (int y = 0; y < height; y++) {
+                line[y] = field[static_cast<size_t>(y) * width + x];
+            }
+            distanceTransform(line);
+            for (int y = 0; y < height; y++) {
+                field[static_cast<size_t>(y) * width + x] = line[y];
+            }
+        }
+
+        // Map without coverage is empty everywhere, the whole map is as far as a ray needs to leap
+        const double maxDistance = static_cast<double>(width + height);
+        std::vector<float> distance(field.size());
+        for (size_t i = 0; i < field.size(); i++) {
+            distance[i] = static_cast<float>(std::min(std::sqrt(field[i]), maxDistance));
+        }
+        return distance;
+    }
+
+    // Bilinear resampling of a repeating RGBA map, streamed maps are fitted to the resident slots
+    std::vector<uchar8_t> resample(const uchar8_t *texels, int width, int height, uint32_t newWidth,
+                                   uint32_t newHeight) {
+        std::vector<uchar8_t> resampled(static_cast<size_t>(newWidth) * newHeight * 4);
+        for (uint32_t y = 0; y < newHeight; y++) {
+            const float sy = (static_cast<float>(y) + 0.5f) * static_cast<float>(height) / newHeight - 0.5f;
+            const int y0 = static_cast<int>(std::floor(sy));
+            const float fy = sy - static_cast<float>(y0);
+            for (uint32_t x = 0; x < newWidth; x++) {
+                const float sx = (static_cast<float>(x) + 0.5f) * static_cast<float>(width) / newWidth - 0.5f;
+                const int x0 = static_cast<int>(std::floor(sx));
+                const float fx = sx - static_cast<float>(x0);
+                for (int c = 0; c < 4; c++) {
+                    auto texel = [&](int tx, int ty) {
+                        tx = (tx % width + width) % width;
+                        ty = (ty % height + height) % height;
+                        return static_cast<float>(texels[(static_cast<size_t>(ty) * width + tx) * 4 + c]);
+                    };
+                    const float top = texel(x0, y0) + (texel(x0 + 1, y0) - texel(x0, y0)) * fx;
+                    const float bottom = texel(x0, y0 + 1) + (texel(x0 + 1, y0 + 1) - texel(x0, y0 + 1)) * fx;
+                    resampled[(static_cast<size_t>(y) * newWidth + x) * 4 + c] =
+                            static_cast<uchar8_t>(std::lround(top + (bottom - top) * fy));
+                }
+            }
+        }
+        return resampled;
+    }
+}
+
+WeatherSystem::WeatherSystem(Device &device, ResourceManager &resourceManager, WeatherMap weatherMap)
+    : device(device), resourceManager(resourceManager), requested(weatherMap) {
+    // First map is loaded before the first frame, so it is decoded and uploaded right away
+    const DecodedWeather decoded = decode(weatherMap, 0, 0);
+    createSlot(0, decoded.width, decoded.height, weatherMap);
+    createSlot(1, decoded.width, decoded.height, weatherMap);
+    uploadImmediately(0, decoded);
+
+    // Second slot is never sampled before a map is streamed into it, it only has to be in the layout the clouds expect
+    getWeatherMapImage(1)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    getCoverageDistanceImage(1)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    settledFrames = SwapChain::MAX_FRAMES_IN_FLIGHT + 1;
+
+    // Uploads are recorded into a pool of their own, the device pool is shared with the other one time commands
+    VkCommandPoolCreateInfo poolInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = device.getTransferQueueFamilyIndex(),
+    };
+    ASSERT(vkCreateCommandPool(device.device(), &poolInfo, nullptr, &commandPool) == VK_SUCCESS,
+           "Failed to create weather upload command pool!");
+
+    VkCommandBufferAllocateInfo allocInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = commandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+    ASSERT(vkAllocateCommandBuffers(device.device(), &allocInfo, &commandBuffer) == VK_SUCCESS,
+           "Failed to allocate weather upload command buffer!");
+
+    VkFenceCreateInfo fenceInfo = {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+    };
+    ASSERT(vkCreateFence(device.device(), &fenceInfo, nullptr, &uploadFence) == VK_SUCCESS,
+           "Failed to create weather upload fence!");
+}
+
+WeatherSystem::~WeatherSystem() {
+    if (state == State::Uploading) {
+        vkWaitForFences(device.device(), 1, &uploadFence, VK_TRUE, UINT64_MAX);
+        finishUpload();
+    }
+    // Decoding map is dropped, the future blocks until the worker is done with it
+    if (decoding.valid()) {
+        decoding.wait();
+    }
+    vkDestroyFence(device.device(), uploadFence, nullptr);
+    vkDestroyCommandPool(device.device(), commandPool, nullptr);
+}
+
+void WeatherSystem::transitionTo(WeatherMap weatherMap, float transitionTime) {
+    requested = weatherMap;
+    this->transitionTime = transitionTime;
+}
+
+void WeatherSystem::update(float deltaTime) {
+    const uint32_t hidden = 1 - target;
+    if (state == State::Idle || state == State::Decoding) {
+        settledFrames = std::min(settledFrames + 1, static_cast<uint32_t>(SwapChain::MAX_FRAMES_IN_FLIGHT + 1));
+    }
+
+    switch (state) {
+        case State::Idle: {
+            if (requested == slots[target].weatherMap) {
+                break;
+            }
+            // Decoded on a worker thread, the map is fitted to the slots there
+            const VkExtent3D extent = getWeatherMapImage(hidden)->getExtent();
+            decoding = std::async(std::launch::async, [map = requested, extent] {
+                return decode(map, extent.width, extent.height);
+            });
+            state = State::Decoding;
+            break;
+        }
+        case State::Decoding: {
+            // Frames in flight may still sample the hidden slot
+            if (decoding.wait_for(std::chrono::seconds(0)) != std::future_status::ready ||
+                settledFrames <= SwapChain::MAX_FRAMES_IN_FLIGHT) {
+                break;
+            }
+            const DecodedWeather decoded = decoding.get();
+            // Request changed while decoding, the next one is started from idle
+            if (decoded.weatherMap != requested) {
+                state = State::Idle;
+                break;
+            }
+            uploadAsync(hidden, decoded);
+            state = State::Uploading;
+            break;
+        }
+        case State::Uploading: {
+            if (vkGetFenceStatus(device.device(), uploadFence) != VK_SUCCESS) {
+                break;
+            }
+            finishUpload();
+            target = hidden;
+            state = State::Blending;
+            break;
+        }
+        case State::Blending: {
+            const float goal = target == 1 ? 1.0f : 0.0f;
+            const float step = transitionTime > 0.0f ? deltaTime / transitionTime : 1.0f;
+            blend = goal > blend ? std::min(blend + step, goal) : std::max(blend - step, goal);
+            if (blend == goal) {
+                settledFrames = 0;
+                state = State::Idle;
+            }
+            break;
+        }
+    }
+}
+
+std::string WeatherSystem::getWeatherMapPath(WeatherMap weatherMap) {
+    switch (weatherMap) {
+        case WeatherMap::Stratus:
+            return ASSET_PATH("weather/stratus.png");
+        case WeatherMap::Cumulus:
+            return ASSET_PATH("weather/cumulus.png");
+        case WeatherMap::Nubis:
+            return ASSET_PATH("weather/nubis.png");
+        case WeatherMap::Stratocumulus:
+        default:
+            return ASSET_PATH("weather/stratocumulus.png");
+    }
+}
+
+WeatherSystem::DecodedWeather WeatherSystem::decode(WeatherMap weatherMap, uint32_t width, uint32_t height) {
+    int w, h, c;
+    AutoDelete weatherMapData(readImage(getWeatherMapPath(weatherMap), w, h, c,
+                                        Filesystem::ImageFormat::R8G8B8A8_UNORM), [](const void *p) {
+        delete[] static_cast<const uchar8_t *>(p);
+    });
+    const auto *texels = static_cast<const uchar8_t *>(weatherMapData.get());
+
+    DecodedWeather decoded{
+        .weatherMap = weatherMap,
+        .width = width == 0 ? static_cast<uint32_t>(w) : width,
+        .height = height == 0 ? static_cast<uint32_t>(h) : height,
+    };
+    if (decoded.width == static_cast<uint32_t>(w) && decoded.height == static_cast<uint32_t>(h)) {
+        decoded.texels.assign(texels, texels + static_cast<size_t>(w) * h * c);
+    } else {
+        decoded.texels = resample(texels, w, h, decoded.width, decoded.height);
+    }
+    // Coverage distance field for empty space skipping, derived once the weather map is loaded
+    decoded.coverageDistance = computeCoverageDistance(decoded.texels.data(), static_cast<int>(decoded.width),
+                                                       static_cast<int>(decoded.height), 4);
+    return decoded;
+}
+
+void WeatherSystem::createSlot(uint32_t slot, uint32_t width, uint32_t height, WeatherMap weatherMap) {
+    const std::string suffix = "-" + std::to_string(slot);
+    slots[slot].weatherMap = weatherMap;
+    slots[slot].weather = resourceManager.createResource<Image>(
+        "weather-map" + suffix,
+        ImageDesc{
+            .width = width,
+            .height = height,
+            .channels = 4,
+            .format = VK_FORMAT_R8G8B8A8_UNORM,
+            .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .imageViewType = VK_IMAGE_VIEW_TYPE_2D,
+            .queueFamilies = {CommandQueueFamily::Compute, CommandQueueFamily::Graphics, CommandQueueFamily::Transfer},
+            // Written by the transfer queue while the clouds read the other slot, spares the ownership transfers
+            .sharingMode = VK_SHARING_MODE_CONCURRENT,
+        }
+    );
+    // Only ever loaded, not filtered
+    slots[slot].coverageDistance = resourceManager.createResource<Image>(
+        "coverage-distance" + suffix,
+        ImageDesc{
+            .width = width,
+            .height = height,
+            .channels = 1,
+            .format = VK_FORMAT_R32_SFLOAT,
+            .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .imageViewType = VK_IMAGE_VIEW_TYPE_2D,
+            .queueFamilies = {CommandQueueFamily::Compute, CommandQueueFamily::Graphics, CommandQueueFamily::Transfer},
+            .sharingMode = VK_SHARING_MODE_CONCURRENT,
+        }
+    );
+}
+
+void WeatherSystem::uploadImmediately(uint32_t slot, const DecodedWeather &decoded) {
+    ResourceHandle weatherStagingBuffer = resourceManager.createResource<Buffer>(
+        "weather-staging-buffer",
+        BufferDesc{
+            .instanceSize = sizeof(uchar8_t),
+            .instanceCount = static_cast<uint32_t>(decoded.texels.size()),
+            .usageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .allocationFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+        }
+    );
+    resourceManager.getResource<Buffer>(weatherStagingBuffer)->map();
+    resourceManager.getResource<Buffer>(weatherStagingBuffer)->writeToBuffer(decoded.texels.data());
+
+    ResourceHandle coverageDistanceStagingBuffer = resourceManager.createResource<Buffer>(
+        "coverage-distance-staging-buffer",
+        BufferDesc{
+            .instanceSize = sizeof(float),
+            .instanceCount = static_cast<uint32_t>(decoded.coverageDistance.size()),
+            .usageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .allocationFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+        }
+    );
+    resourceManager.getResource<Buffer>(coverageDistanceStagingBuffer)->map();
+    resourceManager.getResource<Buffer>(coverageDistanceStagingBuffer)->writeToBuffer(decoded.coverageDistance.data());
+
+    Image *weather = getWeatherMapImage(slot);
+    weather->queueImageLayoutTransition(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    weather->queueCopyFromBuffer(resourceManager.getResource<Buffer>(weatherStagingBuffer)->getBuffer());
+    weather->queueImageLayoutTransition(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    Image *coverageDistance = getCoverageDistanceImage(slot);
+    coverageDistance->queueImageLayoutTransition(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    coverageDistance->queueCopyFromBuffer(resourceManager.getResource<Buffer>(coverageDistanceStagingBuffer)->getBuffer());
+    coverageDistance->queueImageLayoutTransition(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    // Device helpers wait for the queue, the staging buffers are no longer read
+    resourceManager.releaseResource(weatherStagingBuffer.getUid());
+    resourceManager.releaseResource(coverageDistanceStagingBuffer.getUid());
+    slots[slot].weatherMap = decoded.weatherMap;
+}
+
+void WeatherSystem::uploadAsync(uint32_t slot, const DecodedWeather &decoded) {
+    stagingBuffers[0] = resourceManager.createResource<Buffer>(
+        "weather-streaming-buffer",
+        BufferDesc{
+            .instanceSize = sizeof(uchar8_t),
+            .instanceCount = static_cast<uint32_t>(decoded.texels.size()),
+            .usageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .allocationFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+        }
+    );
+    stagingBuffers[1] = resourceManager.createResource<Buffer>(
+        "coverage-distance-streaming-buffer",
+        BufferDesc{
+            .instanceSize = sizeof(float),
+            .instanceCount = static_cast<uint32_t>(decoded.coverageDistance.size()),
+            .usageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .allocationFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+        }
+    );
+    resourceManager.getResource<Buffer>(stagingBuffers[0])->map();
+    resourceManager.getResource<Buffer>(stagingBuffers[0])->writeToBuffer(decoded.texels.data());
+    resourceManager.getResource<Buffer>(stagingBuffers[1])->map();
+    resourceManager.getResource<Buffer>(stagingBuffers[1])->writeToBuffer(decoded.coverageDistance.data());
+
+    vkResetCommandPool(device.device(), commandPool, 0);
+    VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    const std::array<Image *, 2> images = {getWeatherMapImage(slot), getCoverageDistanceImage(slot)};
+    for (size_t i = 0; i < images.size(); i++) {
+        Image *image = images[i];
+        // Previous contents are discarded, no frame in flight samples the slot any more
+        image->pipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_2_NONE,
+            VK_ACCESS_2_NONE,
+            VK_PIPELINE_STAGE_2_COPY_BIT,
+            VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED
+        );
+
+        const VkExtent3D extent = image->getExtent();
+        VkBufferImageCopy region = {
+            .bufferOffset = 0,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+            .imageOffset = {0, 0, 0},
+            .imageExtent = extent,
+        };
+        vkCmdCopyBufferToImage(commandBuffer, resourceManager.getResource<Buffer>(stagingBuffers[i])->getBuffer(),
+                               image->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+        // Clouds read the slot only in later submissions, after the fence was seen signaled
+        image->pipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_2_COPY_BIT,
+            VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_NONE,
+            VK_ACCESS_2_NONE,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED
+        );
+    }
+    vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &commandBuffer,
+    };
+    ASSERT(vkQueueSubmit(device.transferQueue(), 1, &submitInfo, uploadFence) == VK_SUCCESS,
+           "Failed to submit weather upload!");
+    slots[slot].weatherMap = decoded.weatherMap;
+}
+
+void WeatherSystem::finishUpload() {
+    vkResetFences(device.device(), 1, &uploadFence);
+    for (ResourceHandle &stagingBuffer: stagingBuffers) {
+        resourceManager.releaseResource(stagingBuffer.getUid());
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <future>
+#include <hammock/hammock.h>
+#include "../Types.h"
+
+using namespace hammock;
+
+// Weather maps are blended over this many seconds unless the transition time is set
+#define WEATHER_DEFAULT_TRANSITION_TIME 10.0f
+
+/**
+ * Keeps two weather maps resident, each with the coverage distance field of its empty space skipping, and blends
+ * between them over a transition time. The clouds sample both slots weighted by the blend, a slot with zero weight is
+ * never sampled. A map switched to is decoded on a worker thread and uploaded on the transfer queue into the slot that
+ * is not shown, the frame loop only polls for it. Maps of another size are resampled to the size of the first one.
+ * Switching again during a transition waits until the blend finished.
+ */
+class WeatherSystem final {
+public:
+    WeatherSystem(Device &device, ResourceManager &resourceManager, WeatherMap weatherMap);
+
+    ~WeatherSystem();
+
+    /**
+     * Requests a transition to the weather map, the last request wins
+     * @param transitionTime Seconds over which the maps are blended once the map is resident
+     */
+    void transitionTo(WeatherMap weatherMap, float transitionTime);
+
+    /**
+     * Polls the streaming and advances the blend, call once per frame on the main thread before the frame is recorded
+     * as it submits to the transfer queue
+     */
+    void update(float deltaTime);
+
+    // Weight of the second slot, read by the clouds every frame
+    float getBlend() const { return blend; }
+
+    Image *getWeatherMapImage(uint32_t slot) const { return resourceManager.getResource<Image>(slots[slot].weather); }
+
+    Image *getCoverageDistanceImage(uint32_t slot) const {
+        return resourceManager.getResource<Image>(slots[slot].coverageDistance);
+    }
+
+    // Weather map and coverage distance field as they are uploaded, also read by the CPU reference of the clouds
+    struct DecodedWeather {
+        WeatherMap weatherMap;
+        uint32_t width;
+        uint32_t height;
+        std::vector<uchar8_t> texels;
+        std::vector<float> coverageDistance;
+    };
+
+    static std::string getWeatherMapPath(WeatherMap weatherMap);
+
+    /**
+     * Reads the map and derives its coverage distance field, safe to run on any thread
+     * @param width Width the map is resampled to, zero keeps the size of the map
+     * @param height Height the map is resampled to, zero keeps the size of the map
+     */
+    static DecodedWeather decode(WeatherMap weatherMap, uint32_t width, uint32_t height);
+
+private:
+    enum class State { Idle, Decoding, Uploading, Blending };
+
+    struct Slot {
+        ResourceHandle weather;
+        ResourceHandle coverageDistance;
+        WeatherMap weatherMap;
+    };
+
+    Device &device;
+    ResourceManager &resourceManager;
+
+    std::array<Slot, 2> slots;
+    // Slot the blend rests at or moves towards
+    uint32_t target = 0;
+    float blend = 0.0f;
+    // Frames recorded since the slot that is not shown got zero weight, frames in flight may still sample it
+    uint32_t settledFrames = 0;
+
+    State state = State::Idle;
+    WeatherMap requested;
+    float transitionTime = WEATHER_DEFAULT_TRANSITION_TIME;
+
+    std::future<DecodedWeather> decoding;
+
+    // Transfer queue upload in flight
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkFence uploadFence = VK_NULL_HANDLE;
+    std::array<ResourceHandle, 2> stagingBuffers;
+
+    // Creates the images of a slot, mip-less and shared by the compute, graphics and transfer queues
+    void createSlot(uint32_t slot, uint32_t width, uint32_t height, WeatherMap weatherMap);
+
+    // Fills the slot through the device helpers, only used before the first frame
+    void uploadImmediately(uint32_t slot, const DecodedWeather &decoded);
+
+    // Records and submits the upload of the slot on the transfer queue, completion is polled on the fence
+    void uploadAsync(uint32_t slot, const DecodedWeather &decoded);
+
+    // Releases the upload resources once the fence signaled
+    void finishUpload();
+};
@@ -1,9 +1,8 @@
 #include "CompositionPass.h"
 
 void CompositionPass::initialize(HmckVec2 resolution) {
-    prepareBlueNoise();
     prepareBuffer();
-    prepareTargets(static_cast<uint32_t>(resolution.X), static_cast<uint32_t>(resolution.Y));
+    prepareSampler();
     prepareDescriptors();
     preparePipelines();
     device.waitIdle();
@@ -14,8 +13,8 @@ void CompositionPass::initialize(HmckVec2 resolution) {
 }
 
 void CompositionPass::recordCommands(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
-    Image *compositedColorTarget = resourceManager.getResource<Image>(compositedImage);
-    Image *skyColorTarget = resourceManager.getResource<Image>(skyColor);
+    Image *compositedColorTarget = compositedImage;
+    Image *skyColorTarget = skyColor;
     VkExtent2D extent = {compositedColorTarget->getExtent().width, compositedColorTarget->getExtent().height};
 
     profiler.resetTimestamp(commandBuffer, 16);
@@ -121,49 +120,6 @@ void CompositionPass::recordCommands(VkCommandBuffer commandBuffer, uint32_t fra
     profiler.writeTimestamp(commandBuffer, 19, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT);
 }
 
-void CompositionPass::prepareBlueNoise() {
-    int w, h, c, d;
-    AutoDelete blueNoiseData(readImage(ASSET_PATH("blue_noise.png"), w, h, c,
-                                       Filesystem::ImageFormat::R16G16B16A16_SFLOAT), [](const void *p) {
-        delete[] static_cast<const float16_t *>(p);
-    });
-
-    // Create host visible staging buffer on device
-    ResourceHandle blueNoiseStagingBuffer = queueForDeletion(resourceManager.createResource<Buffer>(
-        "blue-noise-staging-buffer",
-        BufferDesc{
-            .instanceSize = sizeof(float16_t),
-            .instanceCount = static_cast<uint32_t>(w * h * c),
-            .usageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            .allocationFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
-        }
-    ));
-
-    // Write the data into the staging buffer
-    resourceManager.getResource<Buffer>(blueNoiseStagingBuffer)->map();
-    resourceManager.getResource<Buffer>(blueNoiseStagingBuffer)->writeToBuffer(blueNoiseData.get());
-
-    // Create the image resource
-    blueNoise = resourceManager.createResource<Image>(
-        "blue-noise",
-        ImageDesc{
-            .width = static_cast<uint32_t>(w),
-            .height = static_cast<uint32_t>(h),
-            .channels = static_cast<uint32_t>(c),
-            .format = VK_FORMAT_R16G16B16A16_SFLOAT,
-            .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-            .imageType = VK_IMAGE_TYPE_2D,
-            .imageViewType = VK_IMAGE_VIEW_TYPE_2D,
-        }
-    );
-
-    // Copy the data from buffer into the image
-    resourceManager.getResource<Image>(blueNoise)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    resourceManager.getResource<Image>(blueNoise)->queueCopyFromBuffer(
-        resourceManager.getResource<Buffer>(blueNoiseStagingBuffer)->getBuffer());
-    resourceManager.getResource<Image>(blueNoise)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-}
-
 void CompositionPass::prepareBuffer() {
     buffer = resourceManager.createResource<Buffer>(
         "composition-uniform-buffer", BufferDesc{
@@ -179,38 +135,7 @@ void CompositionPass::prepareBuffer() {
     resourceManager.getResource<Buffer>(buffer)->map();
 }
 
-void CompositionPass::prepareTargets(uint32_t width, uint32_t height) {
-    compositedImage = resourceManager.createResource<Image>(
-        "composited-color-image", ImageDesc{
-            .width = width,
-            .height = height,
-            .channels = 4,
-            .format = VK_FORMAT_R16G16B16A16_SFLOAT,
-            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-            .imageType = VK_IMAGE_TYPE_2D,
-            .imageViewType = VK_IMAGE_VIEW_TYPE_2D,
-            .clearValue = {.color = {0.f, 0.f, 0.f, 0.f}},
-        }
-    );
-    // Set initial layout
-    resourceManager.getResource<Image>(compositedImage)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-    skyColor = resourceManager.createResource<Image>(
-        "sky-color-image", ImageDesc{
-            .width = width,
-            .height = height,
-            .channels = 4,
-            .format = VK_FORMAT_R16G16B16A16_SFLOAT,
-            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-            .imageType = VK_IMAGE_TYPE_2D,
-            .imageViewType = VK_IMAGE_VIEW_TYPE_2D,
-            .clearValue = {.color = {0.f, 0.f, 0.f, 0.f}},
-        }
-    );
-    // Set initial layout
-    resourceManager.getResource<Image>(skyColor)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-
+void CompositionPass::prepareSampler() {
     sampler = resourceManager.createResource<Sampler>("composition-sampler", SamplerDesc{});
 }
 
@@ -226,11 +151,13 @@ void CompositionPass::prepareDescriptors() {
             .addBinding(7, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) // blue noise
             .addBinding(8, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) // Sky color
             .addBinding(9, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) // God rays image
+            .addBinding(10, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) // Cloud shadow map
             .build();
 
     skyLayout = DescriptorSetLayout::Builder(device)
             .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) // Sky view LUT
             .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) // Transmittance LUT
+            .addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) // Sky view bank
             .build();
 
     Sampler *s = resourceManager.getResource<Sampler>(sampler);
@@ -240,11 +167,13 @@ void CompositionPass::prepareDescriptors() {
     VkDescriptorImageInfo cloudsColorTarget = cloudsColor->getDescriptorImageInfo(s->getSampler());
     VkDescriptorImageInfo transmittanceLUTInfo = transmittanceLUT->getDescriptorImageInfo(s->getSampler());
     VkDescriptorImageInfo skyViewLUTInfo = skyViewLUT->getDescriptorImageInfo(s->getSampler());
+    VkDescriptorImageInfo skyViewBankInfo = skyViewBank->getDescriptorImageInfo(s->getSampler());
     VkDescriptorImageInfo aerialPerspectiveLUTInfo = aerialPerspectiveLUT->getDescriptorImageInfo(s->getSampler());
     VkDescriptorImageInfo sunShadowInfo = sunShadow->getDescriptorImageInfo(s->getSampler());
-    VkDescriptorImageInfo blueNoiseInfo = resourceManager.getResource<Image>(blueNoise)->getDescriptorImageInfo(s->getSampler());
-    VkDescriptorImageInfo skyColorInfo = resourceManager.getResource<Image>(skyColor)->getDescriptorImageInfo(s->getSampler());
+    VkDescriptorImageInfo blueNoiseInfo = blueNoise->getDescriptorImageInfo(s->getSampler());
+    VkDescriptorImageInfo skyColorInfo = skyColor->getDescriptorImageInfo(s->getSampler());
     VkDescriptorImageInfo godRaysImageInfo = godRaysTexture->getDescriptorImageInfo(s->getSampler());
+    VkDescriptorImageInfo cloudShadowMapInfo = cloudShadowMap->getDescriptorImageInfo(s->getSampler());
     DescriptorWriter(*compositionLayout, *descriptorPool)
             .writeBuffer(0, &bufferInfo)
             .writeImage(1, &terrainColorImageInfo)
@@ -256,14 +185,35 @@ void CompositionPass::prepareDescriptors() {
             .writeImage(7, &blueNoiseInfo)
             .writeImage(8, &skyColorInfo)
             .writeImage(9, &godRaysImageInfo)
+            .writeImage(10, &cloudShadowMapInfo)
             .build(compositionDescriptor);
 
     DescriptorWriter(*skyLayout, *descriptorPool)
             .writeImage(0, &skyViewLUTInfo)
             .writeImage(1, &transmittanceLUTInfo)
+            .writeImage(2, &skyViewBankInfo)
             .build(skyDescriptor);
 }
 
+void CompositionPass::refreshLookUpTables() {
+    Sampler *s = resourceManager.getResource<Sampler>(sampler);
+    VkDescriptorImageInfo transmittanceLUTInfo = transmittanceLUT->getDescriptorImageInfo(s->getSampler());
+    VkDescriptorImageInfo skyViewLUTInfo = skyViewLUT->getDescriptorImageInfo(s->getSampler());
+    VkDescriptorImageInfo skyViewBankInfo = skyViewBank->getDescriptorImageInfo(s->getSampler());
+    VkDescriptorImageInfo aerialPerspectiveLUTInfo = aerialPerspectiveLUT->getDescriptorImageInfo(s->getSampler());
+    // Only the LUT bindings are rewritten
+    DescriptorWriter(*compositionLayout, *descriptorPool)
+            .writeImage(4, &transmittanceLUTInfo)
+            .writeImage(5, &aerialPerspectiveLUTInfo)
+            .overwrite(compositionDescriptor);
+
+    DescriptorWriter(*skyLayout, *descriptorPool)
+            .writeImage(0, &skyViewLUTInfo)
+            .writeImage(1, &transmittanceLUTInfo)
+            .writeImage(2, &skyViewBankInfo)
+            .overwrite(skyDescriptor);
+}
+
 void CompositionPass::preparePipelines() {
     compositionPipeline = GraphicsPipeline::create({
         .debugName = "composition-pipeline",
@@ -281,7 +231,7 @@ void CompositionPass::preparePipelines() {
         .dynamicRendering = {
             .enabled = true,
             .colorAttachmentCount = 1, // We are rendering to single color attachment
-            .colorAttachmentFormats = {resourceManager.getResource<Image>(compositedImage)->getFormat()},
+            .colorAttachmentFormats = {compositedImage->getFormat()},
         }
     });
 
@@ -304,7 +254,7 @@ void CompositionPass::preparePipelines() {
         .dynamicRendering = {
             .enabled = true,
             .colorAttachmentCount = 1, // We are rendering to single color attachment
-            .colorAttachmentFormats = {resourceManager.getResource<Image>(skyColor)->getFormat()},
+            .colorAttachmentFormats = {skyColor->getFormat()},
         }
     });
 }
@@ -15,17 +15,38 @@ public:
     void setCloudsColor(Image *image) { cloudsColor = image; }
     void setTransmittanceLUT(Image * image) {transmittanceLUT = image; }
     void setSkyViewLUT(Image * image) {skyViewLUT = image; }
+    void setSkyViewBank(Image * image) {skyViewBank = image; }
+    void setSkyViewBankLayer(float layer, uint32_t layerCount) {
+        data.skyViewBankLayer = layer;
+        data.skyViewBankLayerCount = static_cast<float>(layerCount);
+    }
     void setAerialPerspectiveLUT(Image * image) {aerialPerspectiveLUT = image; }
     void setSunShadow(Image *image) { sunShadow = image; }
+    void setCloudShadowMap(Image *image) { cloudShadowMap = image; }
+    void setBlueNoise(Image *image) { blueNoise = image; }
+    void setCloudShadow(const CloudShadowData &cloudShadow) { data.cloudShadow = cloudShadow; }
     void setInvView(HmckMat4 mat) {data.inverseView = mat; }
     void setInvProjection(HmckMat4 mat) {data.inverseProjection = mat; }
     void setShadowViewProj(HmckMat4 mat) {data.shadowViewProj = mat; }
     void setSunDirection(HmckVec4 dir) {data.sunDirection = dir; }
     void setSunColor(HmckVec4 color) {data.sunColor = color; }
     void setAmbientColor(HmckVec4 color) {data.ambientColor = color; }
+    void setAtmosphereHeight(float height) {data.atmosphereHeight = height; }
     void setGodRaysTexture(Image * image) {godRaysTexture = image;}
     void setCameraPosition(HmckVec4 pos) {data.cameraPosition = pos; }
-    Image* getColorTarget() { return resourceManager.getResource<Image>(compositedImage); }
+
+    // Sky color and the composited image, have to be set before initialization
+    void setTargets(Image *sky, Image *composited) {
+        skyColor = sky;
+        compositedImage = composited;
+    }
+
+    Image* getColorTarget() { return compositedImage; }
+
+    /**
+     * Points the descriptors to the LUTs set by the setters, used when the LUT images are recreated. GPU has to be idle.
+     */
+    void refreshLookUpTables();
 
     void recordCommands(VkCommandBuffer commandBuffer, uint32_t frameIndex) override;
 
@@ -34,8 +55,8 @@ public:
 private:
 
     // Target
-    ResourceHandle compositedImage; // Final composited image that is passed to the post procsessing pass
-    ResourceHandle skyColor; // Sky color image up-sampled from skyViewLUT
+    Image *compositedImage; // Final composited image that is passed to the post procsessing pass
+    Image *skyColor; // Sky color image up-sampled from skyViewLUT
     ResourceHandle sampler;
     ResourceHandle buffer;
 
@@ -45,10 +66,12 @@ private:
     Image *cloudsColor;
     Image *transmittanceLUT;
     Image *skyViewLUT;
+    Image *skyViewBank;
     Image *aerialPerspectiveLUT;
     Image *sunShadow;
+    Image *cloudShadowMap;
     Image *godRaysTexture;
-    ResourceHandle blueNoise;
+    Image *blueNoise;
 
     // Descriptors
     std::unique_ptr<DescriptorSetLayout> compositionLayout;
@@ -60,9 +83,8 @@ private:
     std::unique_ptr<GraphicsPipeline> compositionPipeline;
     std::unique_ptr<GraphicsPipeline> skyPipeline;
 
-    void prepareBlueNoise();
     void prepareBuffer();
-    void prepareTargets(uint32_t width, uint32_t height);
+    void prepareSampler();
     void prepareDescriptors();
     void preparePipelines();
 };
@@ -1,7 +1,7 @@
 #include "GodRaysPass.h"
 
-void GodRaysPass::initialize(HmckVec2 resolution) {
-    prepareTargets(static_cast<uint32_t>(resolution.X), static_cast<uint32_t>(resolution.Y));
+void GodRaysPass::initialize() {
+    prepareSampler();
     prepareDescriptors();
     preparePipelines();
     device.waitIdle();
@@ -9,8 +9,8 @@ void GodRaysPass::initialize(HmckVec2 resolution) {
 }
 
 void GodRaysPass::recordCommands(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
-    Image *godRaysImage = getGodRaysTexture();
-    Image *maskImage = resourceManager.getResource<Image>(maskTexture);
+    Image *godRaysImage = godRaysTexture;
+    Image *maskImage = maskTexture;
     VkExtent2D extent = {maskImage->getExtent().width, maskImage->getExtent().height};
 
     profiler.resetTimestamp(commandBuffer, 12);
@@ -22,10 +22,6 @@ void GodRaysPass::recordCommands(VkCommandBuffer commandBuffer, uint32_t frameIn
         terrainDepth->transition(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     }
 
-    if (godRaysImage->getLayout() != VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-        godRaysImage->transition(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    }
-
     if (maskImage->getLayout() != VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) {
         maskImage->transition(commandBuffer, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
     }
@@ -62,6 +58,9 @@ void GodRaysPass::recordCommands(VkCommandBuffer commandBuffer, uint32_t frameIn
     // Bind mask pipeline
     maskPipeline->bind(commandBuffer);
 
+    // Push camera rays and cloud shadows
+    vkCmdPushConstants(commandBuffer, maskPipeline->pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(GodRaysMaskData), &maskData);
+
     // Draw
     vkCmdDraw(commandBuffer, 3, 1, 0, 0);
 
@@ -110,37 +109,7 @@ void GodRaysPass::recordCommands(VkCommandBuffer commandBuffer, uint32_t frameIn
     profiler.writeTimestamp(commandBuffer, 15, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT);
 }
 
-void GodRaysPass::prepareTargets(uint32_t width, uint32_t height) {
-    maskTexture = resourceManager.createResource<Image>(
-        "mask-image", ImageDesc{
-            .width = width,
-            .height = height,
-            .channels = 4,
-            .format = VK_FORMAT_R16G16B16A16_SFLOAT,
-            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-            .imageType = VK_IMAGE_TYPE_2D,
-            .imageViewType = VK_IMAGE_VIEW_TYPE_2D,
-            .clearValue = {.color = {0.f, 0.f, 0.f, 0.f}},
-        }
-    );
-    // Set initial layout
-    resourceManager.getResource<Image>(maskTexture)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-    godRaysTexture = resourceManager.createResource<Image>(
-        "god-rays-image", ImageDesc{
-            .width = width,
-            .height = height,
-            .channels = 4,
-            .format = VK_FORMAT_R16G16B16A16_SFLOAT,
-            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-            .imageType = VK_IMAGE_TYPE_2D,
-            .imageViewType = VK_IMAGE_VIEW_TYPE_2D,
-            .clearValue = {.color = {0.f, 0.f, 0.f, 0.f}},
-        }
-    );
-    // Set initial layout
-    resourceManager.getResource<Image>(godRaysTexture)->queueImageLayoutTransition(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
+void GodRaysPass::prepareSampler() {
     sampler = resourceManager.createResource<Sampler>("god-rays-sampler", SamplerDesc{});
 }
 
@@ -148,24 +117,30 @@ void GodRaysPass::prepareDescriptors() {
     maskLayout = DescriptorSetLayout::Builder(device)
             .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
             .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
             .build();
 
     raysLayout = DescriptorSetLayout::Builder(device)
             .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
             .build();
 
     Sampler *s = resourceManager.getResource<Sampler>(sampler);
     VkDescriptorImageInfo cloudsImageInfo = cloudsImage->getDescriptorImageInfo(s->getSampler());
     VkDescriptorImageInfo terrainDepthInfo = terrainDepth->getDescriptorImageInfo(s->getSampler());
-    VkDescriptorImageInfo maskInfo = resourceManager.getResource<Image>(maskTexture)->getDescriptorImageInfo(s->getSampler());
+    VkDescriptorImageInfo cloudShadowMapInfo = cloudShadowMap->getDescriptorImageInfo(s->getSampler());
+    VkDescriptorImageInfo maskInfo = maskTexture->getDescriptorImageInfo(s->getSampler());
+    VkDescriptorImageInfo blueNoiseInfo = blueNoise->getDescriptorImageInfo(s->getSampler());
 
     DescriptorWriter(*maskLayout, *descriptorPool)
             .writeImage(0, &cloudsImageInfo)
             .writeImage(1, &terrainDepthInfo)
+            .writeImage(2, &cloudShadowMapInfo)
             .build(maskDescriptor);
 
     DescriptorWriter(*raysLayout, *descriptorPool)
             .writeImage(0, &maskInfo)
+            .writeImage(1, &blueNoiseInfo)
             .build(raysDescriptor);
 }
 
@@ -178,7 +153,9 @@ void GodRaysPass::preparePipelines() {
         .fragmentShader
         {.byteCode = Filesystem::readFile(COMPILED_SHADER_PATH("mask.frag")),},
         .descriptorSetLayouts = {maskLayout->getDescriptorSetLayout()},
-        .pushConstantRanges{},
+        .pushConstantRanges{
+            {VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(GodRaysMaskData)}
+        },
         .graphicsState{
             .cullMode = VK_CULL_MODE_NONE,
             .vertexBufferBindings{}
@@ -186,7 +163,7 @@ void GodRaysPass::preparePipelines() {
         .dynamicRendering = {
             .enabled = true,
             .colorAttachmentCount = 1,
-            .colorAttachmentFormats = {resourceManager.getResource<Image>(maskTexture)->getFormat()},
+            .colorAttachmentFormats = {maskTexture->getFormat()},
         }
     });
 
@@ -208,7 +185,7 @@ void GodRaysPass::preparePipelines() {
         .dynamicRendering = {
             .enabled = true,
             .colorAttachmentCount = 1,
-            .colorAttachmentFormats = {resourceManager.getResource<Image>(godRaysTexture)->getFormat()},
+            .colorAttachmentFormats = {godRaysTexture->getFormat()},
         }
     });
 }
@@ -8,29 +8,51 @@ public:
     GodRaysPass(Device &device, ResourceManager &resourceManager, Profiler& profiler)
         : IRenderGroup(device, resourceManager, profiler) {
     }
-    void initialize(HmckVec2 resolution);
+    void initialize();
     void recordCommands(VkCommandBuffer commandBuffer, uint32_t frameIndex) override;
 
     void setCloudsImage(Image * image) { cloudsImage = image; }
     void setTerrainDepth(Image * image) { terrainDepth = image; }
     void setSunScreenSpacePosition(float x, float y) {coefficients.lssposX = x; coefficients.lssposY = y; }
+    void setCloudShadowMap(Image * image) { cloudShadowMap = image; }
+    void setBlueNoise(Image * image) { blueNoise = image; }
+    void setFrameIndex(uint32_t frameIndex) { coefficients.frameIndex = frameIndex; }
+    void setCloudShadow(const CloudShadowData &cloudShadow) { maskData.cloudShadow = cloudShadow; }
+    void setCameraPosition(HmckVec4 position) { maskData.cameraPosition = position; }
 
-    Image * getGodRaysTexture() {return resourceManager.getResource<Image>(godRaysTexture);}
+    // Mask and the god rays it is blurred into, have to be set before initialization
+    void setTargets(Image *mask, Image *godRays) {
+        maskTexture = mask;
+        godRaysTexture = godRays;
+    }
+
+    void setCameraFrustum(HmckVec4 a, HmckVec4 b, HmckVec4 c, HmckVec4 d) {
+        maskData.frustumA = a;
+        maskData.frustumB = b;
+        maskData.frustumC = c;
+        maskData.frustumD = d;
+    }
+
+    Image * getGodRaysTexture() {return godRaysTexture;}
 
     GodRaysCoefficients coefficients;
 
 private:
+    // Sky in cloud shadows is masked out
+    GodRaysMaskData maskData{};
 
 
 
     // Targets
-    ResourceHandle maskTexture;
-    ResourceHandle godRaysTexture;
+    Image * maskTexture;
+    Image * godRaysTexture;
     ResourceHandle sampler;
 
     // Inputs
     Image * cloudsImage;
     Image * terrainDepth;
+    Image * cloudShadowMap;
+    Image * blueNoise;
 
     // Descriptors
     std::unique_ptr<DescriptorSetLayout> maskLayout;
@@ -42,7 +64,7 @@ private:
     std::unique_ptr<GraphicsPipeline> maskPipeline;
     std::unique_ptr<GraphicsPipeline> raysPipeline;
 
-    void prepareTargets(uint32_t width, uint32_t height);
+    void prepareSampler();
     void prepareDescriptors();
     void preparePipelines();
 
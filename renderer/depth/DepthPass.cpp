@@ -138,7 +138,9 @@ void DepthPass::prepareTargets(uint32_t width, uint32_t height) {
             .height = height,
             .channels = 1,
             .format = VK_FORMAT_D32_SFLOAT, // Guaranteed support on all devices
-            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+            // Read back by the cloud capture
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                     VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
             .imageType = VK_IMAGE_TYPE_2D,
             .imageViewType = VK_IMAGE_VIEW_TYPE_2D,
             .aspectFlags = VK_IMAGE_ASPECT_DEPTH_BIT,
@@ -73,16 +73,32 @@ void ::UserInterface::showDebugWindow() {
                      0.0f, 33.0f,
                      ImVec2(0, 80));
     ImGui::SeparatorText("Rendering");
-    ImGui::DragInt("Max density samples", &cloudsPushConstant->DEBUG_maxSamples, 0.1f, 2, 2048);
-    ImGui::DragInt("Max light density samples",  &cloudsPushConstant->DEBUG_maxLightSamples, 0.1f, 2, 64);
-    ImGui::DragFloat("Large step multiplier",  &cloudsPushConstant->DEBUG_longStepMulti, 0.1f, 1.f, 5.0f);
+    int quality = static_cast<int>(*cloudQuality);
+    if (ImGui::Combo("Cloud quality", &quality, "Low\0Medium\0High\0Ultra\0Custom\0")) {
+        *cloudQuality = static_cast<CloudQuality>(quality);
+    }
+    // Presets are baked into the pipelines, tweaking any of their settings switches to the custom quality
+    bool customized = false;
+    customized |= ImGui::DragInt("Max density samples", &cloudsPushConstant->DEBUG_maxSamples, 0.1f, 2, 2048);
+    customized |= ImGui::DragInt("Max light density samples",  &cloudsPushConstant->DEBUG_maxLightSamples, 0.1f, 2, 64);
+    customized |= ImGui::DragFloat("Large step multiplier",  &cloudsPushConstant->DEBUG_longStepMulti, 0.1f, 1.f, 5.0f);
     ImGui::DragInt("Cheap sample distance",  &cloudsPushConstant->DEBUG_cheapSampleDistance, 10, 0,
                    1000000);
     ImGui::Checkbox("Enable epic view", (bool *)  &cloudsPushConstant->DEBUG_epicView);
+    ImGui::Checkbox("Temporal clouds", temporalClouds);
+    ImGui::Checkbox("Empty space skipping", (bool *)  &cloudsPushConstant->emptySpaceSkipping);
+    ImGui::Checkbox("Light volume", (bool *)  &cloudsPushConstant->lightVolume);
+    ImGui::Checkbox("Tile classification", (bool *)  &cloudsPushConstant->tileClassification);
+    ImGui::Checkbox("Far field", (bool *)  &cloudsPushConstant->farField);
+    ImGui::DragFloat("Far field distance",  &cloudsPushConstant->farFieldDistance, 100.0f, 5000.0f, 200000.0f);
+    ImGui::Checkbox("Cloud shadows", cloudShadows);
 
     ImGui::SeparatorText("Debug views");
-    ImGui::Checkbox("Early termination regions", (bool *)  &cloudsPushConstant->DEBUG_earlyTermination);
-    ImGui::Checkbox("Late termination regions", (bool *)  &cloudsPushConstant->DEBUG_lateTermination);
+    customized |= ImGui::Checkbox("Early termination regions", (bool *)  &cloudsPushConstant->DEBUG_earlyTermination);
+    customized |= ImGui::Checkbox("Late termination regions", (bool *)  &cloudsPushConstant->DEBUG_lateTermination);
+    if (customized) {
+        *cloudQuality = CloudQuality::Custom;
+    }
 
     ImGui::End();
 }
@@ -106,6 +122,11 @@ void ::UserInterface::showEditorWindow() {
     ImGui::SliderFloat("Spread",  &cloudsPushConstant->spread, 0.f, 1.0f);
 
     ImGui::SeparatorText("Weather");
+    int weather = static_cast<int>(*weatherMap);
+    if (ImGui::Combo("Weather map", &weather, "Stratus\0Stratocumulus\0Cumulus\0Nubis\0")) {
+        *weatherMap = static_cast<WeatherMap>(weather);
+    }
+    ImGui::SliderFloat("Transition time", weatherTransitionTime, 0.0f, 60.f, "%.1f s");
     ImGui::SliderFloat("Global coverage",  &cloudsPushConstant->globalCoverage, 0.0f, 1.f);
     ImGui::SliderFloat("Global density",  &cloudsPushConstant->globalDensity, 0.0f, 1.f);
     ImGui::SliderFloat("Wind speed",  &cloudsPushConstant->cloudSpeed, 0.0f, 5000.f);
@@ -123,6 +144,24 @@ void ::UserInterface::showEditorWindow() {
     ImGui::SliderFloat("Sun light strength", &cloudsUniformBuffer->lightColor.Elements[0], 0.0f, 15.f);
     ImGui::SliderFloat("Ambient light strength",  &cloudsPushConstant->ambientStrength, 0.0f, 1.f);
 
+    ImGui::SeparatorText("Planet");
+    if (ImGui::Combo("Preset", &atmospherePreset, "Earth\0Mars\0Hazy Earth\0")) {
+        *atmosphereParameters = AtmosphereParameters::fromPreset(static_cast<AtmospherePreset>(atmospherePreset));
+    }
+    ImGui::DragFloat("Mie scattering", &atmosphereParameters->scatterMie, 1e-7f, 0.0f, 1e-4f, "%.7f");
+    ImGui::DragFloat("Mie absorption", &atmosphereParameters->absorbMie, 1e-7f, 0.0f, 1e-4f, "%.7f");
+    ImGui::SliderFloat("Mie asymmetry", &atmosphereParameters->asymmetryMie, 0.0f, .99f);
+    ImGui::SliderFloat("Mie scale height", &atmosphereParameters->hDensityMie, 100.0f, 20000.f);
+    ImGui::SliderFloat("Rayleigh scale height", &atmosphereParameters->hDensityRayleigh, 1000.0f, 20000.f);
+    int quality = static_cast<int>(*atmosphereQuality);
+    if (ImGui::Combo("LUT quality", &quality, "Low\0Medium\0High\0Ultra\0")) {
+        *atmosphereQuality = static_cast<AtmosphereQuality>(quality);
+    }
+    int integrator = static_cast<int>(*transmittanceIntegrator);
+    if (ImGui::Combo("Transmittance", &integrator, "Raymarch\0Adaptive\0Chapman\0")) {
+        *transmittanceIntegrator = static_cast<TransmittanceIntegrator>(integrator);
+    }
+
     ImGui::SeparatorText("God rays");
     ImGui::Checkbox("Screen space god rays", (bool *)&compositionData->applyGodRays);
     if (compositionData->applyGodRays == 1){
@@ -18,6 +18,14 @@ class UserInterface final {
     PostProcessingPushConstantData * postProcessingPushConstant;
     CompositionData * compositionData;
     GodRaysCoefficients * godRaysCoefficients;
+    AtmosphereParameters * atmosphereParameters;
+    AtmosphereQuality * atmosphereQuality;
+    TransmittanceIntegrator * transmittanceIntegrator;
+    bool * temporalClouds;
+    bool * cloudShadows;
+    CloudQuality * cloudQuality;
+    WeatherMap * weatherMap;
+    float * weatherTransitionTime;
 
 
 
@@ -35,6 +43,7 @@ class UserInterface final {
 
     float angle = 233.f;
     float sunA = 334.286f, sunE = 48.673f;
+    int atmospherePreset = 0;
 
     void showCameraWindow();
 
@@ -69,8 +78,22 @@ public:
     void setCloudsUniformData(CloudsUniformBufferData * data) { cloudsUniformBuffer = data; }
     void setPostProccessingData(PostProcessingPushConstantData * data) { postProcessingPushConstant = data; }
     void setCloudsPushData(CloudsPushConstantData * data) { cloudsPushConstant = data; }
+    void setTemporalClouds(bool * temporal) { temporalClouds = temporal; }
+    void setCloudShadows(bool * shadows) { cloudShadows = shadows; }
+    void setCloudQuality(CloudQuality * quality) { cloudQuality = quality; }
+    void setWeather(WeatherMap * map, float * transitionTime) {
+        weatherMap = map;
+        weatherTransitionTime = transitionTime;
+    }
     void setCompositionData(CompositionData * data) { compositionData = data; }
     void setGodRaysCoefficients(GodRaysCoefficients * data) {godRaysCoefficients = data;}
+    void setAtmosphereParameters(AtmosphereParameters * data, AtmospherePreset preset) {
+        atmosphereParameters = data;
+        atmospherePreset = static_cast<int>(preset);
+    }
+
+    void setAtmosphereQuality(AtmosphereQuality * quality) { atmosphereQuality = quality; }
+    void setTransmittanceIntegrator(TransmittanceIntegrator * integrator) { transmittanceIntegrator = integrator; }
 
     void recordUserInterface(VkCommandBuffer commandBuffer);
 };